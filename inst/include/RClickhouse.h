@@ -1,8 +1,18 @@
 #ifndef RCPP_RClickhouse_H
 #define RCPP_RClickhouse_H
 
+// the classes of the package itself, which the exported functions are
+// declared with; they depend on the Clickhouse client built into the
+// package, so that they are not available to other packages (Rcpp is
+// included before R's headers are by the C interface)
+#ifdef RCLICKHOUSE_INTERNAL
 #include <clickhouse/client.h>
 #include <result.h>
+#include <insert.h>
 using namespace clickhouse;
+#endif
+
+// the C interface for other packages, see RClickhouse_api.h
+#include "RClickhouse_api.h"
 
 #endif // RCPP_RClickhouse_H
@@ -0,0 +1,164 @@
+#ifndef RCLICKHOUSE_API_H
+#define RCLICKHOUSE_API_H
+
+/* The C interface of RClickhouse for other packages, which list it in
+   LinkingTo and include this header: the blocks of a query are handed to a
+   callback as they are received, as Arrow struct arrays which refer to the
+   buffers of the columns instead of copies or R vectors. It only depends on
+   R's headers and the Arrow C data interface, so that it does not change
+   with the version of the Clickhouse client built into the package; the
+   functions are looked up with R_GetCCallable when first called, once
+   RClickhouse has been loaded (e.g. by requireNamespace). Packages using
+   Rcpp include it after Rcpp.h, like R's headers. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Rinternals.h>
+#include <R_ext/Rdynload.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the structs of the Arrow C data interface, see
+   https://arrow.apache.org/docs/format/CDataInterface.html */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+
+#endif  /* ARROW_C_DATA_INTERFACE */
+
+/* the version of this interface, raised when functions are added */
+#define RCLICKHOUSE_API_VERSION 1
+
+/* a connection opened by dbConnect, valid until it is disconnected */
+typedef struct RClickhouse_Connection RClickhouse_Connection;
+
+/* called with each non-empty block of a query, as it is received: schema is
+   a struct of the columns, only valid during the call, and block a struct
+   array of them, which the callback owns and has to release (possibly much
+   later, from any thread); the buffers of the columns are shared with the
+   client, and must not be written to. Returning nonzero cancels the rest of
+   the query. */
+typedef int (*RClickhouse_BlockCallback)(const struct ArrowSchema *schema,
+                                         struct ArrowArray *block, void *data);
+
+/* the version of the interface implemented by the loaded package */
+static inline int RClickhouse_apiVersion(void) {
+  static int (*fn)(void) = NULL;
+  if (fn == NULL) {
+    fn = (int (*)(void)) R_GetCCallable("RClickhouse", "RClickhouse_apiVersion");
+  }
+  return fn();
+}
+
+/* the connection of conn, a ClickhouseConnection or its ptr slot, or NULL if
+   it has been disconnected or an asynchronous query or insert is running on
+   it; only to be called on R's thread */
+static inline RClickhouse_Connection *RClickhouse_connection(SEXP conn) {
+  static RClickhouse_Connection *(*fn)(SEXP) = NULL;
+  if (fn == NULL) {
+    fn = (RClickhouse_Connection *(*)(SEXP)) R_GetCCallable("RClickhouse", "RClickhouse_connection");
+  }
+  return fn(conn);
+}
+
+/* runs query over conn, passing its blocks to callback with data; returns 0
+   once all of them have been passed (or the callback has canceled the
+   query), otherwise nonzero with the message of the error copied into error
+   (of errorSize bytes, may be NULL). Doesn't touch R, so it may be called
+   from another thread, as long as conn is used by one thread at a time and
+   is not disconnected meanwhile; interrupts are not checked for. */
+static inline int RClickhouse_select(RClickhouse_Connection *conn, const char *query,
+                                     RClickhouse_BlockCallback callback, void *data,
+                                     char *error, size_t errorSize) {
+  static int (*fn)(RClickhouse_Connection *, const char *, RClickhouse_BlockCallback, void *,
+                   char *, size_t) = NULL;
+  if (fn == NULL) {
+    fn = (int (*)(RClickhouse_Connection *, const char *, RClickhouse_BlockCallback, void *,
+                  char *, size_t)) R_GetCCallable("RClickhouse", "RClickhouse_select");
+  }
+  return fn(conn, query, callback, data, error, errorSize);
+}
+
+#ifdef __cplusplus
+}
+
+#include <cstring>
+
+namespace RClickhouse {
+
+// Typed read-only views of the columns of a block (its children), which
+// account for the offset of the array; the values of NULL rows are
+// unspecified. The Arrow format of a column (the schema's child) tells the
+// type: "c" to "L" for the integers, "f" and "g" for Float32 and Float64,
+// "U" for String, "w:n" for FixedString(n), "tdD" for dates (int32 days),
+// "tss:" and so on for DateTime and DateTime64 (int64).
+
+// the values of a column of fixed width type T
+template<typename T>
+inline const T *values(const ArrowArray *column) {
+  return static_cast<const T *>(column->buffers[1]) + column->offset;
+}
+
+// whether row i of column is NULL
+inline bool isNull(const ArrowArray *column, int64_t i) {
+  const uint8_t *valid = static_cast<const uint8_t *>(column->buffers[0]);
+  if (!valid) {
+    return false;
+  }
+  const int64_t j = column->offset + i;
+  return !((valid[j / 8] >> (j % 8)) & 1);
+}
+
+struct StringView {
+  const char *data;
+  size_t size;
+};
+
+// row i of a String column
+inline StringView stringAt(const ArrowArray *column, int64_t i) {
+  const int64_t *offsets = static_cast<const int64_t *>(column->buffers[1]) + column->offset;
+  const char *chars = static_cast<const char *>(column->buffers[2]);
+  return StringView{chars + offsets[i], static_cast<size_t>(offsets[i+1] - offsets[i])};
+}
+
+// row i of a FixedString(width) column
+inline StringView fixedStringAt(const ArrowArray *column, int64_t i, size_t width) {
+  const char *chars = static_cast<const char *>(column->buffers[1]);
+  return StringView{chars + (column->offset + i) * width, width};
+}
+
+}
+
+#endif  /* __cplusplus */
+
+#endif  /* RCLICKHOUSE_API_H */
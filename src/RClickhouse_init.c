@@ -11,40 +11,124 @@
 */
 
 /* .Call calls */
+extern SEXP _RClickhouse_accumulate(SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_accumulated(SEXP);
+extern SEXP _RClickhouse_appendBuffer(SEXP, SEXP);
+extern SEXP _RClickhouse_appendInsert(SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_bufferInsert(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_bufferStats(SEXP);
+extern SEXP _RClickhouse_cancelInsert(SEXP);
 extern SEXP _RClickhouse_clearResult(SEXP);
-extern SEXP _RClickhouse_connect(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_closeBuffer(SEXP);
+extern SEXP _RClickhouse_closeInsert(SEXP);
+extern SEXP _RClickhouse_connect(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_connectionTrace(SEXP, SEXP);
+extern SEXP _RClickhouse_currentEndpoint(SEXP);
 extern SEXP _RClickhouse_disconnect(SEXP);
-extern SEXP _RClickhouse_fetch(SEXP, SEXP);
+extern SEXP _RClickhouse_fetch(SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_fetchArrow(SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_flushBuffer(SEXP);
+extern SEXP _RClickhouse_flushInsert(SEXP);
+extern SEXP _RClickhouse_getProgress(SEXP);
+extern SEXP _RClickhouse_getQueryId(SEXP);
 extern SEXP _RClickhouse_getRowCount(SEXP);
 extern SEXP _RClickhouse_getRowsAffected(SEXP);
 extern SEXP _RClickhouse_getStatement(SEXP);
+extern SEXP _RClickhouse_getStats(SEXP);
+extern SEXP _RClickhouse_getTrace(SEXP, SEXP);
 extern SEXP _RClickhouse_hasCompleted(SEXP);
-extern SEXP _RClickhouse_insert(SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_insert(SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_insertChunks(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_insertFile(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_insertTypes(SEXP);
+extern SEXP _RClickhouse_isIdle(SEXP);
+extern SEXP _RClickhouse_listTables(SEXP, SEXP);
+extern SEXP _RClickhouse_metadataCache(SEXP, SEXP);
+extern SEXP _RClickhouse_ping(SEXP);
+extern SEXP _RClickhouse_prepareForks(SEXP, SEXP);
+extern SEXP _RClickhouse_prepareInsert(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
 extern SEXP _RClickhouse_RcppExport_registerCCallable();
+extern SEXP _RClickhouse_readNativeFile(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_rebindResult(SEXP, SEXP);
+extern SEXP _RClickhouse_resultBytes(SEXP);
+extern SEXP _RClickhouse_resultCache(SEXP, SEXP);
+extern SEXP _RClickhouse_resultMemory(SEXP);
 extern SEXP _RClickhouse_resultTypes(SEXP);
-extern SEXP _RClickhouse_select(SEXP, SEXP);
+extern SEXP _RClickhouse_select(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_selectShards(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_selectToFile(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_shardOf(SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_streamBlocks(SEXP, SEXP, SEXP, SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_tableColumns(SEXP, SEXP, SEXP);
+extern SEXP _RClickhouse_threadPool(SEXP);
 extern SEXP _RClickhouse_validPtr(SEXP);
 
 static const R_CallMethodDef CallEntries[] = {
+    {"_RClickhouse_accumulate",                   (DL_FUNC) &_RClickhouse_accumulate,                   3},
+    {"_RClickhouse_accumulated",                  (DL_FUNC) &_RClickhouse_accumulated,                  1},
+    {"_RClickhouse_appendBuffer",                 (DL_FUNC) &_RClickhouse_appendBuffer,                 2},
+    {"_RClickhouse_appendInsert",                 (DL_FUNC) &_RClickhouse_appendInsert,                 3},
+    {"_RClickhouse_bufferInsert",                 (DL_FUNC) &_RClickhouse_bufferInsert,                 7},
+    {"_RClickhouse_bufferStats",                  (DL_FUNC) &_RClickhouse_bufferStats,                  1},
+    {"_RClickhouse_cancelInsert",                 (DL_FUNC) &_RClickhouse_cancelInsert,                 1},
     {"_RClickhouse_clearResult",                  (DL_FUNC) &_RClickhouse_clearResult,                  1},
-    {"_RClickhouse_connect",                      (DL_FUNC) &_RClickhouse_connect,                      6},
+    {"_RClickhouse_closeBuffer",                  (DL_FUNC) &_RClickhouse_closeBuffer,                  1},
+    {"_RClickhouse_closeInsert",                  (DL_FUNC) &_RClickhouse_closeInsert,                  1},
+    {"_RClickhouse_connect",                      (DL_FUNC) &_RClickhouse_connect,                      10},
+    {"_RClickhouse_connectionTrace",              (DL_FUNC) &_RClickhouse_connectionTrace,              2},
+    {"_RClickhouse_currentEndpoint",              (DL_FUNC) &_RClickhouse_currentEndpoint,              1},
     {"_RClickhouse_disconnect",                   (DL_FUNC) &_RClickhouse_disconnect,                   1},
-    {"_RClickhouse_fetch",                        (DL_FUNC) &_RClickhouse_fetch,                        2},
+    {"_RClickhouse_fetch",                        (DL_FUNC) &_RClickhouse_fetch,                        4},
+    {"_RClickhouse_fetchArrow",                   (DL_FUNC) &_RClickhouse_fetchArrow,                   3},
+    {"_RClickhouse_flushBuffer",                  (DL_FUNC) &_RClickhouse_flushBuffer,                  1},
+    {"_RClickhouse_flushInsert",                  (DL_FUNC) &_RClickhouse_flushInsert,                  1},
+    {"_RClickhouse_getProgress",                  (DL_FUNC) &_RClickhouse_getProgress,                  1},
+    {"_RClickhouse_getQueryId",                   (DL_FUNC) &_RClickhouse_getQueryId,                   1},
     {"_RClickhouse_getRowCount",                  (DL_FUNC) &_RClickhouse_getRowCount,                  1},
     {"_RClickhouse_getRowsAffected",              (DL_FUNC) &_RClickhouse_getRowsAffected,              1},
     {"_RClickhouse_getStatement",                 (DL_FUNC) &_RClickhouse_getStatement,                 1},
+    {"_RClickhouse_getStats",                     (DL_FUNC) &_RClickhouse_getStats,                     1},
+    {"_RClickhouse_getTrace",                     (DL_FUNC) &_RClickhouse_getTrace,                     2},
     {"_RClickhouse_hasCompleted",                 (DL_FUNC) &_RClickhouse_hasCompleted,                 1},
-    {"_RClickhouse_insert",                       (DL_FUNC) &_RClickhouse_insert,                       3},
+    {"_RClickhouse_insert",                       (DL_FUNC) &_RClickhouse_insert,                       5},
+    {"_RClickhouse_insertChunks",                 (DL_FUNC) &_RClickhouse_insertChunks,                 9},
+    {"_RClickhouse_insertFile",                   (DL_FUNC) &_RClickhouse_insertFile,                   8},
+    {"_RClickhouse_insertTypes",                  (DL_FUNC) &_RClickhouse_insertTypes,                  1},
+    {"_RClickhouse_isIdle",                       (DL_FUNC) &_RClickhouse_isIdle,                       1},
+    {"_RClickhouse_listTables",                   (DL_FUNC) &_RClickhouse_listTables,                   2},
+    {"_RClickhouse_metadataCache",                (DL_FUNC) &_RClickhouse_metadataCache,                2},
+    {"_RClickhouse_ping",                         (DL_FUNC) &_RClickhouse_ping,                         1},
+    {"_RClickhouse_prepareForks",                 (DL_FUNC) &_RClickhouse_prepareForks,                 2},
+    {"_RClickhouse_prepareInsert",                (DL_FUNC) &_RClickhouse_prepareInsert,                6},
     {"_RClickhouse_RcppExport_registerCCallable", (DL_FUNC) &_RClickhouse_RcppExport_registerCCallable, 0},
+    {"_RClickhouse_readNativeFile",               (DL_FUNC) &_RClickhouse_readNativeFile,               10},
+    {"_RClickhouse_rebindResult",                 (DL_FUNC) &_RClickhouse_rebindResult,                 2},
+    {"_RClickhouse_resultBytes",                  (DL_FUNC) &_RClickhouse_resultBytes,                  1},
+    {"_RClickhouse_resultCache",                  (DL_FUNC) &_RClickhouse_resultCache,                  2},
+    {"_RClickhouse_resultMemory",                 (DL_FUNC) &_RClickhouse_resultMemory,                 1},
     {"_RClickhouse_resultTypes",                  (DL_FUNC) &_RClickhouse_resultTypes,                  1},
-    {"_RClickhouse_select",                       (DL_FUNC) &_RClickhouse_select,                       2},
+    {"_RClickhouse_select",                       (DL_FUNC) &_RClickhouse_select,                       31},
+    {"_RClickhouse_selectShards",                 (DL_FUNC) &_RClickhouse_selectShards,                 14},
+    {"_RClickhouse_selectToFile",                 (DL_FUNC) &_RClickhouse_selectToFile,                 7},
+    {"_RClickhouse_shardOf",                      (DL_FUNC) &_RClickhouse_shardOf,                      4},
+    {"_RClickhouse_streamBlocks",                 (DL_FUNC) &_RClickhouse_streamBlocks,                 6},
+    {"_RClickhouse_tableColumns",                 (DL_FUNC) &_RClickhouse_tableColumns,                 3},
+    {"_RClickhouse_threadPool",                   (DL_FUNC) &_RClickhouse_threadPool,                   1},
     {"_RClickhouse_validPtr",                     (DL_FUNC) &_RClickhouse_validPtr,                     1},
     {NULL, NULL, 0}
 };
 
+/* ALTREP classes of lazily converted columns, see lazy.cpp */
+extern void initLazyColumns(DllInfo *dll);
+
+/* the C interface for other packages, see api.cpp */
+extern void initApi(DllInfo *dll);
+
 void R_init_RClickhouse(DllInfo *dll)
 {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    initLazyColumns(dll);
+    initApi(dll);
 }
 
@@ -9,21 +9,128 @@
 using namespace Rcpp;
 
 // fetch
-DataFrame fetch(XPtr<Result> res, ssize_t n);
-static SEXP _RClickhouse_fetch_try(SEXP resSEXP, SEXP nSEXP) {
+DataFrame fetch(XPtr<Result> res, ssize_t n, bool wait, bool lazy);
+static SEXP _RClickhouse_fetch_try(SEXP resSEXP, SEXP nSEXP, SEXP waitSEXP, SEXP lazySEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
     Rcpp::traits::input_parameter< ssize_t >::type n(nSEXP);
-    rcpp_result_gen = Rcpp::wrap(fetch(res, n));
+    Rcpp::traits::input_parameter< bool >::type wait(waitSEXP);
+    Rcpp::traits::input_parameter< bool >::type lazy(lazySEXP);
+    rcpp_result_gen = Rcpp::wrap(fetch(res, n, wait, lazy));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _RClickhouse_fetch(SEXP resSEXP, SEXP nSEXP) {
+RcppExport SEXP _RClickhouse_fetch(SEXP resSEXP, SEXP nSEXP, SEXP waitSEXP, SEXP lazySEXP) {
     SEXP rcpp_result_gen;
     {
         Rcpp::RNGScope rcpp_rngScope_gen;
-        rcpp_result_gen = PROTECT(_RClickhouse_fetch_try(resSEXP, nSEXP));
+        rcpp_result_gen = PROTECT(_RClickhouse_fetch_try(resSEXP, nSEXP, waitSEXP, lazySEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// accumulate
+double accumulate(XPtr<Result> res, ssize_t n, bool wait);
+static SEXP _RClickhouse_accumulate_try(SEXP resSEXP, SEXP nSEXP, SEXP waitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    Rcpp::traits::input_parameter< ssize_t >::type n(nSEXP);
+    Rcpp::traits::input_parameter< bool >::type wait(waitSEXP);
+    rcpp_result_gen = Rcpp::wrap(accumulate(res, n, wait));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_accumulate(SEXP resSEXP, SEXP nSEXP, SEXP waitSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_accumulate_try(resSEXP, nSEXP, waitSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// accumulated
+DataFrame accumulated(XPtr<Result> res);
+static SEXP _RClickhouse_accumulated_try(SEXP resSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    rcpp_result_gen = Rcpp::wrap(accumulated(res));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_accumulated(SEXP resSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_accumulated_try(resSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// fetchArrow
+void fetchArrow(XPtr<Result> res, ssize_t n, SEXP stream);
+static SEXP _RClickhouse_fetchArrow_try(SEXP resSEXP, SEXP nSEXP, SEXP streamSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    Rcpp::traits::input_parameter< ssize_t >::type n(nSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stream(streamSEXP);
+    fetchArrow(res, n, stream);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_fetchArrow(SEXP resSEXP, SEXP nSEXP, SEXP streamSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_fetchArrow_try(resSEXP, nSEXP, streamSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -178,6 +285,143 @@ RcppExport SEXP _RClickhouse_getRowsAffected(SEXP resSEXP) {
     UNPROTECT(1);
     return rcpp_result_gen;
 }
+// getProgress
+List getProgress(XPtr<Result> res);
+static SEXP _RClickhouse_getProgress_try(SEXP resSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    rcpp_result_gen = Rcpp::wrap(getProgress(res));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_getProgress(SEXP resSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_getProgress_try(resSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// getQueryId
+String getQueryId(XPtr<Result> res);
+static SEXP _RClickhouse_getQueryId_try(SEXP resSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    rcpp_result_gen = Rcpp::wrap(getQueryId(res));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_getQueryId(SEXP resSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_getQueryId_try(resSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// getStats
+DataFrame getStats(XPtr<Result> res);
+static SEXP _RClickhouse_getStats_try(SEXP resSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    rcpp_result_gen = Rcpp::wrap(getStats(res));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_getStats(SEXP resSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_getStats_try(resSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// getTrace
+std::string getTrace(XPtr<Result> res, int pid);
+static SEXP _RClickhouse_getTrace_try(SEXP resSEXP, SEXP pidSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    Rcpp::traits::input_parameter< int >::type pid(pidSEXP);
+    rcpp_result_gen = Rcpp::wrap(getTrace(res, pid));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_getTrace(SEXP resSEXP, SEXP pidSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_getTrace_try(resSEXP, pidSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
 // getStatement
 std::string getStatement(XPtr<Result> res);
 static SEXP _RClickhouse_getStatement_try(SEXP resSEXP) {
@@ -247,25 +491,29 @@ RcppExport SEXP _RClickhouse_resultTypes(SEXP resSEXP) {
     return rcpp_result_gen;
 }
 // connect
-XPtr<Client> connect(String host, int port, String db, String user, String password, String compression);
-static SEXP _RClickhouse_connect_try(SEXP hostSEXP, SEXP portSEXP, SEXP dbSEXP, SEXP userSEXP, SEXP passwordSEXP, SEXP compressionSEXP) {
+XPtr<Client> connect(std::string host, int port, String db, String user, String password, String compression, double timeout, std::string loadBalancing, bool reuse, bool trace);
+static SEXP _RClickhouse_connect_try(SEXP hostSEXP, SEXP portSEXP, SEXP dbSEXP, SEXP userSEXP, SEXP passwordSEXP, SEXP compressionSEXP, SEXP timeoutSEXP, SEXP loadBalancingSEXP, SEXP reuseSEXP, SEXP traceSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
-    Rcpp::traits::input_parameter< String >::type host(hostSEXP);
+    Rcpp::traits::input_parameter< std::string >::type host(hostSEXP);
     Rcpp::traits::input_parameter< int >::type port(portSEXP);
     Rcpp::traits::input_parameter< String >::type db(dbSEXP);
     Rcpp::traits::input_parameter< String >::type user(userSEXP);
     Rcpp::traits::input_parameter< String >::type password(passwordSEXP);
     Rcpp::traits::input_parameter< String >::type compression(compressionSEXP);
-    rcpp_result_gen = Rcpp::wrap(connect(host, port, db, user, password, compression));
+    Rcpp::traits::input_parameter< double >::type timeout(timeoutSEXP);
+    Rcpp::traits::input_parameter< std::string >::type loadBalancing(loadBalancingSEXP);
+    Rcpp::traits::input_parameter< bool >::type reuse(reuseSEXP);
+    Rcpp::traits::input_parameter< bool >::type trace(traceSEXP);
+    rcpp_result_gen = Rcpp::wrap(connect(host, port, db, user, password, compression, timeout, loadBalancing, reuse, trace));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _RClickhouse_connect(SEXP hostSEXP, SEXP portSEXP, SEXP dbSEXP, SEXP userSEXP, SEXP passwordSEXP, SEXP compressionSEXP) {
+RcppExport SEXP _RClickhouse_connect(SEXP hostSEXP, SEXP portSEXP, SEXP dbSEXP, SEXP userSEXP, SEXP passwordSEXP, SEXP compressionSEXP, SEXP timeoutSEXP, SEXP loadBalancingSEXP, SEXP reuseSEXP, SEXP traceSEXP) {
     SEXP rcpp_result_gen;
     {
         Rcpp::RNGScope rcpp_rngScope_gen;
-        rcpp_result_gen = PROTECT(_RClickhouse_connect_try(hostSEXP, portSEXP, dbSEXP, userSEXP, passwordSEXP, compressionSEXP));
+        rcpp_result_gen = PROTECT(_RClickhouse_connect_try(hostSEXP, portSEXP, dbSEXP, userSEXP, passwordSEXP, compressionSEXP, timeoutSEXP, loadBalancingSEXP, reuseSEXP, traceSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -285,20 +533,22 @@ RcppExport SEXP _RClickhouse_connect(SEXP hostSEXP, SEXP portSEXP, SEXP dbSEXP,
     UNPROTECT(1);
     return rcpp_result_gen;
 }
-// disconnect
-void disconnect(XPtr<Client> conn);
-static SEXP _RClickhouse_disconnect_try(SEXP connSEXP) {
+// connectionTrace
+std::string connectionTrace(XPtr<Client> conn, int pid);
+static SEXP _RClickhouse_connectionTrace_try(SEXP connSEXP, SEXP pidSEXP) {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
-    disconnect(conn);
-    return R_NilValue;
+    Rcpp::traits::input_parameter< int >::type pid(pidSEXP);
+    rcpp_result_gen = Rcpp::wrap(connectionTrace(conn, pid));
+    return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _RClickhouse_disconnect(SEXP connSEXP) {
+RcppExport SEXP _RClickhouse_connectionTrace(SEXP connSEXP, SEXP pidSEXP) {
     SEXP rcpp_result_gen;
     {
         Rcpp::RNGScope rcpp_rngScope_gen;
-        rcpp_result_gen = PROTECT(_RClickhouse_disconnect_try(connSEXP));
+        rcpp_result_gen = PROTECT(_RClickhouse_connectionTrace_try(connSEXP, pidSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -318,22 +568,21 @@ RcppExport SEXP _RClickhouse_disconnect(SEXP connSEXP) {
     UNPROTECT(1);
     return rcpp_result_gen;
 }
-// select
-XPtr<Result> select(XPtr<Client> conn, String query);
-static SEXP _RClickhouse_select_try(SEXP connSEXP, SEXP querySEXP) {
+// currentEndpoint
+List currentEndpoint(XPtr<Client> conn);
+static SEXP _RClickhouse_currentEndpoint_try(SEXP connSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
-    Rcpp::traits::input_parameter< String >::type query(querySEXP);
-    rcpp_result_gen = Rcpp::wrap(select(conn, query));
+    rcpp_result_gen = Rcpp::wrap(currentEndpoint(conn));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _RClickhouse_select(SEXP connSEXP, SEXP querySEXP) {
+RcppExport SEXP _RClickhouse_currentEndpoint(SEXP connSEXP) {
     SEXP rcpp_result_gen;
     {
         Rcpp::RNGScope rcpp_rngScope_gen;
-        rcpp_result_gen = PROTECT(_RClickhouse_select_try(connSEXP, querySEXP));
+        rcpp_result_gen = PROTECT(_RClickhouse_currentEndpoint_try(connSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -353,22 +602,1169 @@ RcppExport SEXP _RClickhouse_select(SEXP connSEXP, SEXP querySEXP) {
     UNPROTECT(1);
     return rcpp_result_gen;
 }
-// insert
-void insert(XPtr<Client> conn, String tableName, DataFrame df);
-static SEXP _RClickhouse_insert_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP) {
+// isIdle
+bool isIdle(XPtr<Client> conn);
+static SEXP _RClickhouse_isIdle_try(SEXP connSEXP) {
 BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
-    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
-    Rcpp::traits::input_parameter< DataFrame >::type df(dfSEXP);
-    insert(conn, tableName, df);
+    rcpp_result_gen = Rcpp::wrap(isIdle(conn));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_isIdle(SEXP connSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_isIdle_try(connSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// ping
+void ping(XPtr<Client> conn);
+static SEXP _RClickhouse_ping_try(SEXP connSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    ping(conn);
     return R_NilValue;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _RClickhouse_insert(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP) {
+RcppExport SEXP _RClickhouse_ping(SEXP connSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_ping_try(connSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// prepareForks
+void prepareForks(XPtr<Client> conn, int count);
+static SEXP _RClickhouse_prepareForks_try(SEXP connSEXP, SEXP countSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< int >::type count(countSEXP);
+    prepareForks(conn, count);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_prepareForks(SEXP connSEXP, SEXP countSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_prepareForks_try(connSEXP, countSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// disconnect
+void disconnect(XPtr<Client> conn);
+static SEXP _RClickhouse_disconnect_try(SEXP connSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    disconnect(conn);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_disconnect(SEXP connSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_disconnect_try(connSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// select
+XPtr<Result> select(XPtr<Client> conn, String query, bool stream, bool async, std::string int64, std::string uint32, int threads, bool exactDecimal, std::string uuid, bool flatArrays, bool ipAsText, bool utf8, RObject progress, double progressInterval, std::vector<std::string> settingNames, std::vector<std::string> settingValues, std::string queryId, std::vector<std::string> externalNames, List externalTables, List externalTypes, double memoryBudget, double memoryLimit, bool memoryCompression, std::string spillPath, bool spillCompression, double cacheTTL, std::string cacheScope, std::vector<std::string> columns, std::vector<std::string> paramNames, CharacterVector paramValues, double maxRows);
+static SEXP _RClickhouse_select_try(SEXP connSEXP, SEXP querySEXP, SEXP streamSEXP, SEXP asyncSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP, SEXP progressSEXP, SEXP progressIntervalSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP, SEXP externalNamesSEXP, SEXP externalTablesSEXP, SEXP externalTypesSEXP, SEXP memoryBudgetSEXP, SEXP memoryLimitSEXP, SEXP memoryCompressionSEXP, SEXP spillPathSEXP, SEXP spillCompressionSEXP, SEXP cacheTTLSEXP, SEXP cacheScopeSEXP, SEXP columnsSEXP, SEXP paramNamesSEXP, SEXP paramValuesSEXP, SEXP maxRowsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type query(querySEXP);
+    Rcpp::traits::input_parameter< bool >::type stream(streamSEXP);
+    Rcpp::traits::input_parameter< bool >::type async(asyncSEXP);
+    Rcpp::traits::input_parameter< std::string >::type int64(int64SEXP);
+    Rcpp::traits::input_parameter< std::string >::type uint32(uint32SEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type exactDecimal(exactDecimalSEXP);
+    Rcpp::traits::input_parameter< std::string >::type uuid(uuidSEXP);
+    Rcpp::traits::input_parameter< bool >::type flatArrays(flatArraysSEXP);
+    Rcpp::traits::input_parameter< bool >::type ipAsText(ipAsTextSEXP);
+    Rcpp::traits::input_parameter< bool >::type utf8(utf8SEXP);
+    Rcpp::traits::input_parameter< RObject >::type progress(progressSEXP);
+    Rcpp::traits::input_parameter< double >::type progressInterval(progressIntervalSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingNames(settingNamesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingValues(settingValuesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type queryId(queryIdSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type externalNames(externalNamesSEXP);
+    Rcpp::traits::input_parameter< List >::type externalTables(externalTablesSEXP);
+    Rcpp::traits::input_parameter< List >::type externalTypes(externalTypesSEXP);
+    Rcpp::traits::input_parameter< double >::type memoryBudget(memoryBudgetSEXP);
+    Rcpp::traits::input_parameter< double >::type memoryLimit(memoryLimitSEXP);
+    Rcpp::traits::input_parameter< bool >::type memoryCompression(memoryCompressionSEXP);
+    Rcpp::traits::input_parameter< std::string >::type spillPath(spillPathSEXP);
+    Rcpp::traits::input_parameter< bool >::type spillCompression(spillCompressionSEXP);
+    Rcpp::traits::input_parameter< double >::type cacheTTL(cacheTTLSEXP);
+    Rcpp::traits::input_parameter< std::string >::type cacheScope(cacheScopeSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type paramNames(paramNamesSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type paramValues(paramValuesSEXP);
+    Rcpp::traits::input_parameter< double >::type maxRows(maxRowsSEXP);
+    rcpp_result_gen = Rcpp::wrap(select(conn, query, stream, async, int64, uint32, threads, exactDecimal, uuid, flatArrays, ipAsText, utf8, progress, progressInterval, settingNames, settingValues, queryId, externalNames, externalTables, externalTypes, memoryBudget, memoryLimit, memoryCompression, spillPath, spillCompression, cacheTTL, cacheScope, columns, paramNames, paramValues, maxRows));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_select(SEXP connSEXP, SEXP querySEXP, SEXP streamSEXP, SEXP asyncSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP, SEXP progressSEXP, SEXP progressIntervalSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP, SEXP externalNamesSEXP, SEXP externalTablesSEXP, SEXP externalTypesSEXP, SEXP memoryBudgetSEXP, SEXP memoryLimitSEXP, SEXP memoryCompressionSEXP, SEXP spillPathSEXP, SEXP spillCompressionSEXP, SEXP cacheTTLSEXP, SEXP cacheScopeSEXP, SEXP columnsSEXP, SEXP paramNamesSEXP, SEXP paramValuesSEXP, SEXP maxRowsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_select_try(connSEXP, querySEXP, streamSEXP, asyncSEXP, int64SEXP, uint32SEXP, threadsSEXP, exactDecimalSEXP, uuidSEXP, flatArraysSEXP, ipAsTextSEXP, utf8SEXP, progressSEXP, progressIntervalSEXP, settingNamesSEXP, settingValuesSEXP, queryIdSEXP, externalNamesSEXP, externalTablesSEXP, externalTypesSEXP, memoryBudgetSEXP, memoryLimitSEXP, memoryCompressionSEXP, spillPathSEXP, spillCompressionSEXP, cacheTTLSEXP, cacheScopeSEXP, columnsSEXP, paramNamesSEXP, paramValuesSEXP, maxRowsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// selectShards
+XPtr<Result> selectShards(List conns, std::vector<std::string> queries, bool ordered, std::string int64, std::string uint32, int threads, bool exactDecimal, std::string uuid, bool flatArrays, bool ipAsText, bool utf8, std::vector<std::string> settingNames, std::vector<std::string> settingValues, std::string queryId);
+static SEXP _RClickhouse_selectShards_try(SEXP connsSEXP, SEXP queriesSEXP, SEXP orderedSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< List >::type conns(connsSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type queries(queriesSEXP);
+    Rcpp::traits::input_parameter< bool >::type ordered(orderedSEXP);
+    Rcpp::traits::input_parameter< std::string >::type int64(int64SEXP);
+    Rcpp::traits::input_parameter< std::string >::type uint32(uint32SEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type exactDecimal(exactDecimalSEXP);
+    Rcpp::traits::input_parameter< std::string >::type uuid(uuidSEXP);
+    Rcpp::traits::input_parameter< bool >::type flatArrays(flatArraysSEXP);
+    Rcpp::traits::input_parameter< bool >::type ipAsText(ipAsTextSEXP);
+    Rcpp::traits::input_parameter< bool >::type utf8(utf8SEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingNames(settingNamesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingValues(settingValuesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type queryId(queryIdSEXP);
+    rcpp_result_gen = Rcpp::wrap(selectShards(conns, queries, ordered, int64, uint32, threads, exactDecimal, uuid, flatArrays, ipAsText, utf8, settingNames, settingValues, queryId));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_selectShards(SEXP connsSEXP, SEXP queriesSEXP, SEXP orderedSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_selectShards_try(connsSEXP, queriesSEXP, orderedSEXP, int64SEXP, uint32SEXP, threadsSEXP, exactDecimalSEXP, uuidSEXP, flatArraysSEXP, ipAsTextSEXP, utf8SEXP, settingNamesSEXP, settingValuesSEXP, queryIdSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// resultCache
+List resultCache(double capacity, bool clear);
+static SEXP _RClickhouse_resultCache_try(SEXP capacitySEXP, SEXP clearSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< double >::type capacity(capacitySEXP);
+    Rcpp::traits::input_parameter< bool >::type clear(clearSEXP);
+    rcpp_result_gen = Rcpp::wrap(resultCache(capacity, clear));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_resultCache(SEXP capacitySEXP, SEXP clearSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_resultCache_try(capacitySEXP, clearSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// resultMemory
+List resultMemory(double limit);
+static SEXP _RClickhouse_resultMemory_try(SEXP limitSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< double >::type limit(limitSEXP);
+    rcpp_result_gen = Rcpp::wrap(resultMemory(limit));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_resultMemory(SEXP limitSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_resultMemory_try(limitSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// threadPool
+List threadPool(int threads);
+static SEXP _RClickhouse_threadPool_try(SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(threadPool(threads));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_threadPool(SEXP threadsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_threadPool_try(threadsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// rebindResult
+void rebindResult(XPtr<Result> res, XPtr<Result> next);
+static SEXP _RClickhouse_rebindResult_try(SEXP resSEXP, SEXP nextSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    Rcpp::traits::input_parameter< XPtr<Result> >::type next(nextSEXP);
+    rebindResult(res, next);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_rebindResult(SEXP resSEXP, SEXP nextSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_rebindResult_try(resSEXP, nextSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// resultBytes
+double resultBytes(XPtr<Result> res);
+static SEXP _RClickhouse_resultBytes_try(SEXP resSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Result> >::type res(resSEXP);
+    rcpp_result_gen = Rcpp::wrap(resultBytes(res));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_resultBytes(SEXP resSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_resultBytes_try(resSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// listTables
+CharacterVector listTables(XPtr<Client> conn, double ttl);
+static SEXP _RClickhouse_listTables_try(SEXP connSEXP, SEXP ttlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< double >::type ttl(ttlSEXP);
+    rcpp_result_gen = Rcpp::wrap(listTables(conn, ttl));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_listTables(SEXP connSEXP, SEXP ttlSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_listTables_try(connSEXP, ttlSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// tableColumns
+List tableColumns(XPtr<Client> conn, std::string table, double ttl);
+static SEXP _RClickhouse_tableColumns_try(SEXP connSEXP, SEXP tableSEXP, SEXP ttlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< std::string >::type table(tableSEXP);
+    Rcpp::traits::input_parameter< double >::type ttl(ttlSEXP);
+    rcpp_result_gen = Rcpp::wrap(tableColumns(conn, table, ttl));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_tableColumns(SEXP connSEXP, SEXP tableSEXP, SEXP ttlSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_tableColumns_try(connSEXP, tableSEXP, ttlSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// metadataCache
+List metadataCache(XPtr<Client> conn, bool clear);
+static SEXP _RClickhouse_metadataCache_try(SEXP connSEXP, SEXP clearSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< bool >::type clear(clearSEXP);
+    rcpp_result_gen = Rcpp::wrap(metadataCache(conn, clear));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_metadataCache(SEXP connSEXP, SEXP clearSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_metadataCache_try(connSEXP, clearSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// selectToFile
+double selectToFile(XPtr<Client> conn, String query, std::string path, bool compress, std::vector<std::string> settingNames, std::vector<std::string> settingValues, std::string queryId);
+static SEXP _RClickhouse_selectToFile_try(SEXP connSEXP, SEXP querySEXP, SEXP pathSEXP, SEXP compressSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type query(querySEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< bool >::type compress(compressSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingNames(settingNamesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingValues(settingValuesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type queryId(queryIdSEXP);
+    rcpp_result_gen = Rcpp::wrap(selectToFile(conn, query, path, compress, settingNames, settingValues, queryId));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_selectToFile(SEXP connSEXP, SEXP querySEXP, SEXP pathSEXP, SEXP compressSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_selectToFile_try(connSEXP, querySEXP, pathSEXP, compressSEXP, settingNamesSEXP, settingValuesSEXP, queryIdSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// streamBlocks
+double streamBlocks(XPtr<Client> conn, String query, SEXP callback, std::vector<std::string> settingNames, std::vector<std::string> settingValues, std::string queryId);
+static SEXP _RClickhouse_streamBlocks_try(SEXP connSEXP, SEXP querySEXP, SEXP callbackSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type query(querySEXP);
+    Rcpp::traits::input_parameter< SEXP >::type callback(callbackSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingNames(settingNamesSEXP);
+    Rcpp::traits::input_parameter< std::vector<std::string> >::type settingValues(settingValuesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type queryId(queryIdSEXP);
+    rcpp_result_gen = Rcpp::wrap(streamBlocks(conn, query, callback, settingNames, settingValues, queryId));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_streamBlocks(SEXP connSEXP, SEXP querySEXP, SEXP callbackSEXP, SEXP settingNamesSEXP, SEXP settingValuesSEXP, SEXP queryIdSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_streamBlocks_try(connSEXP, querySEXP, callbackSEXP, settingNamesSEXP, settingValuesSEXP, queryIdSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// readNativeFile
+XPtr<Result> readNativeFile(std::string path, bool compressed, std::string int64, std::string uint32, int threads, bool exactDecimal, std::string uuid, bool flatArrays, bool ipAsText, bool utf8);
+static SEXP _RClickhouse_readNativeFile_try(SEXP pathSEXP, SEXP compressedSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< bool >::type compressed(compressedSEXP);
+    Rcpp::traits::input_parameter< std::string >::type int64(int64SEXP);
+    Rcpp::traits::input_parameter< std::string >::type uint32(uint32SEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type exactDecimal(exactDecimalSEXP);
+    Rcpp::traits::input_parameter< std::string >::type uuid(uuidSEXP);
+    Rcpp::traits::input_parameter< bool >::type flatArrays(flatArraysSEXP);
+    Rcpp::traits::input_parameter< bool >::type ipAsText(ipAsTextSEXP);
+    Rcpp::traits::input_parameter< bool >::type utf8(utf8SEXP);
+    rcpp_result_gen = Rcpp::wrap(readNativeFile(path, compressed, int64, uint32, threads, exactDecimal, uuid, flatArrays, ipAsText, utf8));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_readNativeFile(SEXP pathSEXP, SEXP compressedSEXP, SEXP int64SEXP, SEXP uint32SEXP, SEXP threadsSEXP, SEXP exactDecimalSEXP, SEXP uuidSEXP, SEXP flatArraysSEXP, SEXP ipAsTextSEXP, SEXP utf8SEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_readNativeFile_try(pathSEXP, compressedSEXP, int64SEXP, uint32SEXP, threadsSEXP, exactDecimalSEXP, uuidSEXP, flatArraysSEXP, ipAsTextSEXP, utf8SEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// insert
+void insert(XPtr<Client> conn, String tableName, DataFrame df, double blockSize, int threads);
+static SEXP _RClickhouse_insert_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP, SEXP blockSizeSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type df(dfSEXP);
+    Rcpp::traits::input_parameter< double >::type blockSize(blockSizeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    insert(conn, tableName, df, blockSize, threads);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_insert(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP, SEXP blockSizeSEXP, SEXP threadsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_insert_try(connSEXP, tableNameSEXP, dfSEXP, blockSizeSEXP, threadsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// insertChunks
+double insertChunks(XPtr<Client> conn, String tableName, DataFrame df, double chunkRows, int threads, std::string token, int retries, double backoff, double skip);
+static SEXP _RClickhouse_insertChunks_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP, SEXP chunkRowsSEXP, SEXP threadsSEXP, SEXP tokenSEXP, SEXP retriesSEXP, SEXP backoffSEXP, SEXP skipSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type df(dfSEXP);
+    Rcpp::traits::input_parameter< double >::type chunkRows(chunkRowsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type token(tokenSEXP);
+    Rcpp::traits::input_parameter< int >::type retries(retriesSEXP);
+    Rcpp::traits::input_parameter< double >::type backoff(backoffSEXP);
+    Rcpp::traits::input_parameter< double >::type skip(skipSEXP);
+    rcpp_result_gen = Rcpp::wrap(insertChunks(conn, tableName, df, chunkRows, threads, token, retries, backoff, skip));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_insertChunks(SEXP connSEXP, SEXP tableNameSEXP, SEXP dfSEXP, SEXP chunkRowsSEXP, SEXP threadsSEXP, SEXP tokenSEXP, SEXP retriesSEXP, SEXP backoffSEXP, SEXP skipSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_insertChunks_try(connSEXP, tableNameSEXP, dfSEXP, chunkRowsSEXP, threadsSEXP, tokenSEXP, retriesSEXP, backoffSEXP, skipSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// insertFile
+double insertFile(XPtr<Client> conn, String tableName, StringVector names, std::string path, std::string format, std::string delimiter, bool header, double blockSize);
+static SEXP _RClickhouse_insertFile_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP pathSEXP, SEXP formatSEXP, SEXP delimiterSEXP, SEXP headerSEXP, SEXP blockSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
+    Rcpp::traits::input_parameter< StringVector >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< std::string >::type format(formatSEXP);
+    Rcpp::traits::input_parameter< std::string >::type delimiter(delimiterSEXP);
+    Rcpp::traits::input_parameter< bool >::type header(headerSEXP);
+    Rcpp::traits::input_parameter< double >::type blockSize(blockSizeSEXP);
+    rcpp_result_gen = Rcpp::wrap(insertFile(conn, tableName, names, path, format, delimiter, header, blockSize));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_insertFile(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP pathSEXP, SEXP formatSEXP, SEXP delimiterSEXP, SEXP headerSEXP, SEXP blockSizeSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_insertFile_try(connSEXP, tableNameSEXP, namesSEXP, pathSEXP, formatSEXP, delimiterSEXP, headerSEXP, blockSizeSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// prepareInsert
+XPtr<PreparedInsert> prepareInsert(XPtr<Client> conn, String tableName, StringVector names, int threads, double queueSize, bool failWhenFull);
+static SEXP _RClickhouse_prepareInsert_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP threadsSEXP, SEXP queueSizeSEXP, SEXP failWhenFullSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
+    Rcpp::traits::input_parameter< StringVector >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type queueSize(queueSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type failWhenFull(failWhenFullSEXP);
+    rcpp_result_gen = Rcpp::wrap(prepareInsert(conn, tableName, names, threads, queueSize, failWhenFull));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_prepareInsert(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP threadsSEXP, SEXP queueSizeSEXP, SEXP failWhenFullSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_prepareInsert_try(connSEXP, tableNameSEXP, namesSEXP, threadsSEXP, queueSizeSEXP, failWhenFullSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// appendInsert
+void appendInsert(XPtr<PreparedInsert> ins, DataFrame df, double blockSize);
+static SEXP _RClickhouse_appendInsert_try(SEXP insSEXP, SEXP dfSEXP, SEXP blockSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<PreparedInsert> >::type ins(insSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type df(dfSEXP);
+    Rcpp::traits::input_parameter< double >::type blockSize(blockSizeSEXP);
+    appendInsert(ins, df, blockSize);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_appendInsert(SEXP insSEXP, SEXP dfSEXP, SEXP blockSizeSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_appendInsert_try(insSEXP, dfSEXP, blockSizeSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// flushInsert
+void flushInsert(XPtr<PreparedInsert> ins);
+static SEXP _RClickhouse_flushInsert_try(SEXP insSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<PreparedInsert> >::type ins(insSEXP);
+    flushInsert(ins);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_flushInsert(SEXP insSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_flushInsert_try(insSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// closeInsert
+void closeInsert(XPtr<PreparedInsert> ins);
+static SEXP _RClickhouse_closeInsert_try(SEXP insSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<PreparedInsert> >::type ins(insSEXP);
+    closeInsert(ins);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_closeInsert(SEXP insSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_closeInsert_try(insSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// insertTypes
+std::vector<std::string> insertTypes(XPtr<PreparedInsert> ins);
+static SEXP _RClickhouse_insertTypes_try(SEXP insSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<PreparedInsert> >::type ins(insSEXP);
+    rcpp_result_gen = Rcpp::wrap(insertTypes(ins));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_insertTypes(SEXP insSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_insertTypes_try(insSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// cancelInsert
+void cancelInsert(XPtr<PreparedInsert> ins);
+static SEXP _RClickhouse_cancelInsert_try(SEXP insSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<PreparedInsert> >::type ins(insSEXP);
+    cancelInsert(ins);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_cancelInsert(SEXP insSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_cancelInsert_try(insSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// bufferInsert
+XPtr<BufferedInsert> bufferInsert(XPtr<Client> conn, String tableName, StringVector names, int threads, double maxRows, double maxBytes, double maxAge);
+static SEXP _RClickhouse_bufferInsert_try(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP threadsSEXP, SEXP maxRowsSEXP, SEXP maxBytesSEXP, SEXP maxAgeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<Client> >::type conn(connSEXP);
+    Rcpp::traits::input_parameter< String >::type tableName(tableNameSEXP);
+    Rcpp::traits::input_parameter< StringVector >::type names(namesSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< double >::type maxRows(maxRowsSEXP);
+    Rcpp::traits::input_parameter< double >::type maxBytes(maxBytesSEXP);
+    Rcpp::traits::input_parameter< double >::type maxAge(maxAgeSEXP);
+    rcpp_result_gen = Rcpp::wrap(bufferInsert(conn, tableName, names, threads, maxRows, maxBytes, maxAge));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_bufferInsert(SEXP connSEXP, SEXP tableNameSEXP, SEXP namesSEXP, SEXP threadsSEXP, SEXP maxRowsSEXP, SEXP maxBytesSEXP, SEXP maxAgeSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_bufferInsert_try(connSEXP, tableNameSEXP, namesSEXP, threadsSEXP, maxRowsSEXP, maxBytesSEXP, maxAgeSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// appendBuffer
+void appendBuffer(XPtr<BufferedInsert> buf, DataFrame df);
+static SEXP _RClickhouse_appendBuffer_try(SEXP bufSEXP, SEXP dfSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<BufferedInsert> >::type buf(bufSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type df(dfSEXP);
+    appendBuffer(buf, df);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_appendBuffer(SEXP bufSEXP, SEXP dfSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_appendBuffer_try(bufSEXP, dfSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// flushBuffer
+void flushBuffer(XPtr<BufferedInsert> buf);
+static SEXP _RClickhouse_flushBuffer_try(SEXP bufSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< XPtr<BufferedInsert> >::type buf(bufSEXP);
+    flushBuffer(buf);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_flushBuffer(SEXP bufSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_flushBuffer_try(bufSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// closeBuffer
+void closeBuffer(SEXP ptr);
+static SEXP _RClickhouse_closeBuffer_try(SEXP ptrSEXP) {
+BEGIN_RCPP
+    Rcpp::traits::input_parameter< SEXP >::type ptr(ptrSEXP);
+    closeBuffer(ptr);
+    return R_NilValue;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_closeBuffer(SEXP ptrSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_closeBuffer_try(ptrSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// bufferStats
+List bufferStats(XPtr<BufferedInsert> buf);
+static SEXP _RClickhouse_bufferStats_try(SEXP bufSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< XPtr<BufferedInsert> >::type buf(bufSEXP);
+    rcpp_result_gen = Rcpp::wrap(bufferStats(buf));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_bufferStats(SEXP bufSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        Rcpp::RNGScope rcpp_rngScope_gen;
+        rcpp_result_gen = PROTECT(_RClickhouse_bufferStats_try(bufSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error(CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// shardOf
+IntegerVector shardOf(SEXP key, std::string type, std::vector<double> weights, std::string method);
+static SEXP _RClickhouse_shardOf_try(SEXP keySEXP, SEXP typeSEXP, SEXP weightsSEXP, SEXP methodSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP >::type key(keySEXP);
+    Rcpp::traits::input_parameter< std::string >::type type(typeSEXP);
+    Rcpp::traits::input_parameter< std::vector<double> >::type weights(weightsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    rcpp_result_gen = Rcpp::wrap(shardOf(key, type, weights, method));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _RClickhouse_shardOf(SEXP keySEXP, SEXP typeSEXP, SEXP weightsSEXP, SEXP methodSEXP) {
     SEXP rcpp_result_gen;
     {
         Rcpp::RNGScope rcpp_rngScope_gen;
-        rcpp_result_gen = PROTECT(_RClickhouse_insert_try(connSEXP, tableNameSEXP, dfSEXP));
+        rcpp_result_gen = PROTECT(_RClickhouse_shardOf_try(keySEXP, typeSEXP, weightsSEXP, methodSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -427,17 +1823,55 @@ RcppExport SEXP _RClickhouse_validPtr(SEXP ptrSEXP) {
 static int _RClickhouse_RcppExport_validate(const char* sig) { 
     static std::set<std::string> signatures;
     if (signatures.empty()) {
-        signatures.insert("DataFrame(*fetch)(XPtr<Result>,ssize_t)");
+        signatures.insert("DataFrame(*fetch)(XPtr<Result>,ssize_t,bool,bool)");
+        signatures.insert("double(*accumulate)(XPtr<Result>,ssize_t,bool)");
+        signatures.insert("DataFrame(*accumulated)(XPtr<Result>)");
+        signatures.insert("void(*fetchArrow)(XPtr<Result>,ssize_t,SEXP)");
         signatures.insert("void(*clearResult)(XPtr<Result>)");
         signatures.insert("bool(*hasCompleted)(XPtr<Result>)");
         signatures.insert("size_t(*getRowCount)(XPtr<Result>)");
         signatures.insert("size_t(*getRowsAffected)(XPtr<Result>)");
+        signatures.insert("List(*getProgress)(XPtr<Result>)");
+        signatures.insert("String(*getQueryId)(XPtr<Result>)");
+        signatures.insert("DataFrame(*getStats)(XPtr<Result>)");
+        signatures.insert("std::string(*getTrace)(XPtr<Result>,int)");
         signatures.insert("std::string(*getStatement)(XPtr<Result>)");
         signatures.insert("std::vector<std::string>(*resultTypes)(XPtr<Result>)");
-        signatures.insert("XPtr<Client>(*connect)(String,int,String,String,String,String)");
+        signatures.insert("XPtr<Client>(*connect)(std::string,int,String,String,String,String,double,std::string,bool,bool)");
+        signatures.insert("std::string(*connectionTrace)(XPtr<Client>,int)");
+        signatures.insert("List(*currentEndpoint)(XPtr<Client>)");
+        signatures.insert("bool(*isIdle)(XPtr<Client>)");
+        signatures.insert("void(*ping)(XPtr<Client>)");
+        signatures.insert("void(*prepareForks)(XPtr<Client>,int)");
         signatures.insert("void(*disconnect)(XPtr<Client>)");
-        signatures.insert("XPtr<Result>(*select)(XPtr<Client>,String)");
-        signatures.insert("void(*insert)(XPtr<Client>,String,DataFrame)");
+        signatures.insert("XPtr<Result>(*select)(XPtr<Client>,String,bool,bool,std::string,std::string,int,bool,std::string,bool,bool,bool,RObject,double,std::vector<std::string>,std::vector<std::string>,std::string,std::vector<std::string>,List,List,double,double,bool,std::string,bool,double,std::string,std::vector<std::string>,std::vector<std::string>,CharacterVector,double)");
+        signatures.insert("XPtr<Result>(*selectShards)(List,std::vector<std::string>,bool,std::string,std::string,int,bool,std::string,bool,bool,bool,std::vector<std::string>,std::vector<std::string>,std::string)");
+        signatures.insert("List(*resultCache)(double,bool)");
+        signatures.insert("List(*resultMemory)(double)");
+        signatures.insert("List(*threadPool)(int)");
+        signatures.insert("void(*rebindResult)(XPtr<Result>,XPtr<Result>)");
+        signatures.insert("double(*resultBytes)(XPtr<Result>)");
+        signatures.insert("CharacterVector(*listTables)(XPtr<Client>,double)");
+        signatures.insert("List(*tableColumns)(XPtr<Client>,std::string,double)");
+        signatures.insert("List(*metadataCache)(XPtr<Client>,bool)");
+        signatures.insert("double(*selectToFile)(XPtr<Client>,String,std::string,bool,std::vector<std::string>,std::vector<std::string>,std::string)");
+        signatures.insert("double(*streamBlocks)(XPtr<Client>,String,SEXP,std::vector<std::string>,std::vector<std::string>,std::string)");
+        signatures.insert("XPtr<Result>(*readNativeFile)(std::string,bool,std::string,std::string,int,bool,std::string,bool,bool,bool)");
+        signatures.insert("void(*insert)(XPtr<Client>,String,DataFrame,double,int)");
+        signatures.insert("double(*insertChunks)(XPtr<Client>,String,DataFrame,double,int,std::string,int,double,double)");
+        signatures.insert("double(*insertFile)(XPtr<Client>,String,StringVector,std::string,std::string,std::string,bool,double)");
+        signatures.insert("XPtr<PreparedInsert>(*prepareInsert)(XPtr<Client>,String,StringVector,int,double,bool)");
+        signatures.insert("void(*appendInsert)(XPtr<PreparedInsert>,DataFrame,double)");
+        signatures.insert("void(*flushInsert)(XPtr<PreparedInsert>)");
+        signatures.insert("void(*closeInsert)(XPtr<PreparedInsert>)");
+        signatures.insert("std::vector<std::string>(*insertTypes)(XPtr<PreparedInsert>)");
+        signatures.insert("void(*cancelInsert)(XPtr<PreparedInsert>)");
+        signatures.insert("XPtr<BufferedInsert>(*bufferInsert)(XPtr<Client>,String,StringVector,int,double,double,double)");
+        signatures.insert("void(*appendBuffer)(XPtr<BufferedInsert>,DataFrame)");
+        signatures.insert("void(*flushBuffer)(XPtr<BufferedInsert>)");
+        signatures.insert("void(*closeBuffer)(SEXP)");
+        signatures.insert("List(*bufferStats)(XPtr<BufferedInsert>)");
+        signatures.insert("IntegerVector(*shardOf)(SEXP,std::string,std::vector<double>,std::string)");
         signatures.insert("bool(*validPtr)(SEXP)");
     }
     return signatures.find(sig) != signatures.end();
@@ -446,16 +1880,54 @@ static int _RClickhouse_RcppExport_validate(const char* sig) {
 // registerCCallable (register entry points for exported C++ functions)
 RcppExport SEXP _RClickhouse_RcppExport_registerCCallable() { 
     R_RegisterCCallable("RClickhouse", "_RClickhouse_fetch", (DL_FUNC)_RClickhouse_fetch_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_accumulate", (DL_FUNC)_RClickhouse_accumulate_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_accumulated", (DL_FUNC)_RClickhouse_accumulated_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_fetchArrow", (DL_FUNC)_RClickhouse_fetchArrow_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_clearResult", (DL_FUNC)_RClickhouse_clearResult_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_hasCompleted", (DL_FUNC)_RClickhouse_hasCompleted_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_getRowCount", (DL_FUNC)_RClickhouse_getRowCount_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_getRowsAffected", (DL_FUNC)_RClickhouse_getRowsAffected_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_getProgress", (DL_FUNC)_RClickhouse_getProgress_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_getQueryId", (DL_FUNC)_RClickhouse_getQueryId_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_getStats", (DL_FUNC)_RClickhouse_getStats_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_getTrace", (DL_FUNC)_RClickhouse_getTrace_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_getStatement", (DL_FUNC)_RClickhouse_getStatement_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_resultTypes", (DL_FUNC)_RClickhouse_resultTypes_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_connect", (DL_FUNC)_RClickhouse_connect_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_connectionTrace", (DL_FUNC)_RClickhouse_connectionTrace_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_currentEndpoint", (DL_FUNC)_RClickhouse_currentEndpoint_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_isIdle", (DL_FUNC)_RClickhouse_isIdle_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_ping", (DL_FUNC)_RClickhouse_ping_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_prepareForks", (DL_FUNC)_RClickhouse_prepareForks_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_disconnect", (DL_FUNC)_RClickhouse_disconnect_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_select", (DL_FUNC)_RClickhouse_select_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_selectShards", (DL_FUNC)_RClickhouse_selectShards_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_resultCache", (DL_FUNC)_RClickhouse_resultCache_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_resultMemory", (DL_FUNC)_RClickhouse_resultMemory_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_threadPool", (DL_FUNC)_RClickhouse_threadPool_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_rebindResult", (DL_FUNC)_RClickhouse_rebindResult_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_resultBytes", (DL_FUNC)_RClickhouse_resultBytes_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_listTables", (DL_FUNC)_RClickhouse_listTables_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_tableColumns", (DL_FUNC)_RClickhouse_tableColumns_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_metadataCache", (DL_FUNC)_RClickhouse_metadataCache_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_selectToFile", (DL_FUNC)_RClickhouse_selectToFile_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_streamBlocks", (DL_FUNC)_RClickhouse_streamBlocks_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_readNativeFile", (DL_FUNC)_RClickhouse_readNativeFile_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_insert", (DL_FUNC)_RClickhouse_insert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_insertChunks", (DL_FUNC)_RClickhouse_insertChunks_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_insertFile", (DL_FUNC)_RClickhouse_insertFile_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_prepareInsert", (DL_FUNC)_RClickhouse_prepareInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_appendInsert", (DL_FUNC)_RClickhouse_appendInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_flushInsert", (DL_FUNC)_RClickhouse_flushInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_closeInsert", (DL_FUNC)_RClickhouse_closeInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_insertTypes", (DL_FUNC)_RClickhouse_insertTypes_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_cancelInsert", (DL_FUNC)_RClickhouse_cancelInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_bufferInsert", (DL_FUNC)_RClickhouse_bufferInsert_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_appendBuffer", (DL_FUNC)_RClickhouse_appendBuffer_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_flushBuffer", (DL_FUNC)_RClickhouse_flushBuffer_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_closeBuffer", (DL_FUNC)_RClickhouse_closeBuffer_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_bufferStats", (DL_FUNC)_RClickhouse_bufferStats_try);
+    R_RegisterCCallable("RClickhouse", "_RClickhouse_shardOf", (DL_FUNC)_RClickhouse_shardOf_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_validPtr", (DL_FUNC)_RClickhouse_validPtr_try);
     R_RegisterCCallable("RClickhouse", "_RClickhouse_RcppExport_validate", (DL_FUNC)_RClickhouse_RcppExport_validate);
     return R_NilValue;
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include "insert.h"
+#include "result.h"
+#include "RClickhouse_api.h"
+
+// The C interface for other packages declared in inst/include/RClickhouse_api.h,
+// whose functions are registered with R_RegisterCCallable under their names.
+
+namespace {
+
+int apiVersion() {
+  return RCLICKHOUSE_API_VERSION;
+}
+
+RClickhouse_Connection *apiConnection(SEXP conn) {
+  if(IS_S4_OBJECT(conn)) {
+    conn = R_do_slot(conn, Rf_install("ptr"));
+  }
+  if(TYPEOF(conn) != EXTPTRSXP) {
+    return nullptr;
+  }
+  auto *client = static_cast<ch::Client *>(R_ExternalPtrAddr(conn));
+  if(!client || asyncResult(client) || PreparedInsert::sendingOn(client) || BufferedInsert::on(client) ||
+      client->IsStreaming() || client->IsInserting()) {
+    return nullptr;
+  }
+  return reinterpret_cast<RClickhouse_Connection *>(client);
+}
+
+void copyError(const char *message, char *error, size_t errorSize) {
+  if(error && errorSize > 0) {
+    const size_t n = std::min(std::strlen(message), errorSize-1);
+    std::memcpy(error, message, n);
+    error[n] = '\0';
+  }
+}
+
+int apiSelect(RClickhouse_Connection *conn, const char *query, RClickhouse_BlockCallback callback,
+    void *data, char *error, size_t errorSize) {
+  if(!conn || !query || !callback) {
+    copyError("the connection, query and callback must not be NULL", error, errorSize);
+    return 1;
+  }
+  auto *client = reinterpret_cast<ch::Client *>(conn);
+  // errors of the export cancel the query, so that the connection remains
+  // usable, and are reported once it is done
+  std::string exportError;
+  try {
+    client->Execute(ch::Query(query)
+        .OnDataCancelable([callback, data, &exportError] (const ch::Block &block) {
+          if(block.GetRowCount() == 0) {
+            return true;
+          }
+          ArrowSchema schema;
+          ArrowArray array;
+          try {
+            exportBlock(block, &schema, &array);
+          } catch(const std::exception &e) {
+            exportError = e.what();
+            return false;
+          }
+          const int status = callback(&schema, &array, data);
+          schema.release(&schema);
+          return status == 0;
+        }));
+  } catch(const std::exception &e) {
+    copyError(e.what(), error, errorSize);
+    return 1;
+  } catch(...) {
+    copyError("unknown error", error, errorSize);
+    return 1;
+  }
+  if(!exportError.empty()) {
+    copyError(exportError.c_str(), error, errorSize);
+    return 1;
+  }
+  return 0;
+}
+
+}
+
+// register the functions of the C interface, called when the package is
+// loaded
+extern "C" void initApi(DllInfo *) {
+  R_RegisterCCallable("RClickhouse", "RClickhouse_apiVersion", (DL_FUNC) apiVersion);
+  R_RegisterCCallable("RClickhouse", "RClickhouse_connection", (DL_FUNC) apiConnection);
+  R_RegisterCCallable("RClickhouse", "RClickhouse_select", (DL_FUNC) apiSelect);
+}
@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <map>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "arrow.h"
+#include "result.h"
+
+// Export of results as Arrow record batches: the arrays of a batch refer to
+// the buffers of the columns received, which are kept alive until the
+// consumer releases the arrays, so that numbers and the characters of strings
+// are not copied; only the buffers Arrow lays out differently (validity
+// bitmaps, offsets beginning with 0, widened dates and times, enum indices)
+// are built, once per block. Nothing here touches R, so the consumer may read
+// the stream from any thread.
+
+namespace {
+
+// substitute for the buffers of empty columns, which must not be null
+const int64_t emptyBuffer[1] = {0};
+
+const void *nonEmpty(const void *buffer) {
+  return buffer ? buffer : emptyBuffer;
+}
+
+// the strings of a schema and its children, released with it
+struct SchemaData {
+  std::string format, name;
+  std::vector<ArrowSchema> children;
+  std::vector<ArrowSchema *> childPtrs;
+  std::unique_ptr<ArrowSchema> dictionary;
+
+  // also releases the children which have been exported before an error
+  ~SchemaData() {
+    for(auto &child : children) {
+      if(child.release) child.release(&child);
+    }
+    if(dictionary && dictionary->release) dictionary->release(dictionary.get());
+  }
+};
+
+void releaseSchema(ArrowSchema *schema) {
+  delete static_cast<SchemaData *>(schema->private_data);
+  schema->release = nullptr;
+}
+
+void finishSchema(std::unique_ptr<SchemaData> data, int64_t flags, ArrowSchema *schema) {
+  for(auto &child : data->children) {
+    data->childPtrs.push_back(&child);
+  }
+  schema->format = data->format.c_str();
+  schema->name = data->name.c_str();
+  schema->metadata = nullptr;
+  schema->flags = flags;
+  schema->n_children = data->childPtrs.size();
+  schema->children = data->childPtrs.empty() ? nullptr : data->childPtrs.data();
+  schema->dictionary = data->dictionary.get();
+  schema->release = releaseSchema;
+  schema->private_data = data.release();
+}
+
+// fill schema with the Arrow type of the Clickhouse type, which is large
+// strings and lists (with 64-bit offsets) for String and Array columns, so
+// that the type does not depend on the size of the blocks
+void exportSchema(const ch::TypeRef &type, const std::string &name, bool nullable,
+    ArrowSchema *schema) {
+  std::unique_ptr<SchemaData> data(new SchemaData);
+  data->name = name;
+  int64_t flags = nullable ? ARROW_FLAG_NULLABLE : 0;
+
+  switch(type->GetCode()) {
+    case ch::Type::Int8:    data->format = "c"; break;
+    case ch::Type::Int16:   data->format = "s"; break;
+    case ch::Type::Int32:   data->format = "i"; break;
+    case ch::Type::Int64:   data->format = "l"; break;
+    case ch::Type::UInt8:   data->format = "C"; break;
+    case ch::Type::UInt16:  data->format = "S"; break;
+    case ch::Type::UInt32:  data->format = "I"; break;
+    case ch::Type::UInt64:  data->format = "L"; break;
+    case ch::Type::Float32: data->format = "f"; break;
+    case ch::Type::Float64: data->format = "g"; break;
+    case ch::Type::String:  data->format = "U"; break;
+    case ch::Type::FixedString:
+      // the width is only part of the name of the type
+      data->format = "w:" + type->GetName().substr(std::string("FixedString(").size());
+      data->format.pop_back();
+      break;
+    case ch::Type::Date:
+      data->format = "tdD";
+      break;
+    case ch::Type::DateTime:
+      data->format = "tss:" + std::static_pointer_cast<ch::DateTimeType>(type)->GetTimezone();
+      break;
+    case ch::Type::DateTime64: {
+      auto dt = std::static_pointer_cast<ch::DateTime64Type>(type);
+      switch(dt->GetPrecision()) {
+        case 0: data->format = "tss:"; break;
+        case 3: data->format = "tsm:"; break;
+        case 6: data->format = "tsu:"; break;
+        case 9: data->format = "tsn:"; break;
+        default:
+          throw std::invalid_argument("columns of type " + type->GetName() +
+              " can't be fetched as Arrow arrays, only seconds, milli-, micro- and nanoseconds");
+      }
+      data->format += dt->GetTimezone();
+      break;
+    }
+    case ch::Type::Enum8:
+    case ch::Type::Enum16:
+      // indices into a dictionary of the names, ordered by value
+      data->format = type->GetCode() == ch::Type::Enum8 ? "c" : "s";
+      data->dictionary.reset(new ArrowSchema());
+      exportSchema(ch::Type::CreateString(), "", false, data->dictionary.get());
+      flags |= ARROW_FLAG_DICTIONARY_ORDERED;
+      break;
+    case ch::Type::Nullable:
+      exportSchema(std::static_pointer_cast<ch::NullableType>(type)->GetNestedType(), name, true, schema);
+      return;
+    case ch::Type::Array:
+      data->format = "+L";
+      data->children.resize(1);
+      exportSchema(std::static_pointer_cast<ch::ArrayType>(type)->GetItemType(), "item", false,
+          &data->children[0]);
+      break;
+    default:
+      throw std::invalid_argument("columns of type " + type->GetName() + " can't be fetched as Arrow arrays");
+  }
+
+  finishSchema(std::move(data), flags, schema);
+}
+
+// the buffers of an array, which are either owned by it or by the column it
+// keeps alive, and its children
+struct ArrayData {
+  ch::ColumnRef column;
+  std::vector<std::shared_ptr<void>> owned;
+  std::vector<const void *> buffers;
+  std::vector<ArrowArray> children;
+  std::vector<ArrowArray *> childPtrs;
+  std::unique_ptr<ArrowArray> dictionary;
+
+  ~ArrayData() {
+    for(auto &child : children) {
+      if(child.release) child.release(&child);
+    }
+    if(dictionary && dictionary->release) dictionary->release(dictionary.get());
+  }
+
+  // a zeroed buffer of n entries of type T, owned by the array
+  template<typename T>
+  T *ownedBuffer(size_t n) {
+    std::shared_ptr<T> buffer(new T[std::max<size_t>(n, 1)](), std::default_delete<T[]>());
+    owned.push_back(buffer);
+    return buffer.get();
+  }
+};
+
+void releaseArray(ArrowArray *array) {
+  delete static_cast<ArrayData *>(array->private_data);
+  array->release = nullptr;
+}
+
+void finishArray(std::unique_ptr<ArrayData> data, size_t start, size_t len, int64_t nullCount,
+    ArrowArray *array) {
+  for(auto &child : data->children) {
+    data->childPtrs.push_back(&child);
+  }
+  array->length = len;
+  array->null_count = nullCount;
+  array->offset = start;
+  array->n_buffers = data->buffers.size();
+  array->n_children = data->childPtrs.size();
+  array->buffers = data->buffers.data();
+  array->children = data->childPtrs.empty() ? nullptr : data->childPtrs.data();
+  array->dictionary = data->dictionary.get();
+  array->release = releaseArray;
+  array->private_data = data.release();
+}
+
+// the Arrow offsets of the n strings or arrays of a column, the i-th of which
+// ends at end(i)
+template<typename F>
+int64_t *buildOffsets(ArrayData &data, size_t n, F end) {
+  int64_t *offsets = data.ownedBuffer<int64_t>(n+1);
+  for(size_t i = 0; i < n; i++) {
+    offsets[i+1] = end(i);
+  }
+  return offsets;
+}
+
+template<typename To, typename From>
+const To *widen(ArrayData &data, const From *values, size_t n) {
+  To *out = data.ownedBuffer<To>(n);
+  std::copy(values, values+n, out);
+  return out;
+}
+
+// the offsets and characters of the strings of col, which are contiguous,
+// so that only the offsets have to be built
+void stringBuffers(ArrayData &data, const ch::ColumnString &col) {
+  int64_t total = 0;
+  data.buffers.push_back(buildOffsets(data, col.Size(), [&](size_t i) {
+    return total += col[i].size();
+  }));
+  data.buffers.push_back(nonEmpty(col.Size() > 0 ? col[0].data() : nullptr));
+}
+
+// the indices of the enum values of col in the dictionary of names ordered by
+// value, which is added to the array
+template<typename T>
+const T *enumIndices(ArrayData &data, const ch::TypeRef &type, const ch::ColumnEnum<T> &col) {
+  using U = typename std::make_unsigned<T>::type;
+  auto et = std::static_pointer_cast<ch::EnumType>(type);
+  std::vector<T> index(size_t(1) << (8*sizeof(T)));
+  std::vector<std::string> names;
+  for(auto it = et->BeginValueToName(); it != et->EndValueToName(); ++it) {
+    index[static_cast<U>(it->first)] = static_cast<T>(names.size());
+    names.push_back(it->second);
+  }
+
+  T *out = data.ownedBuffer<T>(col.Size());
+  const T *values = col.Data();
+  for(size_t i = 0; i < col.Size(); i++) {
+    out[i] = index[static_cast<U>(values[i])];
+  }
+
+  std::unique_ptr<ArrayData> dict(new ArrayData);
+  dict->column = std::make_shared<ch::ColumnString>(names);
+  dict->buffers.push_back(nullptr);
+  stringBuffers(*dict, *dict->column->As<ch::ColumnString>());
+  data.dictionary.reset(new ArrowArray());
+  finishArray(std::move(dict), 0, names.size(), 0, data.dictionary.get());
+  return out;
+}
+
+// fill array with the entries [start, start+len) of col, laid out as the
+// Arrow type given by exportSchema for type; nulls is the null map of the
+// enclosing Nullable column, if any
+void exportArray(const ch::TypeRef &type, const ch::ColumnRef &col, const ch::ColumnUInt8 *nulls,
+    size_t start, size_t len, ArrowArray *array) {
+  if(type->GetCode() == ch::Type::Nullable) {
+    // without nulls, the validity bitmap is left out
+    auto nc = col->As<ch::ColumnNullable>();
+    exportArray(std::static_pointer_cast<ch::NullableType>(type)->GetNestedType(), nc->Nested(),
+        nc->NullCount() > 0 ? nc->Nulls()->As<ch::ColumnUInt8>().get() : nullptr, start, len, array);
+    return;
+  }
+
+  std::unique_ptr<ArrayData> data(new ArrayData);
+  data->column = col;
+  const size_t size = col->Size();
+
+  // the validity bitmap of the whole column, counting the nulls of the range
+  int64_t nullCount = 0;
+  data->buffers.push_back(nullptr);
+  if(nulls) {
+    const uint8_t *isNull = nulls->Data();
+    uint8_t *valid = data->ownedBuffer<uint8_t>((size+7)/8);
+    for(size_t i = 0; i < size; i++) {
+      if(!isNull[i]) valid[i/8] |= 1 << (i%8);
+    }
+    nullCount = std::count_if(isNull+start, isNull+start+len, [](uint8_t b) { return b != 0; });
+    data->buffers[0] = valid;
+  }
+
+  switch(type->GetCode()) {
+    case ch::Type::Int8:    data->buffers.push_back(nonEmpty(col->As<ch::ColumnInt8>()->Data())); break;
+    case ch::Type::Int16:   data->buffers.push_back(nonEmpty(col->As<ch::ColumnInt16>()->Data())); break;
+    case ch::Type::Int32:   data->buffers.push_back(nonEmpty(col->As<ch::ColumnInt32>()->Data())); break;
+    case ch::Type::Int64:   data->buffers.push_back(nonEmpty(col->As<ch::ColumnInt64>()->Data())); break;
+    case ch::Type::UInt8:   data->buffers.push_back(nonEmpty(col->As<ch::ColumnUInt8>()->Data())); break;
+    case ch::Type::UInt16:  data->buffers.push_back(nonEmpty(col->As<ch::ColumnUInt16>()->Data())); break;
+    case ch::Type::UInt32:  data->buffers.push_back(nonEmpty(col->As<ch::ColumnUInt32>()->Data())); break;
+    case ch::Type::UInt64:  data->buffers.push_back(nonEmpty(col->As<ch::ColumnUInt64>()->Data())); break;
+    case ch::Type::Float32: data->buffers.push_back(nonEmpty(col->As<ch::ColumnFloat32>()->Data())); break;
+    case ch::Type::Float64: data->buffers.push_back(nonEmpty(col->As<ch::ColumnFloat64>()->Data())); break;
+    case ch::Type::String:
+      stringBuffers(*data, *col->As<ch::ColumnString>());
+      break;
+    case ch::Type::FixedString:
+      data->buffers.push_back(nonEmpty(col->As<ch::ColumnFixedString>()->Data()));
+      break;
+    case ch::Type::Date:
+      data->buffers.push_back(widen<int32_t>(*data, col->As<ch::ColumnDate>()->Data(), size));
+      break;
+    case ch::Type::DateTime:
+      data->buffers.push_back(widen<int64_t>(*data, col->As<ch::ColumnDateTime>()->Data(), size));
+      break;
+    case ch::Type::DateTime64:
+      data->buffers.push_back(nonEmpty(col->As<ch::ColumnDateTime64>()->Data()));
+      break;
+    case ch::Type::Enum8:
+      data->buffers.push_back(enumIndices(*data, type, *col->As<ch::ColumnEnum8>()));
+      break;
+    case ch::Type::Enum16:
+      data->buffers.push_back(enumIndices(*data, type, *col->As<ch::ColumnEnum16>()));
+      break;
+    case ch::Type::Array: {
+      auto ac = col->As<ch::ColumnArray>();
+      const uint64_t *ends = ac->GetOffsets()->Data();
+      data->buffers.push_back(buildOffsets(*data, size, [&](size_t i) {
+        return static_cast<int64_t>(ends[i]);
+      }));
+      data->children.resize(1);
+      auto entries = ac->GetData();
+      exportArray(std::static_pointer_cast<ch::ArrayType>(type)->GetItemType(), entries, nullptr,
+          0, entries->Size(), &data->children[0]);
+      break;
+    }
+    default:
+      throw std::invalid_argument("columns of type " + type->GetName() + " can't be fetched as Arrow arrays");
+  }
+
+  finishArray(std::move(data), start, len, nullCount, array);
+}
+
+// the record batches of a stream, one per (part of a) block
+struct StreamData {
+  std::vector<std::string> names;
+  std::vector<ch::TypeRef> types;
+
+  struct Batch {
+    std::vector<ch::ColumnRef> columns;
+    size_t start, len;
+  };
+  std::deque<Batch> batches;
+
+  std::string error;
+};
+
+void exportBatchSchema(const StreamData &s, ArrowSchema *schema) {
+  std::unique_ptr<SchemaData> data(new SchemaData);
+  data->format = "+s";
+  data->children.resize(s.types.size());
+  for(size_t i = 0; i < s.types.size(); i++) {
+    exportSchema(s.types[i], s.names[i], false, &data->children[i]);
+  }
+  finishSchema(std::move(data), 0, schema);
+}
+
+void exportBatch(const StreamData &s, const StreamData::Batch &batch, ArrowArray *array) {
+  std::unique_ptr<ArrayData> data(new ArrayData);
+  data->buffers.push_back(nullptr);
+  data->children.resize(s.types.size());
+  for(size_t i = 0; i < s.types.size(); i++) {
+    exportArray(s.types[i], batch.columns[i], nullptr, batch.start, batch.len, &data->children[i]);
+  }
+  finishArray(std::move(data), 0, batch.len, 0, array);
+}
+
+// run f for a callback of the stream, keeping the message of its error
+template<typename F>
+int streamCall(ArrowArrayStream *stream, F f) {
+  auto *s = static_cast<StreamData *>(stream->private_data);
+  try {
+    f(*s);
+    return 0;
+  } catch(const std::bad_alloc &e) {
+    s->error = e.what();
+    return ENOMEM;
+  } catch(const std::exception &e) {
+    s->error = e.what();
+    return EINVAL;
+  }
+}
+
+int streamGetSchema(ArrowArrayStream *stream, ArrowSchema *out) {
+  return streamCall(stream, [out](StreamData &s) {
+    exportBatchSchema(s, out);
+  });
+}
+
+int streamGetNext(ArrowArrayStream *stream, ArrowArray *out) {
+  return streamCall(stream, [out](StreamData &s) {
+    if(s.batches.empty()) {
+      out->release = nullptr;   // end of the stream
+      return;
+    }
+    exportBatch(s, s.batches.front(), out);
+    s.batches.pop_front();
+  });
+}
+
+const char *streamGetLastError(ArrowArrayStream *stream) {
+  auto *s = static_cast<StreamData *>(stream->private_data);
+  return s->error.empty() ? nullptr : s->error.c_str();
+}
+
+void streamRelease(ArrowArrayStream *stream) {
+  delete static_cast<StreamData *>(stream->private_data);
+  stream->release = nullptr;
+}
+
+}
+
+void Result::fetchArrow(ssize_t n, ArrowArrayStream *out) {
+  receiveBlocks(n);
+  receiveAsyncBlocks(n, true);
+  rethrowAsyncError();
+  checkMemoryLimit();
+
+  size_t nRows = n >= 0 ? std::min(static_cast<size_t>(n), availRows-fetchedRows) : availRows-fetchedRows;
+  loadBlocks(nRows);
+
+  std::unique_ptr<StreamData> data(new StreamData);
+  for(R_xlen_t i = 0; i < colNames.size(); i++) {
+    data->names.push_back(std::string(colNames[i]));
+  }
+  data->types = colTypes;
+
+  // raise errors about unsupported types before any rows have been fetched
+  ArrowSchema schema;
+  exportBatchSchema(*data, &schema);
+  schema.release(&schema);
+
+  size_t row = firstBlockRow;
+  for(const ColBlock &cb : columnBlocks) {
+    size_t begin = std::max(row, fetchedRows),
+           end = std::min(row+cb.rows, fetchedRows+nRows);
+    if(begin < end) {
+      data->batches.push_back(StreamData::Batch{cb.columns, begin-row, end-begin});
+    }
+    row += cb.rows;
+  }
+  fetchedRows += nRows;
+  releaseFetchedBlocks();
+
+  out->get_schema = streamGetSchema;
+  out->get_next = streamGetNext;
+  out->get_last_error = streamGetLastError;
+  out->release = streamRelease;
+  out->private_data = data.release();
+}
+
+void exportBlock(const ch::Block &block, ArrowSchema *schema, ArrowArray *array) {
+  StreamData s;
+  StreamData::Batch batch;
+  for(size_t i = 0; i < block.GetColumnCount(); i++) {
+    s.names.push_back(block.GetColumnName(i));
+    s.types.push_back(block[i]->Type());
+    batch.columns.push_back(block[i]);
+  }
+  batch.start = 0;
+  batch.len = block.GetRowCount();
+
+  exportBatchSchema(s, schema);
+  try {
+    exportBatch(s, batch, array);
+  } catch(...) {
+    schema->release(schema);
+    throw;
+  }
+}
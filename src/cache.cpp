@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <utility>
+#include "cache.h"
+
+ResultCache &ResultCache::instance() {
+  static ResultCache cache;
+  return cache;
+}
+
+std::string ResultCache::key(const std::string &scope, const std::string &query,
+    const std::vector<std::string> &settingNames,
+    const std::vector<std::string> &settingValues) {
+  std::string k = scope;
+  k += '\0';
+
+  // runs of whitespace outside of string literals and quoted identifiers
+  // become a single space, leading and trailing whitespace is dropped
+  char quote = 0;
+  bool space = false;
+  for(size_t i = 0; i < query.size(); i++) {
+    char c = query[i];
+    if(quote) {
+      k += c;
+      if(c == '\\' && i+1 < query.size()) {
+        k += query[++i];
+      } else if(c == quote) {
+        quote = 0;
+      }
+      continue;
+    }
+    if(c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+      space = true;
+      continue;
+    }
+    if(space && k.back() != '\0') {
+      k += ' ';
+    }
+    space = false;
+    if(c == '\'' || c == '"' || c == '`') {
+      quote = c;
+    }
+    k += c;
+  }
+
+  // settings apply regardless of their order
+  std::vector<std::pair<std::string, std::string>> settings;
+  for(size_t i = 0; i < settingNames.size() && i < settingValues.size(); i++) {
+    settings.emplace_back(settingNames[i], settingValues[i]);
+  }
+  std::sort(settings.begin(), settings.end());
+  for(const auto &s : settings) {
+    k += '\0';
+    k += s.first;
+    k += '=';
+    k += s.second;
+  }
+  return k;
+}
+
+std::shared_ptr<const ResultCache::Blocks> ResultCache::find(const std::string &key) {
+  auto it = index.find(key);
+  if(it != index.end() && it->second->expires <= std::chrono::steady_clock::now()) {
+    erase(it->second);
+    it = index.end();
+  }
+  if(it == index.end()) {
+    counters.misses++;
+    return nullptr;
+  }
+  counters.hits++;
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->blocks;
+}
+
+void ResultCache::insert(const std::string &key, Blocks blocks, double ttl) {
+  size_t bytes = 0;
+  for(const ch::Block &block : blocks) {
+    for(ch::Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
+      bytes += bi.Column()->MemoryUsage();
+    }
+  }
+  auto it = index.find(key);
+  if(it != index.end()) {
+    erase(it->second);
+  }
+  if(bytes > counters.capacity) {
+    return;
+  }
+
+  auto expires = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(ttl));
+  entries.push_front(Entry{key, std::make_shared<const Blocks>(std::move(blocks)),
+      bytes, expires});
+  index[key] = entries.begin();
+  counters.entries++;
+  counters.bytes += bytes;
+  evict();
+}
+
+void ResultCache::setCapacity(size_t bytes) {
+  counters.capacity = bytes;
+  evict();
+}
+
+void ResultCache::clear() {
+  entries.clear();
+  index.clear();
+  counters.entries = 0;
+  counters.bytes = 0;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+  return counters;
+}
+
+void ResultCache::erase(std::list<Entry>::iterator it) {
+  counters.entries--;
+  counters.bytes -= it->bytes;
+  index.erase(it->key);
+  entries.erase(it);
+}
+
+void ResultCache::evict() {
+  while(counters.bytes > counters.capacity && !entries.empty()) {
+    erase(std::prev(entries.end()));
+    counters.evictions++;
+  }
+}
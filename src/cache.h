@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <clickhouse/block.h>
+
+namespace ch = clickhouse;
+
+// A cache of the blocks received for queries, shared by all connections of
+// the process and only used by the R thread. The blocks are never modified
+// once received, so results answered from the cache share their columns
+// instead of copying them. Entries expire after their time to live, and the
+// least recently used ones are evicted once the blocks cached take more than
+// the capacity (as reported by Column::MemoryUsage).
+class ResultCache {
+  public:
+  using Blocks = std::vector<ch::Block>;
+
+  struct Stats {
+    uint64_t hits = 0, misses = 0, evictions = 0;
+    size_t entries = 0, bytes = 0, capacity = 0;
+  };
+
+  static ResultCache &instance();
+
+  // the key of a query sent to the server scope (host, port, user and
+  // default database) with the given settings; whitespace outside of quotes
+  // is normalized, so that differently formatted but otherwise identical
+  // statements share an entry
+  static std::string key(const std::string &scope, const std::string &query,
+      const std::vector<std::string> &settingNames,
+      const std::vector<std::string> &settingValues);
+
+  // the blocks cached for key, or nullptr if there are none (or they have
+  // expired); counts a hit or a miss
+  std::shared_ptr<const Blocks> find(const std::string &key);
+
+  // cache the blocks of the query with key for ttl seconds
+  void insert(const std::string &key, Blocks blocks, double ttl);
+
+  // evict entries beyond the new capacity in bytes
+  void setCapacity(size_t bytes);
+  void clear();
+  Stats stats() const;
+
+  private:
+  ResultCache() {
+    counters.capacity = size_t(256) << 20;
+  }
+
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const Blocks> blocks;
+    size_t bytes;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  // most recently used first
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  Stats counters;
+
+  void erase(std::list<Entry>::iterator it);
+  void evict();
+};
@@ -1,18 +1,63 @@
 // [[Rcpp::plugins(cpp11)]]
 // [[Rcpp::interfaces(r, cpp)]]
 #define RCPP_NEW_DATE_DATETIME_VECTORS 1
-#define NA_INTEGER64 LLONG_MIN
 #include <Rcpp.h>
+#include <clickhouse/base/allocator.h>
+#include <clickhouse/base/executor.h>
 #include <clickhouse/client.h>
+#include <clickhouse/columns/factory.h>
+#include "arrow.h"
+#include "cache.h"
 #include "result.h"
+#include "insert.h"
+#include "metadata.h"
+#include "native.h"
+#include "sharding.h"
+#include "stringrefs.h"
+#include "textfile.h"
+#include "uuid.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 using namespace Rcpp;
 using namespace clickhouse;
 
 // [[Rcpp::export]]
-DataFrame fetch(XPtr<Result> res, ssize_t n) {
-  return res->fetchFrame(n);
+DataFrame fetch(XPtr<Result> res, ssize_t n, bool wait, bool lazy) {
+  return res->fetchFrame(n, wait, lazy);
+}
+
+// [[Rcpp::export]]
+double accumulate(XPtr<Result> res, ssize_t n, bool wait) {
+  return res->accumulateFrame(n, wait);
+}
+
+// [[Rcpp::export]]
+DataFrame accumulated(XPtr<Result> res) {
+  return res->accumulatedFrame();
+}
+
+// export the next n rows of res to the Arrow stream stream, an external
+// pointer to an ArrowArrayStream allocated by nanoarrow
+// [[Rcpp::export]]
+void fetchArrow(XPtr<Result> res, ssize_t n, SEXP stream) {
+  auto *out = static_cast<ArrowArrayStream *>(R_ExternalPtrAddr(stream));
+  if(!out) {
+    stop("invalid Arrow array stream");
+  }
+  res->fetchArrow(n, out);
 }
 
 // [[Rcpp::export]]
@@ -22,6 +67,7 @@ void clearResult(XPtr<Result> res) {
 
 // [[Rcpp::export]]
 bool hasCompleted(XPtr<Result> res) {
+  res->poll();
   return res->isComplete();
 }
 
@@ -35,6 +81,29 @@ size_t getRowsAffected(XPtr<Result> res) {
   return res->numRowsAffected();
 }
 
+// [[Rcpp::export]]
+List getProgress(XPtr<Result> res) {
+  res->poll();
+  return res->progressList();
+}
+
+// [[Rcpp::export]]
+String getQueryId(XPtr<Result> res) {
+  return res->getQueryId();
+}
+
+// [[Rcpp::export]]
+DataFrame getStats(XPtr<Result> res) {
+  res->poll();
+  return res->statsFrame();
+}
+
+// [[Rcpp::export]]
+std::string getTrace(XPtr<Result> res, int pid) {
+  res->poll();
+  return res->traceJSON(pid);
+}
+
 // [[Rcpp::export]]
 std::string getStatement(XPtr<Result> res) {
   return res->getStatement();
@@ -48,65 +117,933 @@ std::vector<std::string> resultTypes(XPtr<Result> res) {
   return r;
 }
 
+// the servers of a comma-separated list of host or host:port entries (with
+// IPv6 addresses in brackets), port being the default one
+static std::vector<Endpoint> parseEndpoints(const std::string &hosts, int port) {
+  std::vector<Endpoint> endpoints;
+  size_t begin = 0;
+  while(begin <= hosts.size()) {
+    size_t end = hosts.find(',', begin);
+    if(end == std::string::npos) {
+      end = hosts.size();
+    }
+    std::string entry = hosts.substr(begin, end-begin);
+    begin = end+1;
+    entry.erase(0, entry.find_first_not_of(" \t"));
+    entry.erase(entry.find_last_not_of(" \t")+1);
+    if(entry.empty()) {
+      continue;
+    }
+
+    Endpoint endpoint{entry, port};
+    size_t colon = entry.rfind(':');
+    size_t bracket = entry.rfind(']');
+    bool bracketed = entry[0] == '[' && bracket != std::string::npos;
+    // a single colon separates the port, more are part of an IPv6 address
+    if(colon != std::string::npos && (bracketed ? colon > bracket : entry.find(':') == colon)) {
+      try {
+        size_t used = 0;
+        endpoint.port = std::stoi(entry.substr(colon+1), &used);
+        if(used != entry.size()-colon-1) {
+          throw std::invalid_argument(entry);
+        }
+      } catch(const std::exception &) {
+        stop("invalid port in host '"+entry+"'");
+      }
+      endpoint.host = entry.substr(0, colon);
+    }
+    if(bracketed) {
+      endpoint.host = endpoint.host.substr(1, endpoint.host.rfind(']')-1);
+    }
+    endpoints.push_back(endpoint);
+  }
+  if(endpoints.empty()) {
+    stop("no host given");
+  }
+  return endpoints;
+}
+
+// Idle connections kept for reuse: connections opened with reuse = TRUE are
+// not closed when disconnected (unless busy), but handed to the next one opened
+// with the same options, so that short-lived connections skip the connect and
+// the handshake. They are only used by the R thread.
+namespace {
+
+struct IdleClient {
+  std::string key;
+  std::unique_ptr<Client> client;
+  std::chrono::steady_clock::time_point since;
+};
+
+const size_t maxIdleClients = 8;
+const std::chrono::seconds idleClientTTL(60);
+
+std::deque<IdleClient> idleClients;
+// the options of the open connections which may be reused
+std::map<const Client *, std::string> reusableKeys;
+
+// an idle connection opened with the options key, which still answers a ping,
+// or nullptr
+Client *takeIdleClient(const std::string &key) {
+  const auto now = std::chrono::steady_clock::now();
+  while(!idleClients.empty() && now-idleClients.front().since > idleClientTTL) {
+    idleClients.pop_front();
+  }
+  for(size_t i = idleClients.size(); i-- > 0; ) {
+    if(idleClients[i].key != key) {
+      continue;
+    }
+    std::unique_ptr<Client> client = std::move(idleClients[i].client);
+    idleClients.erase(idleClients.begin()+i);
+    try {
+      client->Ping();
+      return client.release();
+    } catch(const std::exception &) {
+      // closed by the server meanwhile
+    }
+  }
+  return nullptr;
+}
+
+}
+
 // [[Rcpp::export]]
-XPtr<Client> connect(String host, int port, String db, String user, String password, String compression) {
+XPtr<Client> connect(std::string host, int port, String db, String user, String password,
+    String compression, double timeout, std::string loadBalancing, bool reuse, bool trace) {
+  // the compression may be given as method:level, e.g. zstd:5 or lz4:-8 (see
+  // ClientOptions::compression_level)
+  std::string method = compression, level;
+  size_t colon = method.find(':');
+  if(colon != std::string::npos) {
+    level = method.substr(colon+1);
+    method = method.substr(0, colon);
+  }
+
   CompressionMethod comprMethod = CompressionMethod::None;
-  if(compression == "lz4") {
+  if(method == "lz4") {
     comprMethod = CompressionMethod::LZ4;
-  } else if(compression != "" && compression != "none") {
-    stop("unknown or unsupported compression method '"+std::string(compression)+"'");
+  } else if(method == "zstd") {
+    comprMethod = CompressionMethod::ZSTD;
+  } else if(method != "" && method != "none") {
+    stop("unknown or unsupported compression method '"+method+"'");
+  }
+
+  int comprLevel = 0;
+  if(!level.empty()) {
+    size_t end = 0;
+    try {
+      comprLevel = std::stoi(level, &end);
+    } catch(const std::exception &) {
+      end = 0;
+    }
+    if(end != level.size() || comprMethod == CompressionMethod::None) {
+      stop("invalid compression level '"+level+"' for method '"+method+"'");
+    }
+  }
+
+  LoadBalancing balancing;
+  if(loadBalancing == "in_order") {
+    balancing = LoadBalancing::InOrder;
+  } else if(loadBalancing == "round_robin") {
+    balancing = LoadBalancing::RoundRobin;
+  } else if(loadBalancing == "random") {
+    balancing = LoadBalancing::Random;
+  } else if(loadBalancing == "nearest") {
+    balancing = LoadBalancing::Nearest;
+  } else {
+    stop("unknown load balancing '"+loadBalancing+"'");
+  }
+  std::vector<Endpoint> endpoints = parseEndpoints(host, port);
+
+  std::string key;
+  if(reuse) {
+    std::ostringstream options;
+    options << host << '\x1f' << port << '\x1f' << std::string(db) << '\x1f' <<
+      std::string(user) << '\x1f' << std::string(password) << '\x1f' << std::string(compression) <<
+      '\x1f' << timeout << '\x1f' << loadBalancing;
+    key = options.str();
+    if(Client *client = takeIdleClient(key)) {
+      reusableKeys[client] = key;
+      // without the spans recorded for the connection it was taken from
+      client->SetTrace(trace ? std::make_shared<Trace>() : nullptr);
+      MetadataCache::instance().invalidate(client);
+      return XPtr<Client>(client, true);
+    }
   }
 
   Client *client = new Client(ClientOptions()
-            .SetHost(host)
-            .SetPort(port)
+            .SetHost(endpoints[0].host)
+            .SetPort(endpoints[0].port)
+            .SetEndpoints(endpoints)
+            .SetLoadBalancing(balancing)
             .SetDefaultDatabase(db)
             .SetUser(user)
             .SetPassword(password)
             .SetCompressionMethod(comprMethod)
+            .SetCompressionLevel(comprLevel)
+            // recycle the columns of the blocks of small, repeated queries
+            // (larger results hold on to more blocks than are pooled)
+            .SetColumnPoolSize(2)
+            // queries running longer are canceled (0 for no limit, as are
+            // timeouts too long to be counted in clock ticks, such as Inf)
+            .SetQueryTimeout(std::chrono::milliseconds(timeout < 1e9 ?
+                static_cast<int64_t>(timeout*1000) : 0))
+            // reconnects and new connections to the same hosts skip the lookup
+            .SetDNSCacheTTL(std::chrono::seconds(60))
+            // the spans of the connection and its queries (see dbGetTrace)
+            .SetTrace(trace ? std::make_shared<Trace>() : nullptr)
             // (re)throw exceptions, which are then handled automatically by Rcpp
             .SetRethrowException(true));
+  // (a connection freed by the garbage collector may have had the same address)
+  MetadataCache::instance().invalidate(client);
+  if(reuse) {
+    reusableKeys[client] = key;
+  } else {
+    reusableKeys.erase(client);
+  }
   XPtr<Client> p(client, true);
   return p;
 }
 
+// the spans recorded for the connection (since it has been opened, up to
+// the capacity of its trace) in the JSON format of Chrome's trace viewer, or
+// an empty string if it records no trace
+// [[Rcpp::export]]
+std::string connectionTrace(XPtr<Client> conn, int pid) {
+  std::shared_ptr<Trace> trace = conn->GetTrace();
+  return trace ? ChromeTraceJSON(trace->Spans(), pid) : std::string();
+}
+
+// the server the connection is connected to, out of the hosts it has been
+// given
+// [[Rcpp::export]]
+List currentEndpoint(XPtr<Client> conn) {
+  Endpoint endpoint = conn->GetCurrentEndpoint();
+  return List::create(Named("host") = endpoint.host, Named("port") = endpoint.port);
+}
+
+// fails if the result of an asynchronous query is still being received from
+// the connection, or the blocks of an asynchronous insert are being sent over
+// it, as it can't be used by the R thread meanwhile
+Client *idleClient(XPtr<Client> conn) {
+  Client *client = conn.get();
+  if(client && asyncResult(client)) {
+    stop("an asynchronous query is still running on this connection");
+  }
+  if(client && PreparedInsert::sendingOn(client)) {
+    stop("an asynchronous insert is still open on this connection");
+  }
+  if(client && BufferedInsert::on(client)) {
+    stop("a buffered insert is still open on this connection");
+  }
+  return client;
+}
+
+// [[Rcpp::export]]
+bool isIdle(XPtr<Client> conn) {
+  Client *client = conn.get();
+  if(!client) {
+    return false;
+  }
+  if(Result *r = asyncResult(client)) {
+    r->poll();    // releases the connection if the query is done
+  }
+  if(PreparedInsert::sendingOn(client) || BufferedInsert::on(client)) {
+    return false;
+  }
+  return !asyncResult(client) && !client->IsStreaming() && !client->IsInserting();
+}
+
+// checks that the server is still reachable over the connection, and
+// reconnects otherwise
+// [[Rcpp::export]]
+void ping(XPtr<Client> conn) {
+  Client *client = idleClient(conn);
+  try {
+    client->Ping();
+  } catch(const std::exception &) {
+    client->ResetConnection();
+  }
+}
+
+// opens spare connections for the processes forked by e.g. mclapply, which
+// never share the connection of the parent: each one takes over a spare the
+// first time it uses the connection, or connects anew
+// [[Rcpp::export]]
+void prepareForks(XPtr<Client> conn, int count) {
+  if(count < 0) {
+    stop("the number of workers can't be negative");
+  }
+  idleClient(conn)->PrepareForks(count);
+}
+
 // [[Rcpp::export]]
 void disconnect(XPtr<Client> conn) {
+  MetadataCache::instance().invalidate(conn.get());
+  if(BufferedInsert *buf = BufferedInsert::on(conn.get())) {
+    buf->abandon();
+  }
+  // an idle connection which may be reused is kept open for the next one
+  auto reusable = reusableKeys.find(conn.get());
+  if(reusable != reusableKeys.end()) {
+    Client *client = conn.get();
+    std::string key = reusable->second;
+    reusableKeys.erase(reusable);
+    if(!asyncResult(client) && !PreparedInsert::sendingOn(client) &&
+        !client->IsStreaming() && !client->IsInserting()) {
+      R_ClearExternalPtr(conn);
+      idleClients.push_back(IdleClient{key, std::unique_ptr<Client>(client),
+          std::chrono::steady_clock::now()});
+      if(idleClients.size() > maxIdleClients) {
+        idleClients.pop_front();
+      }
+      return;
+    }
+  }
+
+  if(Result *r = asyncResult(conn.get())) {
+    r->cancelAsync();
+  }
+  if(PreparedInsert *ins = PreparedInsert::sendingOn(conn.get())) {
+    ins->stopSender();
+  }
   conn.release();
 }
 
+// a random (version 4) UUID, as which queries are identified unless an id is
+// given, so that they can be found in system.query_log and killed
+static std::string newQueryId() {
+  static std::mt19937_64 rng(std::random_device{}() ^
+      static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+  const uint64_t hi = (rng() & ~0xF000ULL) | 0x4000ULL;
+  const uint64_t lo = (rng() & ~(3ULL << 62)) | (2ULL << 62);
+  char text[uuidTextLength];
+  formatUUID(hi, lo, text);
+  return std::string(text, uuidTextLength);
+}
+
+Block externalBlock(DataFrame df, std::vector<std::string> types);
+
+static UUIDFormat parseUUIDFormat(const std::string &uuid) {
+  if(uuid == "character") {
+    return UUIDFormat::Character;
+  } else if(uuid == "raw") {
+    return UUIDFormat::Raw;
+  } else if(uuid == "integer64") {
+    return UUIDFormat::Integer64;
+  }
+  stop("unknown UUID format "+uuid);
+}
+
+static Int64Format parseInt64Format(const std::string &int64) {
+  if(int64 == "character") {
+    return Int64Format::Character;
+  } else if(int64 == "integer64") {
+    return Int64Format::Integer64;
+  } else if(int64 == "numeric") {
+    return Int64Format::Numeric;
+  } else if(int64 == "integer") {
+    return Int64Format::Integer;
+  }
+  stop("unknown Int64 format "+int64);
+}
+
+static UInt32Format parseUInt32Format(const std::string &uint32) {
+  if(uint32 == "numeric") {
+    return UInt32Format::Numeric;
+  } else if(uint32 == "integer") {
+    return UInt32Format::Integer;
+  }
+  stop("unknown UInt32 format "+uint32);
+}
+
+static QuerySettings querySettings(const std::vector<std::string> &names,
+    const std::vector<std::string> &values) {
+  QuerySettings settings;
+  for(size_t i = 0; i < names.size() && i < values.size(); i++) {
+    try {
+      settings.Set(names[i], values[i]);
+    } catch(const std::invalid_argument &e) {
+      stop(e.what());
+    }
+  }
+  return settings;
+}
+
 // [[Rcpp::export]]
-XPtr<Result> select(XPtr<Client> conn, String query) {
-  Result *r = new Result(query);
-  //TODO: async?
-  conn->SelectCancelable(query, [&r] (const Block& block) {
-    r->addBlock(block);
-    return R_ToplevelExec(checkInterruptFn, NULL) != FALSE;
-  });
+XPtr<Result> select(XPtr<Client> conn, String query, bool stream, bool async, std::string int64,
+    std::string uint32, int threads, bool exactDecimal, std::string uuid, bool flatArrays,
+    bool ipAsText, bool utf8, RObject progress, double progressInterval,
+    std::vector<std::string> settingNames, std::vector<std::string> settingValues,
+    std::string queryId, std::vector<std::string> externalNames, List externalTables,
+    List externalTypes, double memoryBudget, double memoryLimit, bool memoryCompression,
+    std::string spillPath, bool spillCompression, double cacheTTL, std::string cacheScope,
+    std::vector<std::string> columns, std::vector<std::string> paramNames,
+    CharacterVector paramValues, double maxRows) {
+  idleClient(conn);
+  if(stream && async) {
+    stop("a query can't be both streamed and asynchronous");
+  }
+  Int64Format int64Format = parseInt64Format(int64);
+  UInt32Format uint32Format = parseUInt32Format(uint32);
+  UUIDFormat uuidFormat = parseUUIDFormat(uuid);
+  if(MetadataCache::changesSchema(query)) {
+    MetadataCache::instance().invalidate(conn.get());
+  }
+  Query q(query);
+  q.SetQueryId(queryId.empty() ? newQueryId() : queryId)
+      .SetSettings(querySettings(settingNames, settingValues));
+  for(size_t i = 0; i < externalNames.size(); i++) {
+    q.AddExternalTable(externalNames[i], externalBlock(externalTables[i], externalTypes[i]));
+  }
+  // the values of the parameters are substituted by the server, and are part
+  // of the key of cached results, after the settings (a setting can't be
+  // named like {x})
+  std::vector<std::string> keyNames = settingNames, keyValues = settingValues;
+  for(size_t i = 0; i < paramNames.size() && i < static_cast<size_t>(paramValues.size()); i++) {
+    keyNames.push_back("{" + paramNames[i] + "}");
+    SEXP text = paramValues[i];
+    if(text == NA_STRING) {
+      q.SetParamNull(paramNames[i]);
+      keyValues.push_back(std::string(1, '\0'));
+    } else {
+      const std::string value = Rf_translateCharUTF8(text);
+      q.SetParam(paramNames[i], value);
+      keyValues.push_back(value);
+    }
+  }
+  // unqualified tables are those of the default database of the connection
+  cacheScope += '\0' + conn->GetOptions().default_database;
+  // the other columns are skipped as the blocks are read, the results of
+  // different projections are cached apart
+  q.SetProjection(columns);
+  for(const std::string &col : columns) {
+    cacheScope += '\0' + col;
+  }
+  // queries with a time to live are answered from the cache while it holds
+  // their blocks, and are cached once received completely (unless they come
+  // with external tables, whose contents would have to be part of the key),
+  // streamed ones as the last block is fetched; while an asynchronous one is
+  // running, identical queries share its blocks instead of being sent again
+  // (e.g. those of many sessions of a dashboard sent through a pool at once)
+  bool cached = cacheTTL > 0 && externalNames.empty();
+  std::string cacheKey, flightId;
+  std::shared_ptr<const ResultCache::Blocks> hit;
+  if(cached) {
+    cacheKey = ResultCache::key(cacheScope, query, keyNames, keyValues);
+    hit = ResultCache::instance().find(cacheKey);
+    if(!hit) {
+      flightId = Result::flightQueryId(cacheKey);
+    }
+  }
+  Result *r;
+  if(hit) {
+    r = new Result(query, q.GetQueryId());
+  } else if(!flightId.empty()) {
+    r = new Result(query, flightId);
+  } else if(stream) {
+    // only the header block is received here, the remaining ones are pulled
+    // from the connection as the result is fetched
+    r = new Result(conn, q);
+  } else if(async) {
+    // the blocks are received by a background thread, which takes over the
+    // connection until the result has been completed or cleared
+    r = new Result(conn, q, true);
+  } else {
+    r = new Result(query, q.GetQueryId());
+  }
+  r->setInt64Format(int64Format);
+  r->setUInt32Format(uint32Format);
+  r->setExactDecimal(exactDecimal);
+  r->setFlatArrays(flatArrays);
+  r->setIPAsText(ipAsText);
+  r->setUUIDFormat(uuidFormat);
+  r->setUTF8Strings(utf8);
+  r->setConversionThreads(threads);
+  r->setProgressCallback(progress, progressInterval);
+  r->setMemoryBudget(memoryBudget, spillPath, spillCompression);
+  r->setMemoryLimit(memoryLimit);
+  r->setMemoryCompression(memoryCompression);
+  // the query of a result of at most maxRows rows is canceled once they have
+  // arrived, so that previewing a large query doesn't run it to the end; a
+  // result cut short isn't cached, and doesn't let others join its query
+  r->setRowLimit(maxRows);
+  const bool limited = maxRows >= 0 && std::isfinite(maxRows);
+  if(!flightId.empty()) {
+    // a synchronous query waits for all of the rows, others are fetched
+    // like asynchronous ones
+    try {
+      r->joinFlight(cacheKey, !stream && !async);
+    } catch(...) {
+      delete r;
+      throw;
+    }
+  } else if(stream && cached && !hit) {
+    r->cacheWhenComplete(cacheKey, cacheTTL);
+  } else if(async && cached && !hit && !limited) {
+    r->startFlight(cacheKey, cacheTTL);
+  }
+  if(hit) {
+    for(const Block &block : *hit) {
+      r->addBlock(block);
+    }
+    r->onDone();
+  } else if(!stream && !async && flightId.empty()) {
+    // interrupts are checked after each block, and regularly while waiting
+    // for the server, so that a slow query is canceled promptly as well; so
+    // is a failing progress callback
+    bool complete = true;
+    CancelCheckCallback notInterrupted = [&r, &complete] {
+      complete = !r->exceededMemoryLimit() && !r->reachedRowLimit() && r->reportProgress() &&
+        R_ToplevelExec(checkInterruptFn, NULL) != FALSE;
+      return complete;
+    };
+    ResultCache::Blocks blocks;
+    r->startClientStats(*conn);
+    try {
+      conn->Execute(q
+          .OnDataCancelable([&r, &notInterrupted, &blocks, cached] (const Block& block) {
+            r->addBlock(block);
+            if(cached) {
+              blocks.push_back(block);
+            }
+            return notInterrupted();
+          })
+          .OnCancelCheck(notInterrupted)
+          .OnProgress([&r] (const Progress& p) { r->onProgress(p); })
+          .OnProfile([&r] (const Profile& p) { r->onProfile(p); }));
+    } catch(...) {
+      delete r;
+      throw;
+    }
+    r->finishClientStats(*conn);
+    if(r->exceededMemoryLimit()) {
+      std::unique_ptr<Result> failed(r);
+      failed->checkMemoryLimit();
+    }
+    r->onDone();
+    if(cached && complete) {
+      ResultCache::instance().insert(cacheKey, std::move(blocks), cacheTTL);
+    }
+  }
+  if(r->progressCallbackFailed()) {
+    delete r;
+    stop("the progress callback failed");
+  }
 
   XPtr<Result> rp(r, true);
   return rp;
 }
 
+// send the query to each of conns, e.g. the shards of a cluster, or
+// queries[i] to conns[i], e.g. for disjoint ranges of a table, at once and
+// return a result in async mode receiving the rows of all of them (in the
+// order of conns, if ordered)
+// [[Rcpp::export]]
+XPtr<Result> selectShards(List conns, std::vector<std::string> queries, bool ordered,
+    std::string int64, std::string uint32, int threads,
+    bool exactDecimal, std::string uuid, bool flatArrays, bool ipAsText, bool utf8,
+    std::vector<std::string> settingNames, std::vector<std::string> settingValues,
+    std::string queryId) {
+  if(conns.size() == 0) {
+    stop("no connections given");
+  }
+  std::set<Client *> clients;
+  for(R_xlen_t i = 0; i < conns.size(); i++) {
+    Client *client = idleClient(conns[i]);
+    if(!client) {
+      stop("invalid connection");
+    }
+    if(!clients.insert(client).second) {
+      stop("a connection can only be used once by a query");
+    }
+  }
+  if(queries.size() != 1 && queries.size() != static_cast<size_t>(conns.size())) {
+    stop("there must be one query, or one for each connection");
+  }
+  Int64Format int64Format = parseInt64Format(int64);
+  UInt32Format uint32Format = parseUInt32Format(uint32);
+  UUIDFormat uuidFormat = parseUUIDFormat(uuid);
+  const std::string id = queryId.empty() ? newQueryId() : queryId;
+  const QuerySettings settings = querySettings(settingNames, settingValues);
+  std::vector<Query> qs;
+  for(const std::string &query : queries) {
+    qs.push_back(Query(query).SetQueryId(id).SetSettings(settings));
+  }
+
+  std::unique_ptr<Result> r(new Result(conns, qs, ordered));
+  r->setInt64Format(int64Format);
+  r->setUInt32Format(uint32Format);
+  r->setExactDecimal(exactDecimal);
+  r->setFlatArrays(flatArrays);
+  r->setIPAsText(ipAsText);
+  r->setUUIDFormat(uuidFormat);
+  r->setUTF8Strings(utf8);
+  r->setConversionThreads(threads);
+  return XPtr<Result>(r.release(), true);
+}
+
+// set the capacity of the result cache in bytes (if not negative) and clear
+// it if requested, returning its counters
+// [[Rcpp::export]]
+List resultCache(double capacity, bool clear) {
+  ResultCache &cache = ResultCache::instance();
+  if(clear) {
+    cache.clear();
+  }
+  if(capacity >= 0) {
+    cache.setCapacity(std::isfinite(capacity) ? static_cast<size_t>(capacity) : SIZE_MAX);
+  }
+  ResultCache::Stats stats = cache.stats();
+  return List::create(
+      Named("hits") = static_cast<double>(stats.hits),
+      Named("misses") = static_cast<double>(stats.misses),
+      Named("evictions") = static_cast<double>(stats.evictions),
+      Named("entries") = static_cast<double>(stats.entries),
+      Named("bytes") = static_cast<double>(stats.bytes),
+      Named("size") = static_cast<double>(stats.capacity));
+}
+
+// set the limit of the memory taken by the results of the process in bytes
+// (if not negative; 0 for none), returning the memory they take, the limit and
+// the memory of the column buffers mapped on their own
+// [[Rcpp::export]]
+List resultMemory(double limit) {
+  if(limit >= 0) {
+    Result::setProcessMemoryLimit(limit);
+  }
+  const size_t current = Result::processMemoryLimit();
+  return List::create(
+      Named("bytes") = static_cast<double>(Result::processMemory()),
+      Named("limit") = current > 0 ? static_cast<double>(current) :
+        std::numeric_limits<double>::infinity(),
+      Named("mapped") = static_cast<double>(GetBufferStats().mapped_bytes));
+}
+
+// the threads of the pool shared by the parallel conversions and
+// decompression of all connections (R's thread included), set if threads is
+// positive, along with the tasks run by the workers of the pool so far
+// [[Rcpp::export]]
+List threadPool(int threads) {
+  ch::Executor &executor = ch::Executor::Instance();
+  if(threads > 0) {
+    executor.SetWorkers(threads - 1);
+  }
+  const ch::Executor::Stats stats = executor.GetStats();
+  return List::create(
+      Named("threads") = static_cast<int>(executor.Workers() + 1),
+      Named("tasks") = static_cast<double>(stats.tasks),
+      Named("stolen") = static_cast<double>(stats.stolen));
+}
+
+// make res, which has been cleared, the result next (sent again with other
+// parameters) in its place, leaving next cleared
+// [[Rcpp::export]]
+void rebindResult(XPtr<Result> res, XPtr<Result> next) {
+  if(res.get()) {
+    stop("the result has to be cleared first");
+  }
+  R_SetExternalPtrAddr(res, next.get());
+  R_ClearExternalPtr(next);
+}
+
+// the memory taken by the blocks of a result which are held in memory
+// [[Rcpp::export]]
+double resultBytes(XPtr<Result> res) {
+  return static_cast<double>(res->memoryBytes());
+}
+
+// the tables of the database of the connection, answered from its metadata
+// cache if they have been listed less than ttl seconds ago
+// [[Rcpp::export]]
+CharacterVector listTables(XPtr<Client> conn, double ttl) {
+  std::vector<std::string> tables = MetadataCache::instance().tables(*idleClient(conn), ttl);
+  CharacterVector names(tables.size());
+  for(size_t i = 0; i < tables.size(); i++) {
+    names[i] = String(tables[i], CE_UTF8);
+  }
+  return names;
+}
+
+// the names and types of the columns of table (quoted as in SQL), answered
+// from the metadata cache of the connection if it has been described less
+// than ttl seconds ago
+// [[Rcpp::export]]
+List tableColumns(XPtr<Client> conn, std::string table, double ttl) {
+  MetadataCache::Columns cols = MetadataCache::instance().columns(*idleClient(conn), table, ttl);
+  CharacterVector names(cols.names.size());
+  for(size_t i = 0; i < cols.names.size(); i++) {
+    names[i] = String(cols.names[i], CE_UTF8);
+  }
+  return List::create(Named("name") = names, Named("type") = cols.typeNames);
+}
+
+// clears the metadata cache of the connection if requested, returning the
+// counters of the metadata caches and the number of tables described in the
+// one of the connection
+// [[Rcpp::export]]
+List metadataCache(XPtr<Client> conn, bool clear) {
+  MetadataCache &cache = MetadataCache::instance();
+  if(clear) {
+    cache.invalidate(conn.get());
+  }
+  MetadataCache::Stats stats = cache.stats();
+  return List::create(
+      Named("hits") = static_cast<double>(stats.hits),
+      Named("misses") = static_cast<double>(stats.misses),
+      Named("tables") = static_cast<double>(cache.entries(conn.get())));
+}
+
+// write the result of a query to path in the Native format, as the blocks are
+// received, returning the number of rows written
+// [[Rcpp::export]]
+double selectToFile(XPtr<Client> conn, String query, std::string path, bool compress,
+    std::vector<std::string> settingNames, std::vector<std::string> settingValues,
+    std::string queryId) {
+  idleClient(conn);
+  Query q(query);
+  q.SetQueryId(queryId.empty() ? newQueryId() : queryId)
+      .SetSettings(querySettings(settingNames, settingValues));
+  NativeFileWriter writer(path, compress);
+  // unlike a select, an interrupted extract is not kept
+  bool interrupted = false;
+  CancelCheckCallback notInterrupted = [&interrupted] {
+    interrupted = R_ToplevelExec(checkInterruptFn, NULL) == FALSE;
+    return !interrupted;
+  };
+  conn->Execute(q
+      .OnDataCancelable([&writer, &notInterrupted] (const Block& block) {
+        writer.write(block);
+        return notInterrupted();
+      })
+      .OnCancelCheck(notInterrupted));
+  if(interrupted) {
+    stop("the query has been interrupted");
+  }
+  writer.close();
+  return writer.numRows();
+}
+
+// pass the blocks of a query to the C++ callback, as they are received,
+// returning the number of rows passed to it
+// [[Rcpp::export]]
+double streamBlocks(XPtr<Client> conn, String query, SEXP callback,
+    std::vector<std::string> settingNames, std::vector<std::string> settingValues,
+    std::string queryId) {
+  idleClient(conn);
+  const BlockCallback *cb = static_cast<const BlockCallback *>(R_ExternalPtrAddr(callback));
+  if(!cb || !cb->fn) {
+    stop("the callback is a null pointer");
+  }
+  Query q(query);
+  q.SetQueryId(queryId.empty() ? newQueryId() : queryId)
+      .SetSettings(querySettings(settingNames, settingValues));
+  bool interrupted = false;
+  CancelCheckCallback notInterrupted = [&interrupted] {
+    interrupted = R_ToplevelExec(checkInterruptFn, NULL) == FALSE;
+    return !interrupted;
+  };
+  // errors of the callback cancel the query like its returning false, and
+  // are raised once it is done
+  std::string error;
+  double rows = 0;
+  conn->Execute(q
+      .OnDataCancelable([cb, &error, &rows, &notInterrupted] (const Block& block) {
+        if(block.GetRowCount() == 0) {
+          return notInterrupted();
+        }
+        bool more;
+        try {
+          more = cb->fn(block, cb->data);
+        } catch(const std::exception &e) {
+          error = e.what();
+          return false;
+        }
+        rows += block.GetRowCount();
+        return more && notInterrupted();
+      })
+      .OnCancelCheck(notInterrupted));
+  if(!error.empty()) {
+    stop("the callback failed: " + error);
+  }
+  if(interrupted) {
+    stop("the query has been interrupted");
+  }
+  return rows;
+}
+
+// read a file written by selectToFile into a result, converted like those of
+// select
+// [[Rcpp::export]]
+XPtr<Result> readNativeFile(std::string path, bool compressed, std::string int64,
+    std::string uint32, int threads, bool exactDecimal, std::string uuid, bool flatArrays,
+    bool ipAsText, bool utf8) {
+  Int64Format int64Format = parseInt64Format(int64);
+  UInt32Format uint32Format = parseUInt32Format(uint32);
+  UUIDFormat uuidFormat = parseUUIDFormat(uuid);
+  std::unique_ptr<Result> r(new Result(path));
+  r->setInt64Format(int64Format);
+  r->setUInt32Format(uint32Format);
+  r->setExactDecimal(exactDecimal);
+  r->setFlatArrays(flatArrays);
+  r->setIPAsText(ipAsText);
+  r->setUUIDFormat(uuidFormat);
+  r->setUTF8Strings(utf8);
+  r->setConversionThreads(threads);
+  readNativeFile(path, compressed, *r);
+  return XPtr<Result>(r.release(), true);
+}
+
+// whether any of the n entries of data is NA; the entries are checked in
+// blocks without an early exit, so that the comparisons are vectorized
+template<typename ST, typename NAFunc>
+bool anyNA(const ST *data, size_t n, NAFunc isNA) {
+  const size_t blockSize = 256;
+  for(size_t start = 0; start < n; start += blockSize) {
+    const size_t end = std::min(n, start+blockSize);
+    bool any = false;
+    for(size_t i = start; i < end; i++) {
+      any |= isNA(data[i]);
+    }
+    if(any) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// append n values to a column, at once for plain numeric columns
+template<typename CT, typename VT>
+struct BulkAppend {
+  static void append(CT &col, const VT *values, size_t n) {
+    for(size_t i = 0; i < n; i++) {
+      col.Append(values[i]);
+    }
+  }
+};
+
+template<typename T>
+struct BulkAppend<ColumnVector<T>, T> {
+  static void append(ColumnVector<T> &col, const T *values, size_t n) {
+    col.Append(values, n);
+  }
+};
+
+// whether an R value converts to a column value of type VT unchanged: within
+// the range of VT and, for doubles written to integer types, integral
+template<typename VT, bool isInteger = std::is_integral<VT>::value>
+struct InRange {
+  // floating point columns take any value
+  template<typename ST>
+  bool operator()(ST) const { return true; }
+};
+
+template<typename VT>
+struct InRange<VT, true> {
+  bool operator()(int64_t x) const {
+    typedef std::numeric_limits<VT> limits;
+    return limits::is_signed
+      ? x >= static_cast<int64_t>(limits::min()) && x <= static_cast<int64_t>(limits::max())
+      : x >= 0 && static_cast<uint64_t>(x) <= limits::max();
+  }
+  bool operator()(int x) const {
+    return (*this)(static_cast<int64_t>(x));
+  }
+  bool operator()(double x) const {
+    // min() and max()+1 are exact doubles for all integer types
+    typedef std::numeric_limits<VT> limits;
+    return x == std::trunc(x) && x >= static_cast<double>(limits::min()) &&
+      x < static_cast<double>(limits::max())+1.0;
+  }
+};
+
+// for conversions which take any value
+struct AnyValue {
+  template<typename ST>
+  bool operator()(ST) const { return true; }
+};
+
+static std::string formatValue(int x) {
+  return std::to_string(x);
+}
+
+static std::string formatValue(int64_t x) {
+  return std::to_string(x);
+}
+
+static std::string formatValue(double x) {
+  std::ostringstream out;
+  out.precision(17);
+  out << x;
+  return out.str();
+}
+
+// the error for the first entry of data which is not NA but out of range
+template<typename VT, typename CT, typename ST, typename NAFunc, typename Check>
+std::runtime_error rangeError(const CT &col, const ST *data, size_t n, NAFunc isNA, Check inRange) {
+  size_t i = 0;
+  while(i < n && (isNA(data[i]) || inRange(data[i]))) {
+    i++;
+  }
+  return std::runtime_error("cannot write " + formatValue(data[i]) + " at row " + std::to_string(i+1) + " of the block to column of type " +
+      col.Type()->GetName() + (std::is_floating_point<ST>::value && std::is_integral<VT>::value ?
+        ": out of range or not an integer" : ": out of range"));
+}
+
+// appends the n entries of data, converted by conv, to col, and their NA flags
+// to nullCol (if not nullptr; NA entries are an error otherwise), in bulk: the
+// values are converted into one buffer, with 0 at the NA positions, and the
+// NAs are only looked for entry by entry if the scan for any NA finds one.
+// The entries are checked by inRange in the same pass, and the first one out
+// of range is reported.
+template<typename VT, typename CT, typename ST, typename NAFunc, typename Conv,
+  typename Check = AnyValue>
+bool appendConverted(CT &col, ColumnUInt8 *nullCol, const ST *data, size_t n,
+    NAFunc isNA, Conv conv, Check inRange = Check()) {
+  std::vector<VT> values(n);
+  bool outOfRange = false;
+  if(!anyNA(data, n, isNA)) {
+    for(size_t i = 0; i < n; i++) {
+      values[i] = conv(data[i]);
+      outOfRange |= !inRange(data[i]);
+    }
+    if(outOfRange) {
+      throw rangeError<VT>(col, data, n, isNA, inRange);
+    }
+    BulkAppend<CT, VT>::append(col, values.data(), n);
+    if(nullCol) {
+      nullCol->Append(std::vector<uint8_t>(n).data(), n);
+    }
+    return true;
+  } else if(!nullCol) {
+    return false;
+  }
+
+  std::vector<uint8_t> nulls(n);
+  for(size_t i = 0; i < n; i++) {
+    nulls[i] = isNA(data[i]);
+  }
+  for(size_t i = 0; i < n; i++) {
+    values[i] = nulls[i] ? VT() : conv(data[i]);
+    outOfRange |= !nulls[i] && !inRange(data[i]);
+  }
+  if(outOfRange) {
+    throw rangeError<VT>(col, data, n, isNA, inRange);
+  }
+  BulkAppend<CT, VT>::append(col, values.data(), n);
+  nullCol->Append(nulls.data(), n);
+  return true;
+}
+
 // write the contents of an R vector into a Clickhouse column
-template<typename CT, typename RT, typename VT>
+template<typename CT, typename RT, typename VT, typename Conv, typename Check = AnyValue>
 void toColumn(SEXP v, std::shared_ptr<CT> col, std::shared_ptr<ColumnUInt8> nullCol,
-    std::function<VT(typename RT::stored_type)> convertFn) {
+    Conv convertFn, Check inRange = Check()) {
   RT cv = Rcpp::as<RT>(v);
-  if(nullCol) {
-    for(typename RT::stored_type e : cv) {
-      bool isNA = RT::is_na(e);
-      col->Append(isNA ? 0 : convertFn(e));
-      nullCol->Append(isNA);
-    }
-  } else {
-    for(typename RT::stored_type e : cv) {
-      if(RT::is_na(e)) {
-        stop("cannot write NA into a non-nullable column of type "+
-            col->Type()->GetName());
-      }
-      col->Append(convertFn(e));
-    }
+  if(!appendConverted<VT>(*col, nullCol.get(), cv.begin(), cv.size(),
+        [](typename RT::stored_type x) {return RT::is_na(x);}, convertFn, inRange)) {
+    stop("cannot write NA into a non-nullable column of type "+
+        col->Type()->GetName());
   }
 }
 
@@ -118,42 +1055,72 @@ int64_t* rec(SEXP x){
   return res;
 }
 
-// Convert the vector
-std::vector<int64_t> Val(SEXP x){
-  if(!Rf_inherits(x, "integer64")){
-    warning("Converting to int64_t");
-    std::vector<int64_t> retAlt = Rcpp::as<std::vector<int64_t>>(x);
-    return retAlt;
-  };
-  size_t i, n = LENGTH(x);
-  std::vector<int64_t> res(n);
-  for(i=0; i<n; i++){
-    res[i] = rec(x)[i];
-  };
-  return res;
-}
-
 // Special template for integer64 columns to circumvent Rcpp
-template<typename CT, typename RT>
+template<typename CT, typename VT>
 void toColumnN(SEXP v, std::shared_ptr<CT> col, std::shared_ptr<ColumnUInt8> nullCol) {
-  std::vector<int64_t> cv = Val(v);
-  if(nullCol) {
-    for(size_t i=0; i<cv.size(); i++) {
-      bool isNA = (cv[i] == NA_INTEGER64);
-      col->Append(isNA ? 0 : cv[i]);
-      nullCol->Append(isNA);
-    }
-  } else {
-    for(size_t i=0; i<cv.size(); i++) {
-      if(cv[i] == NA_INTEGER64) {
-        stop("cannot write NA into a non-nullable column of type "+
-          col->Type()->GetName());
+  if(!appendConverted<VT>(*col, nullCol.get(), rec(v), XLENGTH(v),
+        [](int64_t x) {return x == NA_INTEGER64;},
+        [](int64_t x) {return static_cast<VT>(x);}, InRange<VT>())) {
+    stop("cannot write NA into a non-nullable column of type "+
+      col->Type()->GetName());
+  }
+}
+
+// append the n entries of an R vector with storage type ST to a column with
+// the same storage layout (integer -> Int32, double -> Float64, integer64 ->
+// Int64/UInt64) in bulk, instead of through Rcpp::as and per-element Append;
+// returns false if the layouts differ, so that the generic path is taken
+template<typename CT, typename ST>
+struct ContiguousAppend {
+  template<typename NAFunc>
+  static bool append(const ST *, size_t, std::shared_ptr<CT>,
+      std::shared_ptr<ColumnUInt8>, NAFunc) {
+    return false;
+  }
+};
+
+template<typename T>
+struct ContiguousAppend<ColumnVector<T>, T> {
+  template<typename NAFunc>
+  static bool append(const T *data, size_t n, std::shared_ptr<ColumnVector<T>> col,
+      std::shared_ptr<ColumnUInt8> nullCol, NAFunc isNA) {
+    if(!anyNA(data, n, isNA)) {
+      // the values are copied as they are, with a zero-filled null map
+      col->Append(data, n);
+      if(nullCol) {
+        nullCol->Append(std::vector<uint8_t>(n).data(), n);
       }
-      col->Append(cv[i]);
+    } else if(nullCol) {
+      // NULL entries are written as 0, like in toColumn
+      std::vector<T> values(data, data+n);
+      std::vector<uint8_t> nulls(n);
+      for(size_t i = 0; i < n; i++) {
+        nulls[i] = isNA(values[i]);
+      }
+      for(size_t i = 0; i < n; i++) {
+        values[i] = nulls[i] ? 0 : values[i];
+      }
+      col->Append(values.data(), n);
+      nullCol->Append(nulls.data(), n);
+    } else {
+      throw std::runtime_error("cannot write NA into a non-nullable column of type "+
+          col->Type()->GetName());
     }
+    return true;
   }
-}
+};
 
+// integer64 vectors are written bit for bit into UInt64 columns as well
+template<>
+struct ContiguousAppend<ColumnUInt64, int64_t> {
+  template<typename NAFunc>
+  static bool append(const int64_t *data, size_t n, std::shared_ptr<ColumnUInt64> col,
+      std::shared_ptr<ColumnUInt8> nullCol, NAFunc) {
+    return ContiguousAppend<ColumnUInt64, uint64_t>::append(
+        reinterpret_cast<const uint64_t *>(data), n, col, nullCol,
+        [](uint64_t x) {return x == static_cast<uint64_t>(NA_INTEGER64);});
+  }
+};
 
 template<typename CT, typename VT>
 std::shared_ptr<CT> vecToScalar(SEXP v, std::shared_ptr<ColumnUInt8> nullCol = nullptr) {
@@ -166,19 +1133,31 @@ std::shared_ptr<CT> vecToScalar(SEXP v, std::shared_ptr<ColumnUInt8> nullCol = n
 
   switch(type_of_cor) {
   case 99: {
-    toColumnN<CT, NumericVector>(v, col, nullCol);
+    if(!ContiguousAppend<CT, int64_t>::append(rec(v), XLENGTH(v), col, nullCol,
+          [](int64_t x) {return x == NA_INTEGER64;})) {
+      toColumnN<CT, VT>(v, col, nullCol);
+    }
     break;
   }
     case INTSXP: {
+      if(ContiguousAppend<CT, int>::append(INTEGER(v), XLENGTH(v), col, nullCol,
+            [](int x) {return x == NA_INTEGER;})) {
+        break;
+      }
       // the lambda could be a default argument of toColumn, but that
       // appears to trigger a bug in GCC
       toColumn<CT, IntegerVector, VT>(v, col, nullCol,
-          [](IntegerVector::stored_type x) {return x;});
+          [](IntegerVector::stored_type x) {return x;}, InRange<VT>());
       break;
     }
     case REALSXP: {
+      // NaN is treated as NA, like Rcpp's is_na does
+      if(ContiguousAppend<CT, double>::append(REAL(v), XLENGTH(v), col, nullCol,
+            [](double x) {return std::isnan(x);})) {
+        break;
+      }
       toColumn<CT, NumericVector, VT>(v, col, nullCol,
-          [](NumericVector::stored_type x) {return x;});
+          [](NumericVector::stored_type x) {return x;}, InRange<VT>());
       break;
     }
     case LGLSXP: {
@@ -194,40 +1173,14 @@ std::shared_ptr<CT> vecToScalar(SEXP v, std::shared_ptr<ColumnUInt8> nullCol = n
           " to column of type "+col->Type()->GetName());
   }
   return col;
-}
-
-template<>
-std::shared_ptr<ColumnDate> vecToScalar<ColumnDate, const std::time_t>(SEXP v,
-    std::shared_ptr<ColumnUInt8> nullCol) {
-  auto col = std::make_shared<ColumnDate>();
-  switch(TYPEOF(v)) {
-    case REALSXP: {
-      toColumn<ColumnDate, DateVector, const std::time_t>(v, col, nullCol,
-          Rf_inherits(v, "POSIXct") ?
-            [](DateVector::stored_type x) {return x;} :
-            [](DateVector::stored_type x) {return x*(60*60*24);});
-      break;
-    }
-    case NILSXP:
-      // treated as an empty column
-      break;
-    default:
-      stop("cannot write R type "+std::to_string(TYPEOF(v))+
-          " to column of type Date");
-  }
-  return col;
-}
-
-UInt128 parseUUID(const std::string &str) {
-  unsigned long long p1, p2, p3, p4, p5;
-  int ret = std::sscanf(str.c_str(), "%8llx-%4llx-%4llx-%4llx-%012llx", &p1, &p2, &p3, &p4, &p5);
-  if(ret != 5 || str.length() > 36) {
-    stop("invalid UUID "+str+"; must be xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx where x are hexadecimal characters");
-  }
-
-  uint64_t hi = (p1<<32) | (p2<<16) | p3,
-           lo = (p4<<48) | p5;
-  return UInt128(hi, lo);
+}
+
+UInt128 parseUUID(const char *str) {
+  UInt128 v;
+  if(!parseUUID(str, std::strlen(str), v)) {
+    throw std::runtime_error("invalid UUID "+std::string(str)+"; must be xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx where x are hexadecimal characters");
+  }
+  return v;
 }
 
 template<>
@@ -238,19 +1191,16 @@ std::shared_ptr<ColumnUUID> vecToScalar<ColumnUUID, UInt128>(SEXP v,
     case INTSXP:
     case STRSXP: {
       auto sv = Rcpp::as<StringVector>(v);
-      if(nullCol) {
-        for(auto e : sv) {
-          bool isNA = StringVector::is_na(e);
-          col->Append(isNA ? ch::UInt128(0, 0) : parseUUID(std::string(e)));
-          nullCol->Append(isNA);
+      for(R_xlen_t i = 0; i < sv.size(); i++) {
+        SEXP e = STRING_ELT(sv, i);
+        bool isNA = e == NA_STRING;
+        if(isNA && !nullCol) {
+          stop("cannot write NA into a non-nullable column of type "+
+              col->Type()->GetName());
         }
-      } else {
-        for(auto e : sv) {
-          if(StringVector::is_na(e)) {
-            stop("cannot write NA into a non-nullable column of type "+
-                col->Type()->GetName());
-          }
-          col->Append(parseUUID(std::string(e)));
+        col->Append(isNA ? ch::UInt128(0, 0) : parseUUID(CHAR(e)));
+        if(nullCol) {
+          nullCol->Append(isNA);
         }
       }
       break;
@@ -265,11 +1215,66 @@ std::shared_ptr<ColumnUUID> vecToScalar<ColumnUUID, UInt128>(SEXP v,
   return col;
 }
 
+bool isFactor(SEXP v) {
+  return TYPEOF(v) == INTSXP && TYPEOF(Rf_getAttrib(v, R_LevelsSymbol)) == STRSXP;
+}
+
+// the levels of a factor, as bytes to be written, and whether they are NA
+struct FactorLevels {
+  std::vector<std::string> bytes;
+  std::vector<bool> na;
+
+  explicit FactorLevels(SEXP v) {
+    SEXP levels = Rf_getAttrib(v, R_LevelsSymbol);
+    for(R_xlen_t i = 0; i < Rf_xlength(levels); i++) {
+      SEXP e = STRING_ELT(levels, i);
+      na.push_back(e == NA_STRING);
+      bytes.push_back(e == NA_STRING ? std::string() : std::string(CHAR(e)));
+    }
+  }
+
+  // whether code (starting at 1) stands for NA, stopping at invalid ones
+  bool isNA(int code) const {
+    if(code == NA_INTEGER) {
+      return true;
+    }
+    if(code < 1 || static_cast<size_t>(code) > bytes.size()) {
+      stop("invalid factor code "+std::to_string(code));
+    }
+    return na[code-1];
+  }
+};
+
+// appends the levels of the rows of a factor, each of which is converted once
+template<typename CT>
+void factorToStrings(CT &col, SEXP v, std::shared_ptr<ColumnUInt8> nullCol) {
+  FactorLevels levels(v);
+  const int *codes = INTEGER(v);
+  const R_xlen_t n = Rf_xlength(v);
+  const std::string empty;
+  for(R_xlen_t i = 0; i < n; i++) {
+    const bool isNA = levels.isNA(codes[i]);
+    if(isNA && !nullCol) {
+      stop("cannot write NA into a non-nullable column of type "+col.Type()->GetName());
+    }
+    col.Append(isNA ? empty : levels.bytes[codes[i]-1]);
+    if(nullCol) {
+      nullCol->Append(isNA);
+    }
+  }
+}
+
 template<typename CT, typename VT>
 std::shared_ptr<CT> vecToString(SEXP v, std::shared_ptr<ColumnUInt8> nullCol = nullptr) {
   auto col = std::make_shared<CT>();
   switch(TYPEOF(v)) {
     case INTSXP:
+      if(isFactor(v)) {
+        factorToStrings(*col, v, nullCol);
+        break;
+      }
+      // other integers are written as their decimal representation
+      // fall through
     case STRSXP: {
       auto sv = Rcpp::as<StringVector>(v);
       if(nullCol) {
@@ -335,7 +1340,332 @@ std::shared_ptr<CT> vecToEnum(SEXP v, TypeRef type, std::shared_ptr<ColumnUInt8>
   return col;
 }
 
-ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol = nullptr) {
+int64_t decimalPow10(size_t e) {
+  int64_t p = 1;
+  for(size_t i = 0; i < e; i++) {
+    p *= 10;
+  }
+  return p;
+}
+
+// appends the n values given by get(i, unscaled), which returns whether entry
+// i is NA, to the storage of a Decimal column with the given precision
+template<typename CT, typename F>
+void appendUnscaled(CT &data, size_t n, size_t precision, const std::string &typeName,
+    std::shared_ptr<ColumnUInt8> nullCol, F get) {
+  const int64_t bound = decimalPow10(precision);
+  for(size_t i = 0; i < n; i++) {
+    int64_t x = 0;
+    bool isNA = get(i, x);
+    if(isNA && !nullCol) {
+      stop("cannot write NA into a non-nullable column of type "+typeName);
+    }
+    if(!isNA && (x >= bound || x <= -bound)) {
+      stop("value out of range for column of type "+typeName);
+    }
+    data.Append(isNA ? 0 : static_cast<typename CT::DataType>(x));
+    if(nullCol) {
+      nullCol->Append(isNA);
+    }
+  }
+}
+
+// numbers are scaled (and rounded) to the scale of the column; integer64
+// vectors with a "scale" attribute, as returned in exact decimal mode, hold
+// unscaled values, which are only rescaled if the scales differ; strings are
+// parsed by ColumnDecimal itself
+template<typename CT>
+void vecToUnscaled(SEXP v, CT &data, ColumnDecimal &col, size_t precision, size_t scale,
+    std::shared_ptr<ColumnUInt8> nullCol) {
+  const std::string typeName = col.Type()->GetName();
+  // values beyond which the scaled value would be out of range anyway
+  const int64_t bound = decimalPow10(precision);
+  const size_t n = Rf_xlength(v);
+  switch(TYPEOF(v)) {
+    case REALSXP: {
+      if(Rf_inherits(v, "integer64")) {
+        SEXP scaleAttr = Rf_getAttrib(v, Rf_install("scale"));
+        int srcScale = Rf_isNull(scaleAttr) ? 0 : Rf_asInteger(scaleAttr);
+        if(srcScale < 0 || static_cast<size_t>(srcScale) > scale) {
+          stop("cannot write integer64 values of scale "+std::to_string(srcScale)+
+              " to column of type "+typeName);
+        }
+        const int64_t factor = decimalPow10(scale-srcScale);
+        const int64_t *cv = rec(v);
+        appendUnscaled(data, n, precision, typeName, nullCol, [cv, factor, bound](size_t i, int64_t &x) {
+          if(cv[i] == NA_INTEGER64) {
+            return true;
+          }
+          // clamp before scaling, so that the range check can't overflow
+          x = cv[i] >= bound/factor+1 ? bound : cv[i] <= -bound/factor-1 ? -bound : cv[i]*factor;
+          return false;
+        });
+      } else {
+        const double *cv = REAL(v);
+        const double factor = std::pow(10.0, scale);
+        appendUnscaled(data, n, precision, typeName, nullCol, [cv, factor, bound](size_t i, int64_t &x) {
+          if(std::isnan(cv[i])) {
+            return true;
+          }
+          double scaled = std::round(cv[i]*factor);
+          x = std::fabs(scaled) >= bound ? bound : static_cast<int64_t>(scaled);
+          return false;
+        });
+      }
+      break;
+    }
+    case INTSXP:
+    case LGLSXP: {
+      const int *cv = TYPEOF(v) == INTSXP ? INTEGER(v) : LOGICAL(v);
+      const int64_t factor = decimalPow10(scale);
+      appendUnscaled(data, n, precision, typeName, nullCol, [cv, factor, bound](size_t i, int64_t &x) {
+        if(cv[i] == NA_INTEGER) {
+          return true;
+        }
+        x = cv[i] >= bound/factor+1 ? bound : cv[i] <= -bound/factor-1 ? -bound : cv[i]*factor;
+        return false;
+      });
+      break;
+    }
+    case STRSXP:
+      for(size_t i = 0; i < n; i++) {
+        SEXP e = STRING_ELT(v, i);
+        bool isNA = e == NA_STRING;
+        if(isNA && !nullCol) {
+          stop("cannot write NA into a non-nullable column of type "+typeName);
+        }
+        col.Append(isNA ? std::string("0") : std::string(CHAR(e)));
+        if(nullCol) {
+          nullCol->Append(isNA);
+        }
+      }
+      break;
+    case NILSXP:
+      // treated as an empty column
+      break;
+    default:
+      stop("cannot write R type "+std::to_string(TYPEOF(v))+
+          " to column of type "+typeName);
+  }
+}
+
+std::shared_ptr<ColumnDecimal> vecToDecimal(SEXP v, TypeRef type,
+    std::shared_ptr<ColumnUInt8> nullCol = nullptr) {
+  auto dec_t = std::static_pointer_cast<DecimalType>(type);
+  const size_t precision = dec_t->GetPrecision(), scale = dec_t->GetScale();
+  auto col = std::make_shared<ColumnDecimal>(precision, scale);
+  ColumnRef data = col->GetNestedColumn();
+  if(precision <= 9) {
+    vecToUnscaled(v, *data->As<ColumnInt32>(), *col, precision, scale, nullCol);
+  } else if(precision <= 18) {
+    vecToUnscaled(v, *data->As<ColumnInt64>(), *col, precision, scale, nullCol);
+  } else {
+    // see buildConverter in result.cpp
+    stop("cannot write unsupported type: "+type->GetName());
+  }
+  return col;
+}
+
+ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol = nullptr);
+ColumnRef vecToRaw(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol);
+
+// concatenates the vectors in the list v into flat, keeping the attributes of
+// the first non-empty one, and stores the end offset of each of them; returns
+// false if the non-empty ones differ in type or class (or are factors with
+// different levels)
+bool flattenList(SEXP v, RObject &flat, std::shared_ptr<ColumnUInt64> offsets) {
+  const R_xlen_t n = Rf_xlength(v);
+  SEXP first = R_NilValue;
+  uint64_t total = 0;
+  for(R_xlen_t i = 0; i < n; i++) {
+    SEXP e = VECTOR_ELT(v, i);
+    if(Rf_xlength(e) > 0) {
+      if(first == R_NilValue) {
+        first = e;
+      } else if(TYPEOF(e) != TYPEOF(first) ||
+          !R_compute_identical(Rf_getAttrib(e, R_ClassSymbol), Rf_getAttrib(first, R_ClassSymbol), 0) ||
+          !R_compute_identical(Rf_getAttrib(e, R_LevelsSymbol), Rf_getAttrib(first, R_LevelsSymbol), 0)) {
+        return false;
+      }
+      total += Rf_xlength(e);
+    }
+    offsets->Append(total);
+  }
+  if(first == R_NilValue) {
+    // only empty entries: the NILSXP is converted into an empty column
+    flat = R_NilValue;
+    return true;
+  }
+
+  flat = Rf_allocVector(TYPEOF(first), total);
+  R_xlen_t pos = 0;
+  for(R_xlen_t i = 0; i < n; i++) {
+    SEXP e = VECTOR_ELT(v, i);
+    const R_xlen_t len = Rf_xlength(e);
+    if(len == 0) {
+      continue;
+    }
+    switch(TYPEOF(first)) {
+      case LGLSXP:
+        std::copy(LOGICAL(e), LOGICAL(e)+len, LOGICAL(flat)+pos);
+        break;
+      case INTSXP:
+        std::copy(INTEGER(e), INTEGER(e)+len, INTEGER(flat)+pos);
+        break;
+      case REALSXP:
+        std::copy(REAL(e), REAL(e)+len, REAL(flat)+pos);
+        break;
+      case STRSXP:
+        for(R_xlen_t j = 0; j < len; j++) {
+          SET_STRING_ELT(flat, pos+j, STRING_ELT(e, j));
+        }
+        break;
+      case VECSXP:
+        for(R_xlen_t j = 0; j < len; j++) {
+          SET_VECTOR_ELT(flat, pos+j, VECTOR_ELT(e, j));
+        }
+        break;
+      default:
+        return false;
+    }
+    pos += len;
+  }
+  Rf_copyMostAttrib(first, flat);
+  return true;
+}
+
+// list columns are written by converting the concatenation of their entries
+// into the data column of the arrays at once, instead of one column per entry
+ColumnRef vecToArray(TypeRef itemType, SEXP v) {
+  if(TYPEOF(v) == VECSXP) {
+    auto offsets = std::make_shared<ColumnUInt64>();
+    RObject flat;
+    if(flattenList(v, flat, offsets)) {
+      return std::make_shared<ColumnArray>(vecToColumn(itemType, flat), offsets);
+    }
+  }
+
+  // entries of different types (e.g. integer and double vectors) are
+  // converted one by one
+  std::shared_ptr<ColumnArray> arrCol = nullptr;
+  Rcpp::List rlist = Rcpp::as<Rcpp::List>(v);
+  for(typename Rcpp::List::stored_type e : rlist) {
+    auto valCol = vecToColumn(itemType, e);
+    if (!arrCol) {
+      // create a zero-length copy (necessary because the ColumnArray
+      // constructor mangles the argument column)
+      auto initCol = valCol->Slice(0, 0);
+      // initialize the array column with the type of the R vector's first element
+      arrCol = std::make_shared<ColumnArray>(initCol);
+    }
+    arrCol->AppendAsColumn(valCol);
+  }
+  return arrCol;
+}
+
+// lists of named vectors are written to maps: the names are the keys (parsed
+// as numbers for numeric key types) and the concatenated entries the values
+ColumnRef vecToMap(std::shared_ptr<MapType> t, SEXP v) {
+  if(TYPEOF(v) != VECSXP) {
+    stop("cannot write R type "+std::to_string(TYPEOF(v))+" to column of type "+t->GetName()+
+        "; must be a list of named vectors");
+  }
+  auto offsets = std::make_shared<ColumnUInt64>();
+  RObject values;
+  if(!flattenList(v, values, offsets)) {
+    stop("the values written to column of type "+t->GetName()+" differ in type");
+  }
+
+  const R_xlen_t n = Rf_xlength(v);
+  Rcpp::CharacterVector keys(offsets->Size() ? offsets->At(offsets->Size()-1) : 0);
+  R_xlen_t pos = 0;
+  for(R_xlen_t i = 0; i < n; i++) {
+    SEXP e = VECTOR_ELT(v, i);
+    const R_xlen_t len = e == R_NilValue ? 0 : Rf_xlength(e);
+    SEXP names = Rf_getAttrib(e, R_NamesSymbol);
+    if(len > 0 && names == R_NilValue) {
+      stop("the entries written to column of type "+t->GetName()+" must be named");
+    }
+    for(R_xlen_t j = 0; j < len; j++) {
+      SET_STRING_ELT(keys, pos+j, STRING_ELT(names, j));
+    }
+    pos += len;
+  }
+
+  using TC = Type::Code;
+  RObject keyVec = keys;
+  switch(t->GetKeyType()->GetCode()) {
+    case TC::Int8: case TC::Int16: case TC::Int32: case TC::Int64:
+    case TC::UInt8: case TC::UInt16: case TC::UInt32: case TC::UInt64:
+    case TC::Float32: case TC::Float64:
+      keyVec = Rf_coerceVector(keys, REALSXP);
+      break;
+    case TC::String: case TC::FixedString: case TC::LowCardinality:
+    case TC::Enum8: case TC::Enum16:
+      break;
+    default:
+      stop("cannot write the keys of column of type "+t->GetName());
+  }
+  return std::make_shared<ColumnMap>(vecToColumn(t->GetKeyType(), keyVec),
+      vecToColumn(t->GetValueType(), values), offsets);
+}
+
+// whether the dictionary type of a LowCardinality column is String or
+// Nullable(String), so that factors are written as their levels and codes
+bool stringDictionary(TypeRef dictType) {
+  if(dictType->GetCode() == Type::Nullable) {
+    dictType = std::static_pointer_cast<NullableType>(dictType)->GetNestedType();
+  }
+  return dictType->GetCode() == Type::String;
+}
+
+template<typename T>
+ColumnRef factorPositions(const int *codes, R_xlen_t n, const FactorLevels &levels,
+    bool nullable, const std::string &typeName) {
+  std::vector<T> positions(n);
+  for(R_xlen_t i = 0; i < n; i++) {
+    if(levels.isNA(codes[i])) {
+      if(!nullable) {
+        stop("cannot write NA into a non-nullable column of type "+typeName);
+      }
+      positions[i] = 0;
+    } else {
+      positions[i] = static_cast<T>(nullable ? codes[i] : codes[i]-1);
+    }
+  }
+  return std::make_shared<ColumnVector<T>>(std::move(positions));
+}
+
+// a factor written to a LowCardinality column of the given dictionary type:
+// its levels are sent as the dictionary, and its codes as the positions in
+// it, instead of one string per row; in a nullable dictionary position 0
+// stands for NULL
+ColumnRef factorToLowCardinality(SEXP v, TypeRef dictType) {
+  const bool nullable = dictType->GetCode() == Type::Nullable;
+  FactorLevels levels(v);
+  auto dictionary = std::make_shared<ColumnString>();
+  if(nullable) {
+    dictionary->Append(std::string());
+  }
+  for(const auto &level : levels.bytes) {
+    dictionary->Append(level);
+  }
+
+  const std::string typeName = "LowCardinality("+dictType->GetName()+")";
+  const int *codes = INTEGER(v);
+  const R_xlen_t n = Rf_xlength(v);
+  ColumnRef positions;
+  if(dictionary->Size() <= 0x100) {
+    positions = factorPositions<uint8_t>(codes, n, levels, nullable, typeName);
+  } else if(dictionary->Size() <= 0x10000) {
+    positions = factorPositions<uint16_t>(codes, n, levels, nullable, typeName);
+  } else {
+    positions = factorPositions<uint32_t>(codes, n, levels, nullable, typeName);
+  }
+  return std::make_shared<ColumnLowCardinality>(dictionary, positions, nullable);
+}
+
+ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol) {
   using TC = Type::Code;
   switch(t->GetCode()) {
     case TC::Int8:
@@ -356,6 +1686,10 @@ ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol =
       return vecToScalar<ColumnUInt64, uint64_t>(v, nullCol);
     case TC::UUID:
       return vecToScalar<ColumnUUID, UInt128>(v, nullCol);
+    case TC::Decimal:
+    case TC::Decimal32:
+    case TC::Decimal64:
+      return vecToDecimal(v, t, nullCol);
     case TC::Float32:
       return vecToScalar<ColumnFloat32, float>(v, nullCol);
     case TC::Float64:
@@ -363,9 +1697,17 @@ ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol =
     case TC::String:
       return vecToString<ColumnString, const std::string>(v, nullCol);
     case TC::DateTime:
-      return vecToScalar<ColumnDateTime, const std::time_t>(v);
+    case TC::DateTime64:
     case TC::Date:
-      return vecToScalar<ColumnDate, const std::time_t>(v);
+      return vecToRaw(t, v, nullCol);
+    case TC::LowCardinality: {
+      auto lc_t = std::static_pointer_cast<LowCardinalityType>(t);
+      if(!nullCol && isFactor(v) && stringDictionary(lc_t->GetNestedType())) {
+        return factorToLowCardinality(v, lc_t->GetNestedType());
+      }
+      // the server converts the plain values of the dictionary type
+      return vecToColumn(lc_t->GetNestedType(), v, nullCol);
+    }
     case TC::Nullable: {
       // downcast to NullableType to access GetItemType member
       std::shared_ptr<class NullableType> nullable_t = std::static_pointer_cast<NullableType>(t);
@@ -374,26 +1716,10 @@ ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol =
       auto valCol = vecToColumn(nullable_t->GetNestedType(), v, nullCtlCol);
       return std::make_shared<ColumnNullable>(valCol, nullCtlCol);
     }
-    case TC::Array: {
-      // downcast to ArrayType to access GetItemType member
-      std::shared_ptr<class ArrayType> arr_t = std::static_pointer_cast<ArrayType>(t);
-
-      std::shared_ptr<ColumnArray> arrCol = nullptr;
-      Rcpp::List rlist = Rcpp::as<Rcpp::List>(v);
-
-      for(typename Rcpp::List::stored_type e : rlist) {
-        auto valCol = vecToColumn(arr_t->GetItemType(), e);
-        if (!arrCol) {
-          // create a zero-length copy (necessary because the ColumnArray
-          // constructor mangles the argument column)
-          auto initCol = valCol->Slice(0, 0);
-          // initialize the array column with the type of the R vector's first element
-          arrCol = std::make_shared<ColumnArray>(initCol);
-        }
-        arrCol->AppendAsColumn(valCol);
-      }
-      return arrCol;
-    }
+    case TC::Array:
+      return vecToArray(std::static_pointer_cast<ArrayType>(t)->GetItemType(), v);
+    case TC::Map:
+      return vecToMap(std::static_pointer_cast<MapType>(t), v);
     case TC::Enum8:
       return vecToEnum<ColumnEnum8, int8_t>(v, t, nullCol);
     case TC::Enum16:
@@ -403,32 +1729,1264 @@ ColumnRef vecToColumn(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol =
   }
 }
 
-// [[Rcpp::export]]
-void insert(XPtr<Client> conn, String tableName, DataFrame df) {
-  StringVector names(df.names());
-  std::vector<TypeRef> colTypes;
+// copies the rows [start, start+len) of an R vector, keeping its attributes
+// (class, levels, ...) so that it converts like the original
+RObject sliceVector(SEXP v, R_xlen_t start, R_xlen_t len) {
+  if(start == 0 && len == Rf_xlength(v)) {
+    return v;
+  }
+  RObject out(Rf_allocVector(TYPEOF(v), len));
+  switch(TYPEOF(v)) {
+    case LGLSXP:
+      std::copy(LOGICAL(v)+start, LOGICAL(v)+start+len, LOGICAL(out));
+      break;
+    case INTSXP:
+      std::copy(INTEGER(v)+start, INTEGER(v)+start+len, INTEGER(out));
+      break;
+    case REALSXP:
+      std::copy(REAL(v)+start, REAL(v)+start+len, REAL(out));
+      break;
+    case STRSXP:
+      for(R_xlen_t i = 0; i < len; i++) {
+        SET_STRING_ELT(out, i, STRING_ELT(v, start+i));
+      }
+      break;
+    case VECSXP:
+      for(R_xlen_t i = 0; i < len; i++) {
+        SET_VECTOR_ELT(out, i, VECTOR_ELT(v, start+i));
+      }
+      break;
+    default:
+      stop("cannot write R vector of type " + std::to_string(TYPEOF(v)));
+  }
+  Rf_copyMostAttrib(v, out);
+  return out;
+}
+
+// Inserted blocks are built in parallel from raw views of the R vectors: their
+// storage pointers, string CHARs and factor levels are gathered on the R
+// thread, so that the worker threads call no R API functions (and report
+// errors as std::runtime_error). Columns without a raw view, like arrays, are
+// converted by vecToColumn on the R thread.
+
+// rows [start, start+n) of an R vector
+struct RawView {
+  enum Kind { Integer, Real, Integer64, String } kind;
+  int sexpType;
+  bool posixct;
+  size_t n;
+  const void *data;                   // storage of Integer, Real and Integer64
+  std::vector<const char *> strings;  // String: CHARs, nullptr for NA
+  std::vector<std::string> levels;    // factor levels
+};
+
+struct IsNAValue {
+  bool operator()(int x) const { return x == NA_INTEGER; }
+  // NaN is treated as NA, like Rcpp's is_na does
+  bool operator()(double x) const { return std::isnan(x); }
+  bool operator()(int64_t x) const { return x == NA_INTEGER64; }
+};
+
+template<typename VT>
+struct CastTo {
+  template<typename ST>
+  VT operator()(ST x) const { return static_cast<VT>(x); }
+};
+
+// R's Dates (and POSIXct seconds) to the days of a Date column; like the
+// seconds of DateTime columns, fractions are truncated
+struct ToDays {
+  bool posixct;
+  uint16_t operator()(double x) const {
+    return static_cast<uint16_t>(posixct ? static_cast<std::time_t>(x)/(60*60*24) : x);
+  }
+  uint16_t operator()(int x) const { return static_cast<uint16_t>(x); }
+};
 
-  // determine actual column types
-  conn->Select("SELECT * FROM "+std::string(tableName)+" LIMIT 0", [&colTypes] (const Block& block) {
-    if(block.GetColumnCount() > 0 && colTypes.empty()) {
-      for(ch::Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
-        colTypes.push_back(bi.Type());
+// seconds to the ticks of a DateTime64 column, rounding fractional seconds
+struct SecondsToTicks {
+  int64_t ticksPerSecond;
+  int64_t operator()(double x) const { return std::llround(x*ticksPerSecond); }
+  int64_t operator()(int x) const { return x*ticksPerSecond; }
+  int64_t operator()(int64_t x) const { return x*ticksPerSecond; }
+};
+
+template<typename VT>
+struct LevelToEnum {
+  const std::vector<VT> *levelMap;
+  // subtract 1 since R's factor values start at 1
+  VT operator()(int x) const { return (*levelMap)[x-1]; }
+};
+
+std::runtime_error typeError(const RawView &rv, TypeRef t) {
+  return std::runtime_error("cannot write R type "+std::to_string(rv.sexpType)+
+      " to column of type "+t->GetName());
+}
+
+// appends the n entries of data, converted by conv, like toColumn
+template<typename VT, typename CT, typename ST, typename Conv, typename Check = AnyValue>
+void appendRaw(CT &col, ColumnUInt8 *nullCol, const ST *data, size_t n, Conv conv,
+    Check inRange = Check()) {
+  if(!appendConverted<VT>(col, nullCol, data, n, IsNAValue(), conv, inRange)) {
+    throw std::runtime_error("cannot write NA into a non-nullable column of type "+
+        col.Type()->GetName());
+  }
+}
+
+template<typename CT, typename VT>
+ColumnRef rawToScalar(const RawView &rv, TypeRef t, std::shared_ptr<ColumnUInt8> nullCol) {
+  auto col = std::make_shared<CT>();
+  switch(rv.kind) {
+    case RawView::Integer: {
+      auto data = static_cast<const int *>(rv.data);
+      if(!ContiguousAppend<CT, int>::append(data, rv.n, col, nullCol, IsNAValue())) {
+        appendRaw<VT>(*col, nullCol.get(), data, rv.n, CastTo<VT>(), InRange<VT>());
       }
+      break;
     }
-  });
+    case RawView::Real: {
+      auto data = static_cast<const double *>(rv.data);
+      if(!ContiguousAppend<CT, double>::append(data, rv.n, col, nullCol, IsNAValue())) {
+        appendRaw<VT>(*col, nullCol.get(), data, rv.n, CastTo<VT>(), InRange<VT>());
+      }
+      break;
+    }
+    case RawView::Integer64: {
+      auto data = static_cast<const int64_t *>(rv.data);
+      if(!ContiguousAppend<CT, int64_t>::append(data, rv.n, col, nullCol, IsNAValue())) {
+        appendRaw<VT>(*col, nullCol.get(), data, rv.n, CastTo<VT>(), InRange<VT>());
+      }
+      break;
+    }
+    default:
+      throw typeError(rv, t);
+  }
+  return col;
+}
+
+// the days are converted into a buffer, which is appended to the column's
+// UInt16 storage at once
+template<typename ST>
+void appendDays(ColumnDate &col, ColumnUInt8 *nullCol, const ST *data, size_t n, ToDays conv) {
+  IsNAValue isNA;
+  std::vector<uint16_t> days(n);
+  std::vector<uint8_t> nulls(nullCol ? n : 0);
+  for(size_t i = 0; i < n; i++) {
+    bool na = isNA(data[i]);
+    if(na && !nullCol) {
+      throw std::runtime_error("cannot write NA into a non-nullable column of type Date");
+    }
+    days[i] = na ? 0 : conv(data[i]);
+    if(nullCol) {
+      nulls[i] = na;
+    }
+  }
+  col.AppendDays(days.data(), n);
+  if(nullCol) {
+    nullCol->Append(nulls.data(), n);
+  }
+}
 
-  if(colTypes.size() != static_cast<size_t>(df.size())) {
-    stop("input has "+std::to_string(df.size())+" columns, but table "+
-        std::string(tableName)+" has "+std::to_string(colTypes.size()));
+ColumnRef rawToDate(const RawView &rv, TypeRef t, std::shared_ptr<ColumnUInt8> nullCol) {
+  auto col = std::make_shared<ColumnDate>();
+  switch(rv.kind) {
+    case RawView::Real:
+      appendDays(*col, nullCol.get(), static_cast<const double *>(rv.data), rv.n, ToDays{rv.posixct});
+      break;
+    case RawView::Integer:
+      appendDays(*col, nullCol.get(), static_cast<const int *>(rv.data), rv.n, ToDays{false});
+      break;
+    default:
+      throw typeError(rv, t);
   }
+  return col;
+}
 
-  Block block;
-  for(size_t i = 0; i < colTypes.size(); i++) {
-    ColumnRef ccol = vecToColumn(colTypes[i], df[i]);
-    block.AppendColumn(std::string(names[i]), ccol);
+// DateTime columns take the seconds (truncated), DateTime64 columns their ticks;
+// both keep the time zone of the column type
+ColumnRef rawToDateTime(const RawView &rv, TypeRef t, std::shared_ptr<ColumnUInt8> nullCol) {
+  if(t->GetCode() == Type::DateTime) {
+    auto col = std::make_shared<ColumnDateTime>(std::static_pointer_cast<DateTimeType>(t)->GetTimezone());
+    switch(rv.kind) {
+      case RawView::Integer:
+        appendRaw<std::time_t>(*col, nullCol.get(), static_cast<const int *>(rv.data), rv.n,
+            CastTo<std::time_t>());
+        break;
+      case RawView::Real:
+        appendRaw<std::time_t>(*col, nullCol.get(), static_cast<const double *>(rv.data), rv.n,
+            CastTo<std::time_t>());
+        break;
+      case RawView::Integer64:
+        appendRaw<std::time_t>(*col, nullCol.get(), static_cast<const int64_t *>(rv.data), rv.n,
+            CastTo<std::time_t>());
+        break;
+      default:
+        throw typeError(rv, t);
+    }
+    return col;
+  }
+  auto dt_t = std::static_pointer_cast<DateTime64Type>(t);
+  auto col = std::make_shared<ColumnDateTime64>(dt_t->GetPrecision(), dt_t->GetTimezone());
+  SecondsToTicks conv{decimalPow10(dt_t->GetPrecision())};
+  switch(rv.kind) {
+    case RawView::Integer:
+      appendRaw<int64_t>(*col, nullCol.get(), static_cast<const int *>(rv.data), rv.n, conv);
+      break;
+    case RawView::Real:
+      appendRaw<int64_t>(*col, nullCol.get(), static_cast<const double *>(rv.data), rv.n, conv);
+      break;
+    case RawView::Integer64:
+      appendRaw<int64_t>(*col, nullCol.get(), static_cast<const int64_t *>(rv.data), rv.n, conv);
+      break;
+    default:
+      throw typeError(rv, t);
+  }
+  return col;
+}
+
+template<typename CT, typename VT>
+ColumnRef rawToEnum(const RawView &rv, TypeRef t, std::shared_ptr<ColumnUInt8> nullCol) {
+  if(rv.kind != RawView::Integer) {
+    throw std::runtime_error("cannot write factor of type "+std::to_string(rv.sexpType)+
+        " to column of type "+t->GetName());
+  }
+  auto et = std::static_pointer_cast<EnumType>(t);
+  std::vector<VT> levelMap(rv.levels.size());
+  for(size_t i = 0; i < rv.levels.size(); i++) {
+    if(!et->HasEnumName(rv.levels[i])) {
+      throw std::runtime_error("entry '"+rv.levels[i]+"' does not exist in enum type "+
+          et->GetName());
+    }
+    levelMap[i] = et->GetEnumValue(rv.levels[i]);
+  }
+  auto col = std::make_shared<CT>(t);
+  appendRaw<VT>(*col, nullCol.get(), static_cast<const int *>(rv.data), rv.n,
+      LevelToEnum<VT>{&levelMap});
+  return col;
+}
+
+// appends the strings, converted by conv, like vecToString
+template<typename CT, typename VT, typename Conv>
+ColumnRef rawToStrings(const RawView &rv, TypeRef t, std::shared_ptr<ColumnUInt8> nullCol,
+    Conv conv) {
+  if(rv.kind != RawView::String) {
+    throw typeError(rv, t);
+  }
+  auto col = std::make_shared<CT>();
+  for(size_t i = 0; i < rv.n; i++) {
+    bool na = !rv.strings[i];
+    if(na && !nullCol) {
+      throw std::runtime_error("cannot write NA into a non-nullable column of type "+
+          t->GetName());
+    }
+    col->Append(na ? VT() : conv(rv.strings[i]));
+    if(nullCol) {
+      nullCol->Append(na);
+    }
   }
+  return col;
+}
+
+struct ToString {
+  std::string operator()(const char *s) const { return s; }
+};
+
+struct ToUUID {
+  UInt128 operator()(const char *s) const { return parseUUID(s); }
+};
+
+// the counterpart of vecToColumn for the types accepted by rawConvertible
+ColumnRef rawToColumn(TypeRef t, const RawView &rv, std::shared_ptr<ColumnUInt8> nullCol = nullptr) {
+  using TC = Type::Code;
+  switch(t->GetCode()) {
+    case TC::Int8:
+      return rawToScalar<ColumnInt8, int8_t>(rv, t, nullCol);
+    case TC::Int16:
+      return rawToScalar<ColumnInt16, int16_t>(rv, t, nullCol);
+    case TC::Int32:
+      return rawToScalar<ColumnInt32, int32_t>(rv, t, nullCol);
+    case TC::Int64:
+      return rawToScalar<ColumnInt64, int64_t>(rv, t, nullCol);
+    case TC::UInt8:
+      return rawToScalar<ColumnUInt8, uint8_t>(rv, t, nullCol);
+    case TC::UInt16:
+      return rawToScalar<ColumnUInt16, uint16_t>(rv, t, nullCol);
+    case TC::UInt32:
+      return rawToScalar<ColumnUInt32, uint32_t>(rv, t, nullCol);
+    case TC::UInt64:
+      return rawToScalar<ColumnUInt64, uint64_t>(rv, t, nullCol);
+    case TC::Float32:
+      return rawToScalar<ColumnFloat32, float>(rv, t, nullCol);
+    case TC::Float64:
+      return rawToScalar<ColumnFloat64, double>(rv, t, nullCol);
+    case TC::DateTime:
+    case TC::DateTime64:
+      return rawToDateTime(rv, t, nullCol);
+    case TC::Date:
+      return rawToDate(rv, t, nullCol);
+    case TC::UUID:
+      return rawToStrings<ColumnUUID, UInt128>(rv, t, nullCol, ToUUID());
+    case TC::String:
+      return rawToStrings<ColumnString, std::string>(rv, t, nullCol, ToString());
+    case TC::Enum8:
+      return rawToEnum<ColumnEnum8, int8_t>(rv, t, nullCol);
+    case TC::Enum16:
+      return rawToEnum<ColumnEnum16, int16_t>(rv, t, nullCol);
+    case TC::LowCardinality:
+      return rawToColumn(std::static_pointer_cast<LowCardinalityType>(t)->GetNestedType(),
+          rv, nullCol);
+    case TC::Nullable: {
+      auto nullCtlCol = std::make_shared<ColumnUInt8>();
+      auto valCol = rawToColumn(std::static_pointer_cast<NullableType>(t)->GetNestedType(),
+          rv, nullCtlCol);
+      return std::make_shared<ColumnNullable>(valCol, nullCtlCol);
+    }
+    default:
+      throw std::runtime_error("cannot write unsupported type: "+t->GetName());
+  }
+}
 
-  conn->Insert(tableName, block);
+// whether rawToColumn converts v like vecToColumn does; the other vectors
+// (e.g. integers written to String columns) are left to vecToColumn
+bool rawConvertible(TypeRef t, SEXP v) {
+  using TC = Type::Code;
+  switch(t->GetCode()) {
+    case TC::Int8: case TC::Int16: case TC::Int32: case TC::Int64:
+    case TC::UInt8: case TC::UInt16: case TC::UInt32: case TC::UInt64:
+    case TC::Float32: case TC::Float64: case TC::DateTime: case TC::DateTime64:
+      return TYPEOF(v) == INTSXP || TYPEOF(v) == REALSXP || TYPEOF(v) == LGLSXP;
+    case TC::Date:
+      // integer Dates (but not factors) are accepted as well
+      return TYPEOF(v) == REALSXP ||
+          (TYPEOF(v) == INTSXP && Rf_inherits(v, "Date"));
+    case TC::UUID:
+    case TC::String:
+      return TYPEOF(v) == STRSXP;
+    case TC::Enum8:
+    case TC::Enum16:
+      return TYPEOF(v) == INTSXP && TYPEOF(Rf_getAttrib(v, R_LevelsSymbol)) == STRSXP;
+    case TC::LowCardinality:
+      return rawConvertible(std::static_pointer_cast<LowCardinalityType>(t)->GetNestedType(), v);
+    case TC::Nullable:
+      return rawConvertible(std::static_pointer_cast<NullableType>(t)->GetNestedType(), v);
+    default:
+      return false;
+  }
+}
+
+// gathers rows [start, start+len) of a vector accepted by rawConvertible
+void gatherVector(SEXP v, R_xlen_t start, R_xlen_t len, RawView &rv) {
+  rv.sexpType = TYPEOF(v);
+  rv.posixct = Rf_inherits(v, "POSIXct");
+  rv.n = len;
+  rv.data = nullptr;
+  switch(TYPEOF(v)) {
+    case LGLSXP:
+      rv.kind = RawView::Integer;
+      rv.data = LOGICAL(v)+start;
+      break;
+    case INTSXP: {
+      rv.kind = RawView::Integer;
+      rv.data = INTEGER(v)+start;
+      SEXP levels = Rf_getAttrib(v, R_LevelsSymbol);
+      if(TYPEOF(levels) == STRSXP) {
+        for(R_xlen_t i = 0; i < Rf_xlength(levels); i++) {
+          rv.levels.push_back(CHAR(STRING_ELT(levels, i)));
+        }
+      }
+      break;
+    }
+    case REALSXP:
+      if(Rf_inherits(v, "integer64")) {
+        rv.kind = RawView::Integer64;
+        rv.data = rec(v)+start;
+      } else {
+        rv.kind = RawView::Real;
+        rv.data = REAL(v)+start;
+      }
+      break;
+    case STRSXP:
+      rv.kind = RawView::String;
+      rv.strings.resize(len);
+      for(R_xlen_t i = 0; i < len; i++) {
+        SEXP e = STRING_ELT(v, start+i);
+        rv.strings[i] = e == NA_STRING ? nullptr : CHAR(e);
+      }
+      break;
+  }
+}
+
+// Date, DateTime and DateTime64 columns are always built from a raw view, on
+// the R thread for vectors converted by vecToColumn
+ColumnRef vecToRaw(TypeRef t, SEXP v, std::shared_ptr<ColumnUInt8> nullCol) {
+  if(TYPEOF(v) == NILSXP) {
+    // treated as an empty column
+    RawView rv{RawView::Real, NILSXP, false, 0, nullptr, {}, {}};
+    return rawToColumn(t, rv, nullCol);
+  }
+  if(!rawConvertible(t, v)) {
+    stop("cannot write R type "+std::to_string(TYPEOF(v))+
+        " to column of type "+t->GetName());
+  }
+  RawView rv;
+  gatherVector(v, 0, Rf_xlength(v), rv);
+  return rawToColumn(t, rv, nullCol);
+}
+
+// converts rows [start, start+len) of df into a block of columns of the given
+// names and types; the columns with a raw view are built by up to `threads`
+// threads, once there are enough rows; character vectors written to String
+// columns are referred to instead of copied, unless the block is kept (by a
+// sender or a buffer) after df may have been released
+std::shared_ptr<Block> convertChunk(const std::vector<std::string> &names,
+    const std::vector<TypeRef> &types, int threads, bool kept, DataFrame &df, R_xlen_t start,
+    R_xlen_t len) {
+  // starting threads only pays off for enough entries per thread
+  const R_xlen_t minParallelRows = 10000;
+
+  const size_t ncols = types.size();
+  std::vector<ColumnRef> cols(ncols);
+  std::vector<RawView> raw(ncols);
+  std::vector<size_t> parallelCols;
+  for(size_t i = 0; i < ncols; i++) {
+    SEXP v = df[i];
+    if(!kept) {
+      cols[i] = stringRefsColumn(types[i], v, start, len);
+    }
+    if(!cols[i] && threads > 1 && len >= minParallelRows && rawConvertible(types[i], v)) {
+      gatherVector(v, start, len, raw[i]);
+      parallelCols.push_back(i);
+    }
+  }
+
+  if(!parallelCols.empty()) {
+    // built by up to threads tasks of the shared executor, like the columns
+    // of results are converted (see Result::convertParallel)
+    std::atomic<size_t> next(0);
+    TaskGroup group;
+    auto work = [&]() {
+      for(size_t k; !group.Canceled() && (k = next++) < parallelCols.size(); ) {
+        size_t i = parallelCols[k];
+        cols[i] = rawToColumn(types[i], raw[i]);
+      }
+    };
+    const size_t numTasks = std::min<size_t>(threads, parallelCols.size());
+    for(size_t t = 0; t < numTasks; t++) {
+      group.Run(work);
+    }
+    group.Wait();
+  }
+
+  auto block = std::make_shared<Block>();
+  for(size_t i = 0; i < ncols; i++) {
+    if(!cols[i]) {
+      RObject v = sliceVector(df[i], start, len);
+      cols[i] = vecToColumn(types[i], v);
+    }
+    block->AppendColumn(names[i], cols[i]);
+  }
+  return block;
+}
+
+std::shared_ptr<Block> convertChunk(PreparedInsert &ins, DataFrame &df, R_xlen_t start,
+    R_xlen_t len) {
+  return convertChunk(ins.names, ins.types, ins.threads, ins.sender != nullptr, df, start, len);
+}
+
+// a data frame sent as an external table of a query, whose columns have the
+// given ClickHouse types
+Block externalBlock(DataFrame df, std::vector<std::string> types) {
+  if(types.size() != static_cast<size_t>(df.size())) {
+    stop("the types of an external table must match its columns");
+  }
+  CharacterVector names = df.names();
+  Block block;
+  for(size_t i = 0; i < types.size(); i++) {
+    ColumnRef proto = CreateColumnByType(types[i]);
+    if(!proto) {
+      stop("unsupported column type "+types[i]+" of an external table");
+    }
+    block.AppendColumn(as<std::string>(names[i]), vecToColumn(proto->Type(), df[i]));
+  }
+  return block;
+}
+
+PreparedInsert::~PreparedInsert() {
+  stopSender();
+  Client *client = conn.get();
+  if(!closed && client && client->IsInserting()) {
+    try {
+      client->CancelInsert();
+    } catch(...) {
+      // a failed reconnect is reported by the next query instead
+    }
+  }
+}
+
+Client *PreparedInsert::client() {
+  Client *client = conn.get();
+  // the state of the client is not read while a sender may be using it
+  if(closed || !client || (!sender && !client->IsInserting())) {
+    stop("the insert has already been closed");
+  }
+  return client;
+}
+
+namespace {
+// the asynchronous inserts by the connection their sender is using
+std::map<const Client *, PreparedInsert *> insertSenders;
+
+// waits until pred holds, with the mutex of the sender locked by lock,
+// checking for interrupts meanwhile
+template<typename Pred>
+void waitForSender(PreparedInsert::Sender &s, std::unique_lock<std::mutex> &lock, Pred pred) {
+  while(!s.changed.wait_for(lock, std::chrono::milliseconds(100), pred)) {
+    lock.unlock();
+    bool interrupted = !R_ToplevelExec(checkInterruptFn, NULL);
+    lock.lock();
+    if(interrupted) {
+      stop("insert interrupted");
+    }
+  }
+}
+}
+
+PreparedInsert *PreparedInsert::sendingOn(const Client *client) {
+  auto it = insertSenders.find(client);
+  return it == insertSenders.end() ? nullptr : it->second;
+}
+
+void PreparedInsert::startSender(size_t capacity, bool failWhenFull) {
+  sender.reset(new Sender);
+  sender->capacity = capacity;
+  sender->failWhenFull = failWhenFull;
+  Client *c = conn.get();
+  Sender *s = sender.get();
+  sender->thread = std::thread([c, s] {
+    std::unique_lock<std::mutex> lock(s->mutex);
+    while(true) {
+      s->changed.wait(lock, [s] { return s->stop || !s->queue.empty(); });
+      if(s->stop) {
+        return;
+      }
+      std::shared_ptr<Block> block = s->queue.front();
+      s->queue.pop_front();
+      s->sending = true;
+      s->changed.notify_all();
+      lock.unlock();
+
+      std::exception_ptr error;
+      try {
+        c->SendInsertBlock(*block);
+      } catch(...) {
+        error = std::current_exception();
+      }
+      block.reset();
+
+      lock.lock();
+      s->sending = false;
+      if(error) {
+        s->error = error;
+        s->queue.clear();
+        s->stop = true;
+      }
+      s->changed.notify_all();
+    }
+  });
+  insertSenders[c] = this;
+}
+
+size_t PreparedInsert::queueRoom() {
+  std::lock_guard<std::mutex> lock(sender->mutex);
+  return sender->capacity - std::min(sender->capacity, sender->queue.size());
+}
+
+void PreparedInsert::enqueue(std::shared_ptr<Block> block) {
+  Sender &s = *sender;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  waitForSender(s, lock, [&s] { return s.stop || s.queue.size() < s.capacity; });
+  if(s.error) {
+    std::rethrow_exception(s.error);
+  }
+  s.queue.push_back(block);
+  s.changed.notify_all();
+}
+
+void PreparedInsert::flush() {
+  Sender &s = *sender;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  waitForSender(s, lock, [&s] { return s.stop || (s.queue.empty() && !s.sending); });
+  if(s.error) {
+    std::rethrow_exception(s.error);
+  }
+}
+
+void PreparedInsert::stopSender() {
+  if(!sender) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(sender->mutex);
+    sender->stop = true;
+    sender->queue.clear();
+    sender->changed.notify_all();
+  }
+  // waits for the block being sent, if any
+  sender->thread.join();
+  insertSenders.erase(conn.get());
+  sender.reset();
+}
+
+void beginInsert(PreparedInsert &ins, String tableName, const std::vector<std::string> &names,
+    const QuerySettings &settings = QuerySettings()) {
+  Block header;
+  ins.conn->BeginInsert(tableName, names, &header, settings);
+  ins.names = names;
+  ins.types.clear();
+  for(ch::Block::Iterator bi(header); bi.IsValid(); bi.Next()) {
+    ins.types.push_back(bi.Type());
+  }
+  if(ins.types.size() != names.size()) {
+    stop("the server expects "+std::to_string(ins.types.size())+
+        " columns for the insert into "+std::string(tableName)+", but got "+
+        std::to_string(names.size()));
+  }
+}
+
+// sends the rows of df in blocks of at most blockSize rows; while one block is
+// written to the socket by a worker thread, the next one is converted here
+// (the client is only touched by one thread at a time); the blocks of
+// asynchronous inserts are queued for their sender instead; on errors, the
+// insert is canceled
+void sendInsertBlocks(PreparedInsert &ins, DataFrame df, double blockSize) {
+  Client *client = ins.client();
+  if(ins.sender && ins.sender->failWhenFull && !ins.types.empty() && blockSize >= 1) {
+    // the data frame is rejected as a whole, so that the insert stays open
+    const double blocks = std::ceil(Rf_xlength(df[0])/std::floor(blockSize));
+    if(blocks > ins.queueRoom()) {
+      stop("the queue of the asynchronous insert is full: there is room for "+
+          std::to_string(ins.queueRoom())+" more blocks out of "+
+          std::to_string(ins.sender->capacity)+", but "+
+          std::to_string(static_cast<long long>(blocks))+" are appended");
+    }
+  }
+
+  std::future<void> pending;
+  try {
+    if(ins.types.size() != static_cast<size_t>(df.size())) {
+      stop("input has "+std::to_string(df.size())+" columns, but the insert has "+
+          std::to_string(ins.types.size()));
+    }
+    if(!(blockSize >= 1)) {
+      stop("the block size must be a positive number of rows");
+    }
+
+    const R_xlen_t nrows = ins.types.empty() ? 0 : Rf_xlength(df[0]);
+    const R_xlen_t chunk = blockSize < nrows ? static_cast<R_xlen_t>(blockSize) : nrows;
+
+    for(R_xlen_t start = 0; start < nrows; start += chunk) {
+      const R_xlen_t len = std::min(chunk, nrows - start);
+      auto block = convertChunk(ins, df, start, len);
+      if(ins.sender) {
+        ins.enqueue(block);
+        continue;
+      }
+      if(pending.valid()) {
+        pending.get();
+      }
+      if(!R_ToplevelExec(checkInterruptFn, NULL)) {
+        stop("insert interrupted");
+      }
+      pending = std::async(std::launch::async, [client, block] {
+        client->SendInsertBlock(*block);
+      });
+    }
+    if(pending.valid()) {
+      pending.get();
+    }
+  } catch(...) {
+    if(pending.valid()) {
+      pending.wait();
+    }
+    ins.stopSender();
+    ins.closed = true;
+    try {
+      client->CancelInsert();
+    } catch(...) {
+      // a failed reconnect is reported by the next query instead
+    }
+    throw;
+  }
+}
+
+// [[Rcpp::export]]
+void insert(XPtr<Client> conn, String tableName, DataFrame df, double blockSize, int threads) {
+  StringVector names(df.names());
+  idleClient(conn);
+  PreparedInsert ins(conn, threads);
+  beginInsert(ins, tableName, std::vector<std::string>(names.begin(), names.end()));
+  sendInsertBlocks(ins, df, blockSize);
+  conn->EndInsert();
+}
+
+namespace {
+// whether an insert which failed may succeed on a new connection: errors of
+// the connection, and those of the server which come and go (such as too
+// many parts, or a replica which has lost its ZooKeeper session)
+bool transientError(const std::exception &e) {
+  if(dynamic_cast<const Rcpp::exception *>(&e)) {
+    return false;
+  }
+  if(auto se = dynamic_cast<const ServerException *>(&e)) {
+    static const std::set<int> transient = {
+      209,  // SOCKET_TIMEOUT
+      210,  // NETWORK_ERROR
+      242,  // TABLE_IS_READ_ONLY
+      252,  // TOO_MANY_PARTS
+      319,  // UNKNOWN_STATUS_OF_INSERT
+      999,  // KEEPER_EXCEPTION
+    };
+    return transient.count(se->GetCode()) > 0;
+  }
+  return true;
+}
+
+// sleeps for the given seconds, checking for interrupts meanwhile
+void sleepInterruptibly(double seconds) {
+  const auto until = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(seconds));
+  while(std::chrono::steady_clock::now() < until) {
+    if(!R_ToplevelExec(checkInterruptFn, NULL)) {
+      stop("insert interrupted");
+    }
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+        until - std::chrono::steady_clock::now(), std::chrono::milliseconds(100)));
+  }
+}
+}
+
+// inserts the rows of df in chunks of at most chunkRows rows, each one an
+// INSERT of its own sent with the deduplication token "<token>-<i>" for the
+// i-th chunk, so that the server skips a chunk it has already written when it
+// is sent again; the first skip chunks, acknowledged by an earlier call with
+// the same token, are not sent at all. A chunk failing for a transient reason
+// is sent again over a new connection, up to retries times, after waiting
+// backoff seconds, doubled for each further retry. Without a token, one is
+// made up for this call. Returns the number of chunks acknowledged,
+// including those skipped
+// [[Rcpp::export]]
+double insertChunks(XPtr<Client> conn, String tableName, DataFrame df, double chunkRows,
+    int threads, std::string token, int retries, double backoff, double skip) {
+  Client *client = idleClient(conn);
+  if(!(chunkRows >= 1)) {
+    stop("the chunk size must be a positive number of rows");
+  }
+  if(retries < 0 || !(backoff >= 0)) {
+    stop("the number of retries and the backoff can't be negative");
+  }
+  if(token.empty()) {
+    token = newQueryId();
+  }
+  StringVector names(df.names());
+  PreparedInsert ins(conn, threads);
+  const std::vector<std::string> fields(names.begin(), names.end());
+  const R_xlen_t nrows = df.size() == 0 ? 0 : Rf_xlength(df[0]);
+  const R_xlen_t chunk = chunkRows < nrows ? static_cast<R_xlen_t>(chunkRows) : nrows;
+
+  double acknowledged = 0;
+  for(R_xlen_t start = 0; start < nrows; start += chunk) {
+    if(acknowledged < skip) {
+      acknowledged++;
+      continue;
+    }
+    const R_xlen_t len = std::min(chunk, nrows - start);
+    QuerySettings settings;
+    settings.SetString("insert_deduplication_token",
+        token+"-"+std::to_string(static_cast<long long>(acknowledged+1)));
+
+    // converted once, by the types of the first attempt
+    std::shared_ptr<Block> block;
+    for(int attempt = 0; ; attempt++) {
+      bool converting = false;
+      try {
+        beginInsert(ins, tableName, fields, settings);
+        if(!block) {
+          converting = true;
+          block = convertChunk(ins, df, start, len);
+          converting = false;
+        }
+        client->SendInsertBlock(*block);
+        client->EndInsert();
+        break;
+      } catch(const std::exception &e) {
+        try {
+          client->CancelInsert();
+        } catch(...) {
+          // a failed reconnect is reported by the next attempt instead
+        }
+        if(converting || attempt >= retries || !transientError(e)) {
+          if(converting || acknowledged == skip) {
+            throw;
+          }
+          stop("inserting chunk "+std::to_string(static_cast<long long>(acknowledged+1))+
+              " failed: "+e.what()+"; the "+std::to_string(static_cast<long long>(acknowledged))+
+              " chunks before have been inserted, and are skipped with the same token and skip = "+
+              std::to_string(static_cast<long long>(acknowledged)));
+        }
+      }
+      sleepInterruptibly(backoff * std::pow(2.0, attempt));
+      try {
+        client->ResetConnection();
+      } catch(const std::exception &) {
+        // the next attempt fails with the network error
+      }
+    }
+    acknowledged++;
+  }
+  return acknowledged;
+}
+
+// inserts the rows of a CSV or TSV file, parsed by the types of the columns
+// into blocks of at most blockSize rows, each sent while the next one is
+// parsed; the columns are those named in the header of the file unless names
+// are given; returns the number of rows inserted
+// [[Rcpp::export]]
+double insertFile(XPtr<Client> conn, String tableName, StringVector names, std::string path,
+    std::string format, std::string delimiter, bool header, double blockSize) {
+  idleClient(conn);
+  if(delimiter.size() != 1) {
+    stop("the delimiter must be a single character");
+  }
+  if(!(blockSize >= 1)) {
+    stop("the block size must be a positive number of rows");
+  }
+  TextFileReader reader(path, format == "tsv" ? TextFileReader::TSV : TextFileReader::CSV,
+      delimiter[0], header);
+  std::vector<std::string> fields(names.begin(), names.end());
+  if(fields.empty()) {
+    fields = reader.headerNames();
+    if(fields.empty()) {
+      stop("the columns must be given for files without a header");
+    }
+  }
+
+  PreparedInsert ins(conn);
+  beginInsert(ins, tableName, fields);
+  reader.setColumns(fields, ins.types);
+  Client *client = conn.get();
+  std::future<void> pending;
+  try {
+    while(auto block = reader.readBlock(static_cast<size_t>(blockSize))) {
+      if(pending.valid()) {
+        pending.get();
+      }
+      if(!R_ToplevelExec(checkInterruptFn, NULL)) {
+        stop("insert interrupted");
+      }
+      pending = std::async(std::launch::async, [client, block] {
+        client->SendInsertBlock(*block);
+      });
+    }
+    if(pending.valid()) {
+      pending.get();
+    }
+  } catch(...) {
+    if(pending.valid()) {
+      pending.wait();
+    }
+    try {
+      client->CancelInsert();
+    } catch(...) {
+      // a failed reconnect is reported by the next query instead
+    }
+    throw;
+  }
+  client->EndInsert();
+  return reader.numRows();
+}
+
+// [[Rcpp::export]]
+XPtr<PreparedInsert> prepareInsert(XPtr<Client> conn, String tableName, StringVector names,
+    int threads, double queueSize, bool failWhenFull) {
+  idleClient(conn);
+  if(queueSize < 0) {
+    stop("the queue size must be a non-negative number of blocks");
+  }
+  std::unique_ptr<PreparedInsert> ins(new PreparedInsert(conn, threads));
+  beginInsert(*ins, tableName, std::vector<std::string>(names.begin(), names.end()));
+  if(queueSize >= 1) {
+    ins->startSender(static_cast<size_t>(queueSize), failWhenFull);
+  }
+  return XPtr<PreparedInsert>(ins.release(), true);
+}
+
+// [[Rcpp::export]]
+void appendInsert(XPtr<PreparedInsert> ins, DataFrame df, double blockSize) {
+  sendInsertBlocks(*ins, df, blockSize);
+}
+
+// waits until the blocks queued by an asynchronous insert have been sent,
+// failing (and canceling the insert) if sending one of them has failed
+// [[Rcpp::export]]
+void flushInsert(XPtr<PreparedInsert> ins) {
+  Client *client = ins->client();
+  if(!ins->sender) {
+    return;
+  }
+  try {
+    ins->flush();
+  } catch(...) {
+    ins->stopSender();
+    ins->closed = true;
+    try {
+      client->CancelInsert();
+    } catch(...) {
+      // a failed reconnect is reported by the next query instead
+    }
+    throw;
+  }
+}
+
+// [[Rcpp::export]]
+void closeInsert(XPtr<PreparedInsert> ins) {
+  flushInsert(ins);
+  ins->stopSender();
+  Client *client = ins->client();
+  // the insert is over even if it fails
+  ins->closed = true;
+  client->EndInsert();
+}
+
+// [[Rcpp::export]]
+std::vector<std::string> insertTypes(XPtr<PreparedInsert> ins) {
+  std::vector<std::string> types;
+  for(auto &t : ins->types) {
+    types.push_back(t->GetName());
+  }
+  return types;
+}
+
+// cancels an open insert, discarding the blocks queued for its sender (those
+// sent before may already have been written)
+// [[Rcpp::export]]
+void cancelInsert(XPtr<PreparedInsert> ins) {
+  ins->stopSender();
+  if(ins->closed) {
+    return;
+  }
+  ins->closed = true;
+  Client *client = ins->conn.get();
+  if(client && client->IsInserting()) {
+    try {
+      client->CancelInsert();
+    } catch(...) {
+      // a failed reconnect is reported by the next query instead
+    }
+  }
+}
+
+namespace {
+// the open buffered inserts by their connection
+std::map<const Client *, BufferedInsert *> insertBuffers;
+
+size_t columnBytes(const std::vector<ColumnRef> &cols) {
+  size_t bytes = 0;
+  for(auto &col : cols) {
+    bytes += col->MemoryUsage();
+  }
+  return bytes;
+}
+}
+
+BufferedInsert::BufferedInsert(XPtr<Client> conn, const std::string &table,
+    const std::vector<std::string> &names, const std::vector<TypeRef> &types,
+    int threads, size_t maxRows, size_t maxBytes, double maxAge)
+    : conn(conn), client(conn.get()), table(table), names(names), types(types),
+      threads(threads), maxRows(maxRows), maxBytes(maxBytes),
+      maxAge(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(maxAge))) {
+  thread = std::thread([this] { run(); });
+  insertBuffers[client] = this;
+}
+
+BufferedInsert::~BufferedInsert() {
+  abandon();
+}
+
+void BufferedInsert::abandon() {
+  if(closed()) {
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    error = nullptr;
+    flushing = true;
+    changed.notify_all();
+    // a failed insert leaves its rows behind, which are given up
+    changed.wait(lock, [this] { return error || (rows == 0 && !sending); });
+  }
+  finish();
+}
+
+BufferedInsert *BufferedInsert::on(const Client *client) {
+  auto it = insertBuffers.find(client);
+  return it == insertBuffers.end() ? nullptr : it->second;
+}
+
+bool BufferedInsert::due() const {
+  return rows > 0 && !error &&
+      (flushing || rows >= maxRows || bytes >= maxBytes || Clock::now() >= oldest + maxAge);
+}
+
+void BufferedInsert::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    auto ready = [this] { return stopping || due(); };
+    if(rows > 0 && !error) {
+      changed.wait_until(lock, oldest + maxAge, ready);
+    } else {
+      changed.wait(lock, ready);
+    }
+    if(stopping) {
+      return;
+    }
+    if(!due()) {
+      continue;
+    }
+
+    std::vector<ColumnRef> cols;
+    cols.swap(columns);
+    const size_t n = rows;
+    const Clock::time_point since = oldest;
+    rows = bytes = 0;
+    sending = true;
+    lock.unlock();
+
+    std::exception_ptr failed;
+    try {
+      Block block;
+      for(size_t i = 0; i < cols.size(); i++) {
+        block.AppendColumn(names[i], cols[i]);
+      }
+      client->BeginInsert(table, names);
+      client->SendInsertBlock(block);
+      client->EndInsert();
+    } catch(...) {
+      failed = std::current_exception();
+      if(client->IsInserting()) {
+        try {
+          client->CancelInsert();
+        } catch(...) {
+          // a failed reconnect is reported by the next insert instead
+        }
+      }
+    }
+
+    lock.lock();
+    sending = false;
+    if(failed) {
+      error = failed;
+      restore(std::move(cols), n, since);
+    } else {
+      sentRows += n;
+      inserts++;
+    }
+    changed.notify_all();
+  }
+}
+
+void BufferedInsert::restore(std::vector<ColumnRef> cols, size_t n, Clock::time_point since) {
+  if(!columns.empty()) {
+    for(size_t i = 0; i < cols.size(); i++) {
+      cols[i]->Append(columns[i]);
+    }
+  }
+  columns.swap(cols);
+  rows += n;
+  bytes = columnBytes(columns);
+  oldest = since;
+}
+
+void BufferedInsert::rethrowError() {
+  if(!error) {
+    return;
+  }
+  std::exception_ptr e = error;
+  error = nullptr;
+  // the thread waits for the next append or flush before trying again
+  changed.notify_all();
+  try {
+    std::rethrow_exception(e);
+  } catch(const std::exception &ex) {
+    stop("inserting the buffered rows failed: "+std::string(ex.what())+"; the "+
+        std::to_string(rows)+" rows buffered are sent with the next insert");
+  }
+}
+
+void BufferedInsert::append(std::shared_ptr<Block> block) {
+  if(closed()) {
+    stop("the buffered insert has already been closed");
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if(block->GetRowCount() > 0) {
+    if(columns.empty()) {
+      for(size_t i = 0; i < block->GetColumnCount(); i++) {
+        columns.push_back((*block)[i]);
+      }
+      oldest = Clock::now();
+    } else {
+      for(size_t i = 0; i < columns.size(); i++) {
+        columns[i]->Append((*block)[i]);
+      }
+    }
+    rows += block->GetRowCount();
+    bytes = columnBytes(columns);
+    changed.notify_all();
+  }
+  // the rows of block are buffered even if the last insert has failed
+  rethrowError();
+}
+
+void BufferedInsert::flush() {
+  if(closed()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  rethrowError();
+  flushing = true;
+  changed.notify_all();
+  while(!changed.wait_for(lock, std::chrono::milliseconds(100),
+      [this] { return error || (rows == 0 && !sending); })) {
+    lock.unlock();
+    bool interrupted = !R_ToplevelExec(checkInterruptFn, NULL);
+    lock.lock();
+    if(interrupted) {
+      flushing = false;
+      stop("flush interrupted");
+    }
+  }
+  flushing = false;
+  rethrowError();
+}
+
+void BufferedInsert::close() {
+  flush();
+  finish();
+}
+
+void BufferedInsert::finish() {
+  if(closed()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    changed.notify_all();
+  }
+  thread.join();
+  insertBuffers.erase(client);
+}
+
+BufferedInsert::Stats BufferedInsert::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats st;
+  st.bufferedRows = rows;
+  st.bufferedBytes = bytes;
+  st.sentRows = sentRows;
+  st.inserts = inserts;
+  return st;
+}
+
+// a buffer for the rows of the given columns of a table (see BufferedInsert),
+// whose types are learned by an empty insert
+// [[Rcpp::export]]
+XPtr<BufferedInsert> bufferInsert(XPtr<Client> conn, String tableName, StringVector names,
+    int threads, double maxRows, double maxBytes, double maxAge) {
+  idleClient(conn);
+  if(!(maxRows >= 1) || !(maxBytes >= 1) || !(maxAge > 0)) {
+    stop("the maximum rows, bytes and age of the buffer must be positive");
+  }
+  // limits beyond these (such as Inf) are as good as none; the age is
+  // converted to clock ticks, which would overflow otherwise
+  PreparedInsert ins(conn, threads);
+  beginInsert(ins, tableName, std::vector<std::string>(names.begin(), names.end()));
+  conn->EndInsert();
+  return XPtr<BufferedInsert>(new BufferedInsert(conn, tableName, ins.names, ins.types, threads,
+      static_cast<size_t>(std::min(maxRows, 1e15)), static_cast<size_t>(std::min(maxBytes, 1e15)),
+      std::min(maxAge, 1e9)), true);
+}
+
+// [[Rcpp::export]]
+void appendBuffer(XPtr<BufferedInsert> buf, DataFrame df) {
+  if(buf->columnTypes().size() != static_cast<size_t>(df.size())) {
+    stop("input has "+std::to_string(df.size())+" columns, but the buffer has "+
+        std::to_string(buf->columnTypes().size()));
+  }
+  const R_xlen_t nrows = Rf_xlength(df[0]);
+  buf->append(convertChunk(buf->columnNames(), buf->columnTypes(), buf->conversionThreads(),
+      true, df, 0, nrows));
+}
+
+// [[Rcpp::export]]
+void flushBuffer(XPtr<BufferedInsert> buf) {
+  buf->flush();
+}
+
+// closes the buffer, sending its rows; buffers which have been freed are
+// taken as closed already
+// [[Rcpp::export]]
+void closeBuffer(SEXP ptr) {
+  if(BufferedInsert *buf = static_cast<BufferedInsert *>(R_ExternalPtrAddr(ptr))) {
+    buf->close();
+  }
+}
+
+// [[Rcpp::export]]
+List bufferStats(XPtr<BufferedInsert> buf) {
+  BufferedInsert::Stats st = buf->stats();
+  return List::create(_["rows.buffered"] = static_cast<double>(st.bufferedRows),
+                      _["bytes.buffered"] = static_cast<double>(st.bufferedBytes),
+                      _["rows.sent"] = st.sentRows,
+                      _["inserts"] = st.inserts,
+                      _["closed"] = buf->closed());
+}
+
+// the shard (1-based) each value of key goes to, once converted to the type
+// of the sharding key column, for shards of the given weights (see
+// sharding.h)
+// [[Rcpp::export]]
+IntegerVector shardOf(SEXP key, std::string type, std::vector<double> weights,
+    std::string method) {
+  ColumnRef proto = CreateColumnByType(type);
+  if(!proto) {
+    stop("unsupported type "+type+" of the sharding key");
+  }
+  ShardingFunction f;
+  if(method == "cityHash64") {
+    f = ShardingFunction::CityHash64;
+  } else if(method == "identity") {
+    f = ShardingFunction::Identity;
+  } else {
+    stop("unknown sharding function '"+method+"'");
+  }
+  std::vector<uint64_t> w;
+  for(double weight : weights) {
+    if(!(weight >= 0) || weight != std::floor(weight)) {
+      stop("the weights of the shards must be non-negative integers");
+    }
+    w.push_back(static_cast<uint64_t>(weight));
+  }
+  std::vector<int> shards;
+  try {
+    shards = shardRows(vecToColumn(proto->Type(), key), f, w);
+  } catch(const std::invalid_argument &e) {
+    stop(e.what());
+  }
+  IntegerVector res(shards.size());
+  for(size_t i = 0; i < shards.size(); i++) {
+    res[i] = shards[i]+1;
+  }
+  return res;
 }
 
 // [[Rcpp::export]]
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Rcpp.h>
+#include <clickhouse/client.h>
+
+namespace ch = clickhouse;
+
+// an INSERT query which is kept open while data frames are appended to it;
+// the column types are those of the header block the server answers with
+class PreparedInsert {
+  public:
+  Rcpp::XPtr<ch::Client> conn;
+  std::vector<std::string> names;
+  std::vector<ch::TypeRef> types;
+  // number of threads building the columns of each block
+  int threads;
+  // the insert has been closed or canceled; the connection may be running
+  // another query by now, which this one must not touch
+  bool closed = false;
+
+  // the background sender of an asynchronous insert: the blocks converted on
+  // the R thread are queued, and written to the server by a thread of its own
+  struct Sender {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::shared_ptr<ch::Block>> queue;
+    size_t capacity;
+    // fail appends which don't fit into the queue, instead of waiting
+    bool failWhenFull;
+    // a block has been taken off the queue, but not sent yet
+    bool sending = false;
+    bool stop = false;
+    // the error sending a block failed with; later blocks are discarded
+    std::exception_ptr error;
+    std::thread thread;
+  };
+  std::unique_ptr<Sender> sender;
+
+  PreparedInsert(Rcpp::XPtr<ch::Client> conn, int threads = 1) : conn(conn), threads(threads) {}
+  // cancels the insert if it has not been closed
+  ~PreparedInsert();
+
+  // the connection of the insert, failing if the insert has been closed
+  ch::Client *client();
+
+  // send the blocks from a background thread, queueing at most capacity
+  void startSender(size_t capacity, bool failWhenFull);
+  // the number of blocks which can be queued without waiting
+  size_t queueRoom();
+  // queue a block for the sender, waiting for room in the queue
+  void enqueue(std::shared_ptr<ch::Block> block);
+  // wait until all queued blocks have been sent, rethrowing the sender's error
+  void flush();
+  // stop the sender, discarding the blocks it has not sent yet
+  void stopSender();
+  // the asynchronous insert whose sender is using the connection, if any
+  static PreparedInsert *sendingOn(const ch::Client *client);
+};
+
+// rows appended for a table which are buffered and sent as one INSERT by a
+// thread of its own once they are maxRows rows or take maxBytes bytes, or
+// the oldest of them have been buffered for maxAge seconds, so that many
+// small appends make few large parts on the server; the buffer has its
+// connection to itself until it is closed
+class BufferedInsert {
+  public:
+  struct Stats {
+    size_t bufferedRows = 0, bufferedBytes = 0;
+    double sentRows = 0, inserts = 0;
+  };
+
+  BufferedInsert(Rcpp::XPtr<ch::Client> conn, const std::string &table,
+      const std::vector<std::string> &names, const std::vector<ch::TypeRef> &types,
+      int threads, size_t maxRows, size_t maxBytes, double maxAge);
+  // abandons the buffer if it has not been closed
+  ~BufferedInsert();
+
+  const std::vector<std::string> &columnNames() const { return names; }
+  const std::vector<ch::TypeRef> &columnTypes() const { return types; }
+  int conversionThreads() const { return threads; }
+
+  // adds the rows of block; fails with the error of the last insert, if it
+  // has failed since (its rows are kept for the next one, like those of
+  // block)
+  void append(std::shared_ptr<ch::Block> block);
+  // sends the buffered rows and waits until they have been inserted,
+  // checking for interrupts meanwhile
+  void flush();
+  // flushes and stops the thread, releasing the connection
+  void close();
+  // like close, but gives up the rows which fail to be inserted
+  void abandon();
+  bool closed() const { return !thread.joinable(); }
+  Stats stats();
+
+  // the open buffer using the connection, if any
+  static BufferedInsert *on(const ch::Client *client);
+
+  private:
+  using Clock = std::chrono::steady_clock;
+
+  Rcpp::XPtr<ch::Client> conn;
+  ch::Client *client;
+  std::string table;
+  std::vector<std::string> names;
+  std::vector<ch::TypeRef> types;
+  int threads;
+  size_t maxRows, maxBytes;
+  Clock::duration maxAge;
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  // the buffered rows, as one column per name (none while it is empty)
+  std::vector<ch::ColumnRef> columns;
+  size_t rows = 0, bytes = 0;
+  Clock::time_point oldest;
+  bool flushing = false;      // flush() is waiting for the buffer to be sent
+  bool sending = false;       // the thread is inserting rows taken off the buffer
+  bool stopping = false;
+  std::exception_ptr error;   // of the last insert, not reported yet
+  double sentRows = 0, inserts = 0;
+  std::thread thread;
+
+  void run();
+  // whether the buffered rows are to be sent now
+  bool due() const;
+  // reports the error of the last insert, if any, on the R thread
+  void rethrowError();
+  // prepends cols (of n rows, buffered since since) to the buffer
+  void restore(std::vector<ch::ColumnRef> cols, size_t n, Clock::time_point since);
+  void finish();
+};
+
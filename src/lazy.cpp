@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "result.h"
+#include <Rversion.h>
+#include <R_ext/Rdynload.h>
+
+// Lazy columns: ALTREP vectors which keep the blocks of a column and convert
+// them with the usual converter only when R needs the data. Single elements
+// and regions are converted on their own, as long as few are accessed, so
+// that printing or summarizing the first rows of a wide result does not
+// convert all of its columns; the whole column is converted when R asks for
+// a pointer to its data, or once more elements have been accessed one by one.
+
+// ALTREP has been part of the API since R 3.6
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 6, 0)
+#define LAZY_COLUMNS 1
+#include <R_ext/Altrep.h>
+#endif
+
+#ifdef LAZY_COLUMNS
+
+namespace {
+
+// single-element accesses served without converting the whole column
+const size_t maxEltConversions = 64;
+
+struct LazyColumn {
+  // holds just the blocks of the column (as its only column), with the rows
+  // numbered as in the result they have been fetched from; released once the
+  // column has been converted
+  std::unique_ptr<Result> blocks;
+  std::unique_ptr<Converter> converter;
+  size_t start, len;
+  size_t eltConversions = 0;
+
+  // convert entries [start+from, start+from+n) into a new vector
+  Rcpp::RObject convert(size_t from, size_t n) {
+    Rcpp::List out;
+    converter->alloc(n);
+    converter->convert(*blocks, 0, start+from, n);
+    converter->finish(out);
+    SEXP v = out[0];
+    return Rcpp::RObject(v);
+  }
+};
+
+R_altrep_class_t lazyLogical, lazyInteger, lazyReal, lazyString;
+
+LazyColumn &lazyColumn(SEXP x) {
+  auto *col = static_cast<LazyColumn *>(R_ExternalPtrAddr(R_altrep_data1(x)));
+  if(!col) {
+    Rcpp::stop("invalid lazily converted column");
+  }
+  return *col;
+}
+
+// the converted column, or R_NilValue if it has not been converted yet
+SEXP materialized(SEXP x) {
+  return R_altrep_data2(x);
+}
+
+SEXP materialize(SEXP x) {
+  SEXP m = materialized(x);
+  if(m == R_NilValue) {
+    LazyColumn &col = lazyColumn(x);
+    Rcpp::RObject v = col.convert(0, col.len);
+    R_set_altrep_data2(x, v);
+    m = v;
+    col.blocks.reset();
+    // the elements of a string column converted one by one are dropped
+    R_SetExternalPtrProtected(R_altrep_data1(x), R_NilValue);
+  }
+  return m;
+}
+
+const void *dataptr(SEXP m) {
+  switch(TYPEOF(m)) {
+    case LGLSXP:  return LOGICAL(m);
+    case INTSXP:  return INTEGER(m);
+    case REALSXP: return REAL(m);
+    default:      return STRING_PTR_RO(m);
+  }
+}
+
+R_xlen_t lazyLength(SEXP x) {
+  R_xlen_t len = 0;
+  BEGIN_RCPP
+  len = lazyColumn(x).len;
+  VOID_END_RCPP
+  return len;
+}
+
+Rboolean lazyInspect(SEXP x, int, int, int, void (*)(SEXP, int, int, int)) {
+  Rprintf("lazily converted ClickHouse column (%s)\n",
+      materialized(x) == R_NilValue ? "not converted yet" : "converted");
+  return TRUE;
+}
+
+void *lazyDataptr(SEXP x, Rboolean) {
+  const void *p = nullptr;
+  BEGIN_RCPP
+  p = dataptr(materialize(x));
+  VOID_END_RCPP
+  return const_cast<void *>(p);
+}
+
+const void *lazyDataptrOrNull(SEXP x) {
+  SEXP m = materialized(x);
+  return m == R_NilValue ? nullptr : dataptr(m);
+}
+
+// the element i, converted on its own unless too many have been
+template<typename T>
+T lazyElt(SEXP x, R_xlen_t i) {
+  T value = T();
+  BEGIN_RCPP
+  SEXP m = materialized(x);
+  LazyColumn &col = lazyColumn(x);
+  if(m == R_NilValue && ++col.eltConversions > maxEltConversions) {
+    m = materialize(x);
+  }
+  if(m != R_NilValue) {
+    value = static_cast<const T *>(dataptr(m))[i];
+  } else {
+    Rcpp::RObject v = col.convert(i, 1);
+    value = static_cast<const T *>(dataptr(v))[0];
+  }
+  VOID_END_RCPP
+  return value;
+}
+
+template<typename T>
+R_xlen_t lazyGetRegion(SEXP x, R_xlen_t i, R_xlen_t n, T *buf) {
+  R_xlen_t k = 0;
+  BEGIN_RCPP
+  LazyColumn &col = lazyColumn(x);
+  k = std::min<R_xlen_t>(n, col.len-i);
+  SEXP m = materialized(x);
+  if(m != R_NilValue) {
+    std::copy_n(static_cast<const T *>(dataptr(m))+i, k, buf);
+  } else {
+    Rcpp::RObject v = col.convert(i, k);
+    std::copy_n(static_cast<const T *>(dataptr(v)), k, buf);
+  }
+  VOID_END_RCPP
+  return k;
+}
+
+SEXP lazyStringElt(SEXP x, R_xlen_t i) {
+  SEXP value = NA_STRING;
+  BEGIN_RCPP
+  SEXP m = materialized(x);
+  LazyColumn &col = lazyColumn(x);
+  if(m == R_NilValue && ++col.eltConversions > maxEltConversions) {
+    m = materialize(x);
+  }
+  if(m != R_NilValue) {
+    value = STRING_ELT(m, i);
+  } else {
+    // R expects the elements of a string vector to live as long as the
+    // vector: those converted one by one are kept in a vector reachable from
+    // the column, through its external pointer, until it is converted
+    SEXP ptr = R_altrep_data1(x);
+    SEXP kept = R_ExternalPtrProtected(ptr);
+    if(kept == R_NilValue) {
+      kept = Rf_allocVector(STRSXP, maxEltConversions);
+      R_SetExternalPtrProtected(ptr, kept);
+    }
+    Rcpp::RObject v = col.convert(i, 1);
+    value = STRING_ELT(v, 0);
+    SET_STRING_ELT(kept, col.eltConversions-1, value);
+  }
+  VOID_END_RCPP
+  return value;
+}
+
+void lazyStringSetElt(SEXP x, R_xlen_t i, SEXP v) {
+  BEGIN_RCPP
+  SET_STRING_ELT(materialize(x), i, v);
+  VOID_END_RCPP
+}
+
+void setCommonMethods(R_altrep_class_t cls) {
+  R_set_altrep_Length_method(cls, lazyLength);
+  R_set_altrep_Inspect_method(cls, lazyInspect);
+  R_set_altvec_Dataptr_method(cls, lazyDataptr);
+  R_set_altvec_Dataptr_or_null_method(cls, lazyDataptrOrNull);
+}
+
+}
+
+// register the ALTREP classes of lazy columns, called when the package is
+// loaded
+extern "C" void initLazyColumns(DllInfo *dll) {
+  lazyLogical = R_make_altlogical_class("clickhouse_lazy_logical", "RClickhouse", dll);
+  setCommonMethods(lazyLogical);
+  R_set_altlogical_Elt_method(lazyLogical, lazyElt<int>);
+  R_set_altlogical_Get_region_method(lazyLogical, lazyGetRegion<int>);
+
+  lazyInteger = R_make_altinteger_class("clickhouse_lazy_integer", "RClickhouse", dll);
+  setCommonMethods(lazyInteger);
+  R_set_altinteger_Elt_method(lazyInteger, lazyElt<int>);
+  R_set_altinteger_Get_region_method(lazyInteger, lazyGetRegion<int>);
+
+  lazyReal = R_make_altreal_class("clickhouse_lazy_real", "RClickhouse", dll);
+  setCommonMethods(lazyReal);
+  R_set_altreal_Elt_method(lazyReal, lazyElt<double>);
+  R_set_altreal_Get_region_method(lazyReal, lazyGetRegion<double>);
+
+  lazyString = R_make_altstring_class("clickhouse_lazy_string", "RClickhouse", dll);
+  setCommonMethods(lazyString);
+  R_set_altstring_Elt_method(lazyString, lazyStringElt);
+  R_set_altstring_Set_elt_method(lazyString, lazyStringSetElt);
+}
+
+SEXP Result::lazyColumn(size_t i, size_t nRows) const {
+  // arrays, maps and tuples become lists or data frames, and the levels of
+  // LowCardinality factors depend on the rows converted together
+  ch::TypeRef type = colTypes[i];
+  if(type->GetCode() == ch::Type::Nullable) {
+    type = std::static_pointer_cast<ch::NullableType>(type)->GetNestedType();
+  }
+  if(type->GetCode() == ch::Type::Array || type->GetCode() == ch::Type::Tuple ||
+      type->GetCode() == ch::Type::Map || type->GetCode() == ch::Type::LowCardinality) {
+    return R_NilValue;
+  }
+
+  std::unique_ptr<LazyColumn> col(new LazyColumn);
+  col->blocks.reset(new Result(""));
+  col->converter = buildConverter(std::string(colNames[i]), colTypes[i]);
+  col->start = fetchedRows;
+  col->len = nRows;
+
+  // the class and other attributes of the column are those of an empty one;
+  // matrices (like raw UUIDs) are converted right away
+  Rcpp::RObject proto = col->convert(0, 0);
+  R_altrep_class_t cls;
+  switch(TYPEOF(proto)) {
+    case LGLSXP:  cls = lazyLogical; break;
+    case INTSXP:  cls = lazyInteger; break;
+    case REALSXP: cls = lazyReal; break;
+    case STRSXP:  cls = lazyString; break;
+    default:      return R_NilValue;
+  }
+  if(Rf_getAttrib(proto, R_DimSymbol) != R_NilValue) {
+    return R_NilValue;
+  }
+
+  col->blocks->firstBlockRow = firstBlockRow;
+  size_t row = firstBlockRow;
+  for(const ColBlock &cb : columnBlocks) {
+    if(row >= fetchedRows+nRows) {
+      break;
+    }
+    ColBlock lcb = ColBlock();
+    lcb.columns = {cb.columns[i]};
+    lcb.rows = cb.rows;
+    lcb.bytes = cb.bytes;
+    col->blocks->columnBlocks.push_back(lcb);
+    row += cb.rows;
+  }
+
+  Rcpp::XPtr<LazyColumn> ptr(col.release(), true);
+  Rcpp::RObject x = R_new_altrep(cls, ptr, R_NilValue);
+  DUPLICATE_ATTRIB(x, proto);
+  return x;
+}
+
+#else
+
+extern "C" void initLazyColumns(DllInfo *) {}
+
+// without ALTREP, all columns are converted right away
+SEXP Result::lazyColumn(size_t, size_t) const {
+  return R_NilValue;
+}
+
+#endif
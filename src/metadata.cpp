@@ -0,0 +1,122 @@
+#include <cctype>
+#include <clickhouse/columns/factory.h>
+#include <clickhouse/columns/string.h>
+#include "metadata.h"
+
+MetadataCache &MetadataCache::instance() {
+  static MetadataCache cache;
+  return cache;
+}
+
+MetadataCache::Clock::time_point MetadataCache::expiry(double ttl) {
+  return Clock::now() + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(ttl));
+}
+
+std::vector<std::string> MetadataCache::tables(ch::Client &client, double ttl) {
+  Connection &c = connections[&client];
+  if(ttl > 0 && c.tablesExpire > Clock::now()) {
+    counters.hits++;
+    return c.tables;
+  }
+  counters.misses++;
+
+  std::vector<std::string> tables;
+  client.Select("SHOW TABLES", [&tables] (const ch::Block &block) {
+    if(block.GetColumnCount() < 1) {
+      return;
+    }
+    auto names = block[0]->As<ch::ColumnString>();
+    for(size_t i = 0; names && i < names->Size(); i++) {
+      tables.push_back(names->At(i).to_string());
+    }
+  });
+  if(ttl > 0) {
+    c.tables = tables;
+    c.tablesExpire = expiry(ttl);
+  }
+  return tables;
+}
+
+MetadataCache::Columns MetadataCache::columns(ch::Client &client, const std::string &table,
+    double ttl) {
+  auto &cached = connections[&client].columns;
+  auto it = cached.find(table);
+  if(it != cached.end() && ttl > 0 && it->second.second > Clock::now()) {
+    counters.hits++;
+    return it->second.first;
+  }
+  counters.misses++;
+
+  Columns cols;
+  client.Select("DESCRIBE TABLE "+table, [&cols] (const ch::Block &block) {
+    if(block.GetColumnCount() < 2) {
+      return;
+    }
+    auto names = block[0]->As<ch::ColumnString>();
+    auto types = block[1]->As<ch::ColumnString>();
+    for(size_t i = 0; names && types && i < names->Size(); i++) {
+      cols.names.push_back(names->At(i).to_string());
+      cols.typeNames.push_back(types->At(i).to_string());
+      ch::ColumnRef proto;
+      try {
+        proto = ch::CreateColumnByType(cols.typeNames.back());
+      } catch(const std::exception &) {
+        // kept as an unsupported type
+      }
+      cols.types.push_back(proto ? proto->Type() : nullptr);
+    }
+  });
+  if(ttl > 0) {
+    cached[table] = std::make_pair(cols, expiry(ttl));
+  }
+  return cols;
+}
+
+bool MetadataCache::changesSchema(const std::string &query) {
+  // skips whitespace and comments before the first keyword
+  size_t i = 0;
+  while(i < query.size()) {
+    if(std::isspace(static_cast<unsigned char>(query[i]))) {
+      i++;
+    } else if(query.compare(i, 2, "--") == 0) {
+      i = query.find('\n', i);
+    } else if(query.compare(i, 2, "/*") == 0) {
+      i = query.find("*/", i);
+      if(i != std::string::npos) {
+        i += 2;
+      }
+    } else {
+      break;
+    }
+  }
+  if(i >= query.size()) {
+    return false;
+  }
+  std::string keyword;
+  while(i < query.size() && std::isalpha(static_cast<unsigned char>(query[i]))) {
+    keyword += static_cast<char>(std::toupper(static_cast<unsigned char>(query[i++])));
+  }
+  static const char *const ddl[] = {
+    "CREATE", "DROP", "ALTER", "RENAME", "EXCHANGE", "ATTACH", "DETACH", "USE"
+  };
+  for(const char *k : ddl) {
+    if(keyword == k) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void MetadataCache::invalidate(const ch::Client *client) {
+  connections.erase(client);
+}
+
+size_t MetadataCache::entries(const ch::Client *client) const {
+  auto it = connections.find(client);
+  return it == connections.end() ? 0 : it->second.columns.size();
+}
+
+MetadataCache::Stats MetadataCache::stats() const {
+  return counters;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <clickhouse/client.h>
+
+namespace ch = clickhouse;
+
+// The tables of the database of each connection and the columns of the
+// tables described over it, which dbListTables, dbExistsTable and
+// dbListFields (and dbplyr, many times per pipeline) ask for. Only used by
+// the R thread. Entries are kept for the time to live they are looked up
+// with, and those of a connection are dropped as soon as a statement which
+// may change them (see changesSchema) is sent over it, or it is disconnected;
+// changes made over other connections are seen once the entries expire.
+class MetadataCache {
+  public:
+  struct Columns {
+    std::vector<std::string> names;
+    // as given by the server, and parsed (nullptr for those the client
+    // doesn't support)
+    std::vector<std::string> typeNames;
+    std::vector<ch::TypeRef> types;
+  };
+
+  struct Stats {
+    uint64_t hits = 0, misses = 0;
+  };
+
+  static MetadataCache &instance();
+
+  // the tables of the database of client (SHOW TABLES), queried unless cached
+  // less than ttl seconds ago
+  std::vector<std::string> tables(ch::Client &client, double ttl);
+
+  // the columns of table, given as in SQL (DESCRIBE TABLE), queried unless
+  // cached less than ttl seconds ago
+  Columns columns(ch::Client &client, const std::string &table, double ttl);
+
+  // whether query creates, alters, renames or drops tables or databases, or
+  // switches the database (judged by its first keyword)
+  static bool changesSchema(const std::string &query);
+
+  // drops the entries of client
+  void invalidate(const ch::Client *client);
+
+  // the number of tables described over client which are cached
+  size_t entries(const ch::Client *client) const;
+  Stats stats() const;
+
+  private:
+  MetadataCache() {}
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Connection {
+    std::vector<std::string> tables;
+    Clock::time_point tablesExpire;
+    std::map<std::string, std::pair<Columns, Clock::time_point>> columns;
+  };
+
+  std::map<const ch::Client *, Connection> connections;
+  Stats counters;
+
+  static Clock::time_point expiry(double ttl);
+};
@@ -0,0 +1,214 @@
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <clickhouse/base/input.h>
+#include <clickhouse/base/wire_format.h>
+#include <clickhouse/columns/factory.h>
+#include "native.h"
+#include "result.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Native files: query results written as received, in the format the server
+// reads and writes with "FORMAT Native" (blocks of named and typed columns,
+// without the block info of the protocol), so that extracts are saved without
+// converting them to R and read back without querying the cluster again.
+
+static std::runtime_error fileError(const std::string &what, const std::string &path) {
+  return std::runtime_error("can't " + what + " " + path + ": " + std::strerror(errno));
+}
+
+void FileOutput::DoWrite(const void *data, size_t len) {
+  if(std::fwrite(data, 1, len, file) != len) {
+    throw fileError("write to", path);
+  }
+}
+
+NativeFileWriter::NativeFileWriter(const std::string &path, bool compress) : path(path) {
+  file = std::fopen(path.c_str(), "wb");
+  if(!file) {
+    throw fileError("create", path);
+  }
+  fileOutput.reset(new FileOutput(file, path));
+  buffered.reset(new ch::BufferedOutput(fileOutput.get(), 1 << 20));
+  coded.reset(new ch::CodedOutputStream(buffered.get()));
+  out = coded.get();
+  if(compress) {
+    compressed.reset(new ch::CompressedOutput(coded.get(), ch::CompressionCodec::LZ4));
+    compressedCoded.reset(new ch::CodedOutputStream(compressed.get()));
+    out = compressedCoded.get();
+  }
+}
+
+NativeFileWriter::~NativeFileWriter() {
+  if(file) {
+    // the query has failed, the partial file is of no use
+    compressedCoded.reset();
+    compressed.reset();
+    coded.reset();
+    buffered.reset();
+    std::fclose(file);
+    std::remove(path.c_str());
+  }
+}
+
+void NativeFileWriter::write(const ch::Block &block) {
+  // the first block, which has no rows if it only gives the columns of the
+  // result, is written anyway so that a file of no rows has the columns
+  if(block.GetRowCount() == 0 && blocks > 0) {
+    return;
+  }
+  ch::WireFormat::WriteUInt64(out, block.GetColumnCount());
+  ch::WireFormat::WriteUInt64(out, block.GetRowCount());
+  for(ch::Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
+    ch::WireFormat::WriteString(out, bi.Name());
+    ch::WireFormat::WriteString(out, bi.Type()->GetName());
+    if(block.GetRowCount() > 0) {
+      bi.Column()->SavePrefix(out);
+      bi.Column()->Save(out);
+    }
+  }
+  blocks++;
+  rows += block.GetRowCount();
+}
+
+void NativeFileWriter::close() {
+  out->Flush();
+  buffered.reset();
+  FILE *f = file;
+  file = nullptr;
+  if(std::fclose(f) != 0) {
+    throw fileError("write to", path);
+  }
+}
+
+FileContents::FileContents(const std::string &path) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if(fd < 0 || fstat(fd, &st) != 0) {
+    int err = errno;
+    if(fd >= 0) {
+      ::close(fd);
+    }
+    errno = err;
+    throw fileError("open", path);
+  }
+  len = st.st_size;
+  if(len > 0) {
+    void *p = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED) {
+      int err = errno;
+      ::close(fd);
+      errno = err;
+      throw fileError("map", path);
+    }
+    // the file is read front to back, once
+    madvise(p, len, MADV_SEQUENTIAL);
+    mapped = p;
+  }
+  ::close(fd);
+#else
+  FILE *file = std::fopen(path.c_str(), "rb");
+  if(!file) {
+    throw fileError("open", path);
+  }
+  char chunk[1 << 16];
+  size_t n;
+  while((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    buffer.insert(buffer.end(), chunk, chunk+n);
+  }
+  bool failed = std::ferror(file);
+  std::fclose(file);
+  if(failed) {
+    throw fileError("read", path);
+  }
+  len = buffer.size();
+#endif
+}
+
+FileContents::~FileContents() {
+#ifndef _WIN32
+  if(mapped) {
+    munmap(mapped, len);
+  }
+#endif
+}
+
+const void *FileContents::data() const {
+#ifndef _WIN32
+  return mapped;
+#else
+  return buffer.data();
+#endif
+}
+
+void FileContents::release(size_t end) {
+#ifndef _WIN32
+  static const size_t pageSize = sysconf(_SC_PAGESIZE);
+  end -= end % pageSize;
+  if(mapped && end > released) {
+    madvise(static_cast<char *>(mapped)+released, end-released, MADV_DONTNEED);
+    released = end;
+  }
+#endif
+}
+
+namespace {
+
+// read a block, returning false at the end of the input
+bool readBlock(ch::CodedInputStream *in, ch::Block *block, const std::string &path) {
+  uint64_t nCols, nRows;
+  if(!ch::WireFormat::ReadUInt64(in, &nCols)) {
+    return false;
+  }
+  if(!ch::WireFormat::ReadUInt64(in, &nRows)) {
+    throw std::runtime_error(path + " is truncated");
+  }
+  for(uint64_t i = 0; i < nCols; i++) {
+    std::string name, type;
+    if(!ch::WireFormat::ReadString(in, &name) || !ch::WireFormat::ReadString(in, &type)) {
+      throw std::runtime_error(path + " is truncated");
+    }
+    ch::ColumnRef col = ch::CreateColumnByType(type);
+    if(!col) {
+      throw std::runtime_error("unsupported column type " + type + " in " + path);
+    }
+    if(nRows > 0 && (!col->LoadPrefix(in, nRows) || !col->Load(in, nRows))) {
+      throw std::runtime_error("can't read column " + name + " of " + path);
+    }
+    block->AppendColumn(name, col);
+  }
+  return true;
+}
+
+}
+
+void readNativeFile(const std::string &path, bool compressed, Result &r) {
+  FileContents contents(path);
+  ch::ArrayInput arrayInput(contents.data(), contents.size());
+  ch::CodedInputStream input(&arrayInput);
+  std::unique_ptr<ch::CompressedInput> decompressed;
+  std::unique_ptr<ch::CodedInputStream> coded;
+  ch::CodedInputStream *in = &input;
+  if(compressed) {
+    decompressed.reset(new ch::CompressedInput(&input));
+    coded.reset(new ch::CodedInputStream(decompressed.get()));
+    in = coded.get();
+  }
+  // the columns copy their data, so the file is unmapped once all blocks have
+  // been read
+  for(;;) {
+    ch::Block block;
+    if(!readBlock(in, &block, path)) {
+      break;
+    }
+    r.addBlock(block);
+  }
+  r.onDone();
+}
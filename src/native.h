@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <clickhouse/block.h>
+#include <clickhouse/base/buffer.h>
+#include <clickhouse/base/coded.h>
+#include <clickhouse/base/compressed.h>
+#include <clickhouse/base/output.h>
+
+namespace ch = clickhouse;
+
+class Result;
+
+// the contents of a file, mapped into memory where possible (and read into
+// memory otherwise)
+class FileContents {
+  public:
+  explicit FileContents(const std::string &path);
+  ~FileContents();
+
+  const void *data() const;
+  size_t size() const { return len; }
+  // drop the pages of the mapping before end, which won't be read again, so
+  // that files read front to back don't take memory beyond the page cache
+  void release(size_t end);
+
+  private:
+#ifndef _WIN32
+  void *mapped = nullptr;
+  size_t released = 0;
+#else
+  ch::Buffer buffer;
+#endif
+  size_t len = 0;
+};
+
+// the output to an open file
+class FileOutput : public ch::OutputStream {
+  public:
+  FileOutput(FILE *file, const std::string &path) : file(file), path(path) {}
+
+  protected:
+  void DoWrite(const void *data, size_t len) override;
+
+  private:
+  FILE *file;
+  std::string path;
+};
+
+// writes blocks to a file in ClickHouse's Native format, as written by
+// "FORMAT Native" and read by clickhouse-local, optionally compressed in LZ4
+// frames like the data sent to the server (and by clickhouse-compressor);
+// the file is removed unless it has been closed
+class NativeFileWriter {
+  public:
+  NativeFileWriter(const std::string &path, bool compress);
+  ~NativeFileWriter();
+
+  void write(const ch::Block &block);
+  // flush the data written and close the file
+  void close();
+
+  size_t numRows() const { return rows; }
+
+  private:
+  std::string path;
+  FILE *file;
+  std::unique_ptr<FileOutput> fileOutput;
+  std::unique_ptr<ch::BufferedOutput> buffered;
+  std::unique_ptr<ch::CodedOutputStream> coded;
+  std::unique_ptr<ch::CompressedOutput> compressed;
+  std::unique_ptr<ch::CodedOutputStream> compressedCoded;
+  ch::CodedOutputStream *out;
+  size_t blocks = 0;
+  size_t rows = 0;
+};
+
+// add the blocks of a Native file written by NativeFileWriter (or by the
+// server) to r
+void readNativeFile(const std::string &path, bool compressed, Result &r);
@@ -1,5 +1,20 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <map>
 #include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <cityhash/city.h>
+#include <clickhouse/base/allocator.h>
+#include <clickhouse/base/executor.h>
+#include <clickhouse/base/trace.h>
+#include <clickhouse/columns/factory.h>
+#include "cache.h"
 #include "result.h"
+#include "uuid.h"
 
 
 // helper function which emits an R warning without causing a longjmp
@@ -9,46 +24,600 @@ void warn(std::string text) {
       warning(text);
 }
 
-Result::Result(std::string stmt) {
+// R numbers the rows of data frames (and the entries of factors) with
+// integers, while their columns may be long vectors
+const size_t maxFrameRows = INT_MAX;
+
+// the row names of a data frame of nRows rows (at most maxFrameRows), which
+// are the rows first+1 to first+nRows of a result: R's compact form of
+// 1:nRows, which takes no memory per row, for the first rows, otherwise the
+// numbers themselves as long as they fit into integers, beyond which the rows
+// are numbered from 1 again
+static Rcpp::RObject rowNames(size_t first, size_t nRows) {
+  if(first == 0 || first+nRows > maxFrameRows) {
+    return Rcpp::IntegerVector::create(NA_INTEGER, -static_cast<int>(nRows));
+  }
+  return Rcpp::wrap(Rcpp::Range(first+1, first+nRows));
+}
+
+// refuse to fetch more rows into a data frame than it can hold, before
+// converting any of them
+static void checkFrameRows(size_t nRows) {
+  if(nRows > maxFrameRows) {
+    throw std::runtime_error("a data frame can't hold more than 2^31-1 rows, fetch them in chunks of "
+        "fewer rows or with dbFetchArrow");
+  }
+}
+
+Result::Result(std::string stmt, std::string queryId) {
   statement = stmt;
+  this->queryId = queryId;
 }
 
-template<typename CT, typename RT>
-void Result::convertTypedColumn(AccFunc colAcc, Rcpp::List &df,
-    size_t start, size_t len,
-    ConvertFunc<CT, RT> convFunc) const {
-  RT v(len);   // R vector for the column
+const std::string &Result::getQueryId() const {
+  return queryId;
+}
 
-  size_t i = 0, offset = 0;
-  for(const ColBlock &cb : columnBlocks) {
-    const ch::ColumnRef col = colAcc(cb);
-    if(i+col->Size() >= start) {  // only if this block was not fetched yet
-      auto ccol = col->As<CT>();
+// results whose blocks are still received by a background thread, by client;
+// only used from the R thread
+static std::unordered_map<const ch::Client *, Result *> asyncResults;
+
+Result *asyncResult(const ch::Client *client) {
+  auto it = asyncResults.find(client);
+  return it == asyncResults.end() ? nullptr : it->second;
+}
+
+Result::Result(Rcpp::XPtr<ch::Client> conn, const ch::Query &query, bool async)
+    : Result(query.GetText(), query.GetQueryId()) {
+  streamConn = conn;
+  if(!async) {
+    // the packets are received on the R thread as the result is fetched
+    startClientStats(*conn);
+    conn->BeginSelect(ch::Query(query)
+        .OnProgress([this] (const ch::Progress &p) { onProgress(p); })
+        .OnProfile([this] (const ch::Profile &p) { onProfile(p); }));
+    streaming = true;
+    receiveBlocks(0);   // wait for the header block carrying the column info
+    return;
+  }
+
+  startAsync({conn.get()}, {query}, false);
+}
+
+Result::Result(Rcpp::List conns, const std::vector<ch::Query> &queries, bool ordered)
+    : Result(queries.front().GetText(), queries.front().GetQueryId()) {
+  streamConn = conns;
+  std::vector<ch::Client *> clients;
+  for(R_xlen_t i = 0; i < conns.size(); i++) {
+    SEXP conn = conns[i];
+    clients.push_back(static_cast<ch::Client *>(R_ExternalPtrAddr(conn)));
+  }
+  startAsync(clients, queries, ordered);
+}
+
+void Result::startAsync(const std::vector<ch::Client *> &clients,
+    const std::vector<ch::Query> &queries, bool ordered) {
+  this->async.reset(new AsyncQuery);
+  AsyncQuery *state = this->async.get();
+  state->clients = clients;
+  state->queues.resize(ordered ? clients.size() : 1);
+  state->clientDone.resize(clients.size(), false);
+  state->running = clients.size();
+  std::vector<ch::Query> streams;
+  for(size_t i = 0; i < clients.size(); i++) {
+    ch::Client *client = clients[i];
+    const ch::Query &query = queries[queries.size() > 1 ? i : 0];
+    state->statsStart.push_back(client->GetStats());
+    if(i == 0) {
+      // the trace of the first client, those of the others are their own
+      startTrace(*client);
+    }
+    std::deque<ch::Block> *queue = &state->queues[ordered ? i : 0];
+    // the shards get ids of their own, in case some of them share a server
+    std::string id = clients.size() > 1 ?
+        query.GetQueryId() + "-" + std::to_string(i+1) : query.GetQueryId();
+    streams.push_back(ch::Query(query)
+        .SetQueryId(id)
+        .OnDataCancelable([state, queue] (const ch::Block &block) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          if(state->cancel) {
+            return false;
+          }
+          queue->push_back(block);
+          state->received.notify_one();
+          // the query is canceled as soon as the rows of the result have
+          // arrived, instead of running to the end
+          state->rows += block.GetRowCount();
+          return state->rows < state->rowLimit;
+        })
+        // notices the cancellation while waiting for the server as well
+        .OnCancelCheck([state] {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          return !state->cancel;
+        })
+        .OnProgress([state] (const ch::Progress &p) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->progress.add(p);
+        })
+        .OnProfile([state] (const ch::Profile &p) {
+          std::lock_guard<std::mutex> lock(state->mutex);
+          state->progress.add(p);
+        }));
+    asyncResults[client] = this;
+  }
+  state->threads.emplace_back([state, streams] { receiveAsync(state, streams); });
+}
+
+// how often the streams of an asynchronous query are checked for cancellation
+// and timeouts while they are waited on (the default cancel check interval of
+// the clients)
+static const std::chrono::milliseconds asyncCheckInterval(100);
+
+void Result::receiveAsync(AsyncQuery *state, const std::vector<ch::Query> &queries) {
+  const std::vector<ch::Client *> &clients = state->clients;
+  std::vector<bool> open(clients.size(), false);
+  size_t numOpen = 0;
+
+  auto finish = [state, &open, &numOpen] (size_t i, std::exception_ptr error) {
+    open[i] = false;
+    numOpen--;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if(error) {
+      if(!state->error) {
+        state->error = error;
+      }
+      // the rows of the other clients would be incomplete anyway
+      state->cancel = true;
+    }
+    state->clientDone[i] = true;
+    if(--state->running == 0) {
+      state->done = true;
+      state->progress.finish();
+    }
+    state->received.notify_one();
+  };
+
+  for(size_t i = 0; i < clients.size(); i++) {
+    open[i] = true;
+    numOpen++;
+    try {
+      clients[i]->BeginSelect(queries[i]);
+    } catch(...) {
+      finish(i, std::current_exception());
+    }
+  }
+
+  // receives the packet of whichever client has one, rather than waiting on a
+  // thread per client, so that fanning out over many shards costs no more
+  // threads than a single query
+  auto lastCheck = std::chrono::steady_clock::now();
+  while(numOpen > 0) {
+    std::vector<size_t> ready;
+    try {
+      ready = ch::Client::WaitStreams(clients, asyncCheckInterval.count());
+    } catch(...) {
+      std::exception_ptr error = std::current_exception();
+      for(size_t i = 0; i < clients.size(); i++) {
+        if(open[i]) {
+          try {
+            clients[i]->CancelSelect();
+          } catch(...) {
+            // the query has failed already
+          }
+          finish(i, error);
+        }
+      }
+      break;
+    }
+
+    for(size_t i : ready) {
+      if(!open[i]) {
+        continue;
+      }
+      try {
+        if(!clients[i]->ReceiveStreamPacket()) {
+          finish(i, nullptr);
+        }
+      } catch(...) {
+        finish(i, std::current_exception());
+      }
+    }
+
+    // the clients only check for cancellation and timeouts by themselves while
+    // they wait within a packet
+    const auto now = std::chrono::steady_clock::now();
+    if(now - lastCheck >= asyncCheckInterval) {
+      lastCheck = now;
+      for(size_t i = 0; i < clients.size(); i++) {
+        if(!open[i]) {
+          continue;
+        }
+        try {
+          clients[i]->CheckStream();
+        } catch(...) {
+          finish(i, std::current_exception());
+        }
+      }
+    }
+  }
+}
+
+// the memory a result must have held for its destruction to trim the heap
+static const size_t trimBytes = 64 << 20;
+
+Result::~Result() {
+  ch::Client *client = streamClient();
+  if(streaming && client) {
+    try {
+      client->CancelSelect();
+    } catch(...) {
+      // nothing sensible to do about network errors when discarding a result
+    }
+  }
+  if(async || flight) {
+    stopAsync();
+  }
+  releaseBytes(bufferedBytes);
+  // the large buffers of the columns are unmapped as they are dropped; after
+  // large results, malloc returns what it keeps of the rest to the system too
+  if(peakBytes >= trimBytes) {
+    ch::ReleaseFreeMemory();
+  }
+}
+
+ch::Client *Result::streamClient() const {
+  return streaming ? static_cast<ch::Client *>(R_ExternalPtrAddr(streamConn)) : nullptr;
+}
+
+// R_CheckUserInterrupt longjmps, so it must be wrapped in R_ToplevelExec
+static void checkInterrupt(void *) {
+  R_CheckUserInterrupt();
+}
+
+void Result::receiveBlocks(ssize_t n) {
+  bool callbackFailed = false;
+  try {
+    while(streaming && (colNames.size() == 0 || n < 0 ||
+          availRows-fetchedRows < static_cast<size_t>(n))) {
+      ch::Client *client = streamClient();
+      ch::Block block;
+      bool interrupted = false;
+      // an interrupt while waiting for the block cancels the stream
+      if(!client || !client->ReceiveBlock(&block, [this, &interrupted] {
+            interrupted = !reportProgress() || R_ToplevelExec(checkInterrupt, NULL) == FALSE;
+            return !interrupted;
+          })) {
+        streaming = false;    // stream exhausted, or connection closed
+        if(client) {
+          finishClientStats(*client);
+        }
+        if(cacheTTL > 0 && client && !interrupted) {
+          ResultCache::instance().insert(cacheKey, std::move(cacheBlocks), cacheTTL);
+        }
+        cacheBlocks.clear();
+        onDone();
+        callbackFailed = progressFailed;
+        break;
+      }
+      addBlock(block);
+      if(cacheTTL > 0) {
+        cacheBlocks.push_back(block);
+      }
+
+      if(exceededMemoryLimit()) {
+        streaming = false;
+        cacheBlocks.clear();
+        client->CancelSelect();
+        finishClientStats(*client);
+      } else if(reachedRowLimit()) {
+        // the rest of the query isn't needed, it is canceled right away
+        // rather than once the result is cleared
+        streaming = false;
+        cacheBlocks.clear();
+        client->CancelSelect();
+        finishClientStats(*client);
+        onDone();
+        callbackFailed = progressFailed;
+      } else if(!reportProgress() || R_ToplevelExec(checkInterrupt, NULL) == FALSE) {
+        // stop at the rows received so far, like an interrupted select does
+        streaming = false;
+        cacheBlocks.clear();
+        client->CancelSelect();
+        finishClientStats(*client);
+        callbackFailed = progressFailed;
+      }
+    }
+  } catch(...) {
+    streaming = false;    // the client has already dropped the stream
+    cacheBlocks.clear();
+    if(ch::Client *client = static_cast<ch::Client *>(R_ExternalPtrAddr(streamConn))) {
+      finishClientStats(*client);
+    }
+    onDone();
+    throw;
+  }
+  // like a select whose progress callback fails, the fetch fails (once)
+  if(callbackFailed) {
+    throw std::runtime_error("the progress callback failed");
+  }
+}
+
+void Result::cacheWhenComplete(std::string key, double ttl) {
+  if(!streaming) {
+    return;   // nothing but the header block, or interrupted
+  }
+  // the header block has been received by the constructor, before the
+  // blocks were collected
+  ch::Block header;
+  for(size_t i = 0; i < colTypes.size(); i++) {
+    header.AppendColumn(std::string(colNames[i]), ch::CreateColumnByType(colTypes[i]->GetName()));
+  }
+  cacheBlocks.push_back(header);
+  cacheKey = std::move(key);
+  cacheTTL = ttl;
+}
+
+void Result::takeAsyncBlocks(bool wait) {
+  std::deque<ch::Block> blocks;
+  bool done;
+  {
+    std::unique_lock<std::mutex> lock(async->mutex);
+    if(wait && async->queues[async->current].empty() && !async->done) {
+      // wake up regularly to check for user interrupts
+      async->received.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    // an ordered result moves on to the next client once the blocks of
+    // the current one have all been handed over
+    for(;;) {
+      std::deque<ch::Block> &queue = async->queues[async->current];
+      blocks.insert(blocks.end(), queue.begin(), queue.end());
+      queue.clear();
+      if(async->current+1 == async->queues.size() || !async->clientDone[async->current]) {
+        break;
+      }
+      async->current++;
+    }
+    done = async->done;
+  }
+  for(const ch::Block &block : blocks) {
+    if(async->clients.size() > 1) {
+      checkColumns(block);
+    }
+    if(flight) {
+      flight->blocks.push_back(block);
+    } else {
+      addBlock(block);
+    }
+  }
+  if(flight) {
+    // including those received before it took the query over
+    addFlightBlocks();
+  }
+  if(done) {
+    finishAsync();
+  }
+}
+
+void Result::receiveAsyncBlocks(ssize_t n, bool wait) {
+  for(;;) {
+    // the blocks of a flight are received by one of its members for all
+    Result *receiver = async ? this : flight ? flight->receiver : nullptr;
+    if(!receiver) {
+      break;
+    }
+    receiver->takeAsyncBlocks(wait);
+    if(flight) {
+      addFlightBlocks();
+    }
+    if(exceededMemoryLimit()) {
+      stopAsync();
+      break;
+    }
+    // the other members of the flight still need the rest of the query
+    if(flight && reachedRowLimit()) {
+      stopAsync();
+    }
+
+    if(!async && !flight) {
+      reportProgress(true);
+      break;
+    } else if(!wait || (colNames.size() > 0 && n >= 0 &&
+          availRows-fetchedRows >= static_cast<size_t>(n))) {
+      break;
+    } else if(!reportProgress() || R_ToplevelExec(checkInterrupt, NULL) == FALSE) {
+      // stop at the rows received so far, like an interrupted select does
+      stopAsync();
+    }
+  }
+}
+
+void Result::finishAsync() {
+  for(std::thread &thread : async->threads) {
+    thread.join();
+  }
+  queryProgress = async->progress;
+  finishAsyncStats();
+  asyncError = async->error;
+  async.reset();
+  if(flight) {
+    endFlight(asyncError);
+  }
+}
+
+void Result::finishAsyncStats() {
+  ch::ClientStats stats;
+  for(size_t i = 0; i < async->clients.size(); i++) {
+    stats += async->clients[i]->GetStats().Since(async->statsStart[i]);
+    asyncResults.erase(async->clients[i]);
+  }
+  if(!clientStatsDone) {
+    clientStats = stats;
+    clientStatsDone = true;
+    traceEnd = std::chrono::steady_clock::now();
+  }
+}
+
+void Result::checkColumns(const ch::Block &block) const {
+  if(colTypes.empty()) {
+    return;
+  }
+  bool same = block.GetColumnCount() == colTypes.size();
+  for(size_t i = 0; same && i < colTypes.size(); i++) {
+    same = block[i]->Type()->GetName() == colTypes[i]->GetName();
+  }
+  if(!same) {
+    throw std::runtime_error("the shards of the query return different columns");
+  }
+}
+
+void Result::cancelAsync() {
+  if(!async) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(async->mutex);
+    async->cancel = true;
+  }
+  // the receiver notices the cancellation with the next block it receives,
+  // or within the check interval while waiting for one
+  for(std::thread &thread : async->threads) {
+    thread.join();
+  }
+  queryProgress = async->progress;
+  finishAsyncStats();
+  async.reset();
+  if(flight) {
+    endFlight(std::make_exception_ptr(std::runtime_error(
+        "the query shared with other results has been canceled")));
+  }
+}
+
+std::unordered_map<std::string, std::shared_ptr<Result::Flight>> Result::flights;
+
+void Result::startFlight(std::string key, double ttl) {
+  flight = std::make_shared<Flight>();
+  flight->key = std::move(key);
+  flight->ttl = ttl;
+  flight->queryId = queryId;
+  flight->receiver = this;
+  flight->members.push_back(this);
+  flights[flight->key] = flight;
+}
+
+std::string Result::flightQueryId(const std::string &key) {
+  auto it = flights.find(key);
+  return it == flights.end() ? std::string() : it->second->queryId;
+}
+
+void Result::joinFlight(const std::string &key, bool wait) {
+  auto it = flights.find(key);
+  if(it == flights.end()) {
+    return;
+  }
+  flight = it->second;
+  flight->members.push_back(this);
+  addFlightBlocks();
+  if(wait) {
+    receiveAsyncBlocks(-1, true);
+    rethrowAsyncError();
+    checkMemoryLimit();
+  }
+}
+
+void Result::addFlightBlocks() {
+  while(flightBlocks < flight->blocks.size()) {
+    addBlock(flight->blocks[flightBlocks++]);
+  }
+  if(flight->done) {
+    queryProgress = flight->progress;
+    asyncError = flight->error;
+    flight.reset();
+  }
+}
 
-      // first index within this block (note: can't use std::max(start-i, 0)
-      // here, since the variables are unsigned, and i>start is possible)
-      size_t localStart = (i < start ? start-i : 0),
-      // one past the last index within this block
-      // guaranteed to be >=0, since the loop is aborted if i >= start+len
-             localEnd = std::min(start+len-i, col->Size());
+void Result::endFlight(std::exception_ptr error) {
+  flight->done = true;
+  flight->receiver = nullptr;
+  flight->members.clear();
+  flight->progress = queryProgress;
+  flight->error = error;
+  auto it = flights.find(flight->key);
+  if(it != flights.end() && it->second == flight) {
+    flights.erase(it);
+  }
+  // the members which are still fetching keep the blocks until they have
+  // added them
+  if(!error) {
+    ResultCache::instance().insert(flight->key, flight->blocks, flight->ttl);
+  }
+  flight.reset();
+}
 
-      convFunc(cb, ccol, v, offset, localStart, localEnd);
-      offset += localEnd-localStart;
+void Result::stopAsync() {
+  if(!flight) {
+    cancelAsync();
+    return;
+  }
+  std::vector<Result *> &members = flight->members;
+  members.erase(std::remove(members.begin(), members.end(), this), members.end());
+  if(async && !members.empty()) {
+    // the next member receives the query from now on, over the connection of
+    // this result, which it keeps alive
+    Result *next = members.front();
+    next->async = std::move(async);
+    next->streamConn = streamConn;
+    for(ch::Client *client : next->async->clients) {
+      asyncResults[client] = next;
     }
+    flight->receiver = next;
+  } else if(async) {
+    cancelAsync();
+  }
+  flight.reset();
+}
+
+void Result::poll() {
+  receiveAsyncBlocks(-1, false);
+}
+
+void Result::rethrowAsyncError() {
+  if(asyncError) {
+    std::exception_ptr error = asyncError;
+    asyncError = nullptr;
+    std::rethrow_exception(error);
+  }
+}
 
-    i += col->Size();
+template<typename F>
+void Result::forEachBlock(size_t colIdx, size_t start, size_t len, F f) const {
+  // blocks before start have already been released, so at most the first
+  // block contains rows which were fetched before
+  size_t i = firstBlockRow, offset = 0;
+  for(const ColBlock &cb : columnBlocks) {
     if(i >= start+len) {  // processed all blocks in the requested range
       break;
     }
+
+    const ch::Column &col = *cb.columns[colIdx];
+
+    // first index within this block (note: can't use std::max(start-i, 0)
+    // here, since the variables are unsigned, and i>start is possible)
+    size_t localStart = (i < start ? start-i : 0),
+    // one past the last index within this block
+    // guaranteed to be >=0, since the loop is aborted if i >= start+len
+           localEnd = std::min(start+len-i, cb.rows);
+
+    f(col, offset, localStart, localEnd);
+    offset += localEnd-localStart;
+    i += cb.rows;
   }
-  df.push_back(v);
 }
 
 // helper function for converting a sequence of scalar column entries (can't be
 // a member of Result due to C++ prohibiting explicit specialization on members
 // of a non-specialized class)
 template<typename CT, typename RT>
-void convertEntries(std::shared_ptr<const CT> in, NullCol nullCol, RT &out,
+void convertEntries(const CT &in, const ch::ColumnNullable *nullCol, RT &out,
     size_t offset, size_t start, size_t end) {
   for(size_t j = start; j < end; j++) {
     // can't use the ternary operator here, since that would require explicit
@@ -56,14 +625,14 @@ void convertEntries(std::shared_ptr<const CT> in, NullCol nullCol, RT &out,
     if(nullCol && nullCol->IsNull(j)) {
       out[offset+j-start] = RT::get_na();
     } else {
-      out[offset+j-start] = in->At(j);
+      out[offset+j-start] = in.At(j);
     }
   }
 }
 
 
 template<>
-void convertEntries<ch::ColumnInt64, Rcpp::StringVector>(std::shared_ptr<const ch::ColumnInt64> in, NullCol nullCol, Rcpp::StringVector &out,
+void convertEntries<ch::ColumnInt64, Rcpp::StringVector>(const ch::ColumnInt64 &in, const ch::ColumnNullable *nullCol, Rcpp::StringVector &out,
                     size_t offset, size_t start, size_t end) {
   for(size_t j = start; j < end; j++) {
     // can't use the ternary operator here, since that would require explicit
@@ -71,266 +640,1547 @@ void convertEntries<ch::ColumnInt64, Rcpp::StringVector>(std::shared_ptr<const c
     if(nullCol && nullCol->IsNull(j)) {
       out[offset+j-start] = Rcpp::StringVector::get_na();
     } else {
-      out[offset+j-start] = std::to_string(in->At(j));
+      out[offset+j-start] = std::to_string(in.At(j));
+    }
+  }
+}
+
+
+template<>
+void convertEntries<ch::ColumnUInt64, Rcpp::StringVector>(const ch::ColumnUInt64 &in, const ch::ColumnNullable *nullCol, Rcpp::StringVector &out,
+                                                         size_t offset, size_t start, size_t end) {
+  for(size_t j = start; j < end; j++) {
+    // can't use the ternary operator here, since that would require explicit
+    // conversion from the Clickhouse storage type (which is far messier)
+    if(nullCol && nullCol->IsNull(j)) {
+      out[offset+j-start] = Rcpp::StringVector::get_na();
+    } else {
+      out[offset+j-start] = std::to_string(in.At(j));
+    }
+  }
+}
+// cache of the CHARSXPs created for the strings of one column during a fetch,
+// so that repeated values (e.g. country or status codes) are looked up in R's
+// global string cache only once. The cache is direct-mapped, and switches
+// itself off for the rest of the fetch if too few of the first lookups hit.
+// The cached CHARSXPs are only protected by the vectors they have been stored
+// into, so the cache must be reset once the converted column is complete.
+class CharCache {
+  static const size_t numSlots = 1024;      // must be a power of two
+  static const size_t probeLookups = 4096;  // lookups before deciding on the hit rate
+  static const size_t minHits = probeLookups / 4;
+
+  // the encoding the strings are marked with
+  cetype_t encoding;
+  std::vector<SEXP> slots;
+  size_t lookups = 0, hits = 0;
+  bool enabled = true;
+
+public:
+  explicit CharCache(cetype_t encoding) : encoding(encoding) {}
+
+  SEXP get(const char *data, int len) {
+    if(!enabled) {
+      return Rf_mkCharLenCE(data, len, encoding);
+    }
+    if(slots.empty()) {
+      slots.assign(numSlots, R_NilValue);
+    }
+
+    SEXP &slot = slots[CityHash64(data, len) & (numSlots-1)];
+    lookups++;
+    if(slot != R_NilValue && LENGTH(slot) == len && std::memcmp(CHAR(slot), data, len) == 0) {
+      hits++;
+      return slot;
+    }
+    SEXP str = Rf_mkCharLenCE(data, len, encoding);
+    slot = str;
+
+    if(lookups == probeLookups && hits < minHits) {
+      enabled = false;
+      slots.clear();
+    }
+    return str;
+  }
+
+  void reset() {
+    slots.clear();
+    lookups = hits = 0;
+    enabled = true;
+  }
+};
+
+// strings are turned into CHARSXPs straight from the views into the column's
+// buffer; like Rcpp's assignment from std::string, they end at an embedded NUL
+// (which also strips the zero padding of fixed-length strings)
+template<typename CT>
+void convertStringEntries(const CT &in, const ch::ColumnNullable *nullCol, CharCache &cache,
+                          Rcpp::StringVector &out, size_t offset, size_t start, size_t end) {
+  if(nullCol && nullCol->NullCount(start, end-start) == end-start) {
+    for(size_t j = start; j < end; j++) {
+      SET_STRING_ELT(out, offset+j-start, NA_STRING);
+    }
+    return;
+  }
+  for(size_t j = start; j < end; j++) {
+    if(nullCol && nullCol->IsNull(j)) {
+      SET_STRING_ELT(out, offset+j-start, NA_STRING);
+    } else {
+      StringView str = in[j];
+      const char *nul = static_cast<const char *>(std::memchr(str.data(), '\0', str.size()));
+      int len = static_cast<int>(nul ? nul-str.data() : str.size());
+      SET_STRING_ELT(out, offset+j-start, cache.get(str.data(), len));
+    }
+  }
+}
+
+template<>
+void convertEntries<ch::ColumnUUID, Rcpp::StringVector>(const ch::ColumnUUID &in,
+    const ch::ColumnNullable *nullCol, Rcpp::StringVector &out, size_t offset, size_t start, size_t end) {
+  const uint64_t *halves = in.Data();
+  char buf[uuidTextLength];
+  for(size_t j = start; j < end; j++) {
+    if(nullCol && nullCol->IsNull(j)) {
+      SET_STRING_ELT(out, offset+j-start, NA_STRING);
+    } else {
+      formatUUID(halves[2*j], halves[2*j+1], buf);
+      SET_STRING_ELT(out, offset+j-start, Rf_mkCharLen(buf, uuidTextLength));
     }
   }
 }
 
+// bulk conversion of numeric columns, which writes R's INTEGER/REAL storage
+// directly: identical layouts (Int32, Float64) are copied, other types are
+// widened in a plain loop that the compiler can vectorize, and NULL entries
+// are masked using the null flags of the Nullable column (without a branch);
+// ranges of NULLs only are filled with NA
+template<typename T, typename RT>
+void convertNumericEntries(const ch::ColumnVector<T> &in, const ch::ColumnNullable *nullCol,
+    RT &out, size_t offset, size_t start, size_t end) {
+  using ST = typename RT::stored_type;
+  const size_t n = end-start;
+  const T *src = in.Data()+start;
+  ST *dst = out.begin()+offset;
+
+  if(nullCol && nullCol->NullCount(start, n) == n) {
+    std::fill(dst, dst+n, RT::get_na());
+    return;
+  }
+
+  if(std::is_same<T, ST>::value) {
+    std::memcpy(dst, src, n*sizeof(T));
+  } else {
+    for(size_t j = 0; j < n; j++) {
+      dst[j] = static_cast<ST>(src[j]);
+    }
+  }
+
+  if(nullCol) {
+    auto nulls = std::static_pointer_cast<ch::ColumnUInt8>(nullCol->Nulls());
+    const uint8_t *mask = nulls->Data()+start;
+    const ST na = RT::get_na();
+    for(size_t j = 0; j < n; j++) {
+      dst[j] = mask[j] ? na : dst[j];
+    }
+  }
+}
+
+// conversion of 64-bit integer columns to the REALSXP storage of
+// bit64::integer64 vectors; Int64 is copied bit for bit, UInt64 values beyond
+// the range of integer64 become NA (which is what bit64 does as well)
+template<typename T>
+void convertInteger64Entries(const ch::ColumnVector<T> &in, const ch::ColumnNullable *nullCol,
+    Rcpp::NumericVector &out, size_t offset, size_t start, size_t end) {
+  const size_t n = end-start;
+  const T *src = in.Data()+start;
+  int64_t *dst = reinterpret_cast<int64_t *>(out.begin()+offset);
+
+  if(nullCol && nullCol->NullCount(start, n) == n) {
+    std::fill(dst, dst+n, NA_INTEGER64);
+    return;
+  }
+
+  if(std::is_signed<T>::value) {
+    std::memcpy(dst, src, n*sizeof(T));
+  } else {
+    for(size_t j = 0; j < n; j++) {
+      dst[j] = src[j] > static_cast<uint64_t>(LLONG_MAX) ? NA_INTEGER64 : static_cast<int64_t>(src[j]);
+    }
+  }
+
+  if(nullCol) {
+    auto nulls = std::static_pointer_cast<ch::ColumnUInt8>(nullCol->Nulls());
+    const uint8_t *mask = nulls->Data()+start;
+    for(size_t j = 0; j < n; j++) {
+      dst[j] = mask[j] ? NA_INTEGER64 : dst[j];
+    }
+  }
+}
+
+// dense mapping from all values of an enum's storage type (256 for Enum8,
+// 65536 for Enum16) to the level indices of the R factor; values that are not
+// in the enum type map to NA
+template<typename VT>
+class LevelTable {
+  using UVT = typename std::make_unsigned<VT>::type;
+  std::vector<int> levels;
+
+public:
+  LevelTable() : levels(size_t(1) << (8*sizeof(VT)), NA_INTEGER) {}
+
+  void set(VT value, int level) {
+    levels[static_cast<UVT>(value)] = level;
+  }
+
+  int operator[](VT value) const {
+    return levels[static_cast<UVT>(value)];
+  }
+};
+
+template<typename CT, typename VT>
+void convertEnumEntries(const CT &in, const LevelTable<VT> &levelTable,
+    const ch::ColumnNullable *nullCol, Rcpp::IntegerVector &out, size_t offset, size_t start, size_t end) {
+  const VT *src = in.Data();
+  int *dst = out.begin()+offset;
+  if(nullCol) {
+    for(size_t j = start; j < end; j++) {
+      *dst++ = nullCol->IsNull(j) ? NA_INTEGER : levelTable[src[j]];
+    }
+  } else {
+    for(size_t j = start; j < end; j++) {
+      *dst++ = levelTable[src[j]];
+    }
+  }
+}
+
+// Conversion policies: each policy converts the entries of a column of one
+// fixed Clickhouse type to an R vector of type RT. The column type has been
+// checked when the policy was chosen, so the columns are only static_cast.
+// Policies are nested at compile time (e.g. an array of nullable integers is a
+// ArrayPolicy<NullablePolicy<ScalarPolicy<...>>>), so that converting a block
+// involves neither virtual nor type-erased calls.
+//
+// Each policy provides
+//   alloc(len):    create an R vector of the given length
+//   convert(col, nullCol, out, offset, start, end):
+//                  convert entries [start, end) of col into out, beginning at
+//                  offset; nullCol (if not nullptr) marks the NULL entries
+//   finish(out):   set the attributes of a completely converted vector
+//   reset():       drop any state referring to R objects, once all blocks of
+//                  a fetch have been converted
+//   threadSafe:    whether convert calls no R API functions (it may then be
+//                  called from threads other than R's)
+
+template<typename CT, typename RT_>
+struct ScalarPolicy {
+  using RT = RT_;
+  static const bool threadSafe = !std::is_same<RT, Rcpp::StringVector>::value;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    convertEntries<CT, RT>(static_cast<const CT &>(col), nullCol, out, offset, start, end);
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+template<typename CT>
+class StringPolicy {
+  CharCache cache;
+
+public:
+  using RT = Rcpp::StringVector;
+  static const bool threadSafe = false;
+
+  explicit StringPolicy(cetype_t encoding) : cache(encoding) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    convertStringEntries<CT>(static_cast<const CT &>(col), nullCol, cache, out, offset, start, end);
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {
+    cache.reset();
+  }
+};
+
+// LowCardinality columns of (possibly nullable) strings are turned into
+// factors straight from their dictionaries: each dictionary entry is looked up
+// among the levels at most once per block, and the rows only map positions.
+// The levels are in the order of their first appearance during a fetch.
+template<typename CT>
+class LowCardinalityPolicy {
+  cetype_t encoding;
+  std::unordered_map<std::string, int> levelIndex;
+  std::vector<std::string> levels;
+  std::vector<int> codes;   // factor codes per dictionary position (0: unknown)
+  // dictionary the codes refer to, kept alive so that it isn't mistaken for
+  // another one allocated at its address once its block has been released
+  // (when the rows of several fetches are accumulated)
+  ch::ColumnRef codesDict;
+
+  int levelOf(StringView str) {
+    // cut at the first NUL, like the strings in StringPolicy
+    const char *nul = static_cast<const char *>(std::memchr(str.data(), '\0', str.size()));
+    std::string name(str.data(), nul ? nul-str.data() : str.size());
+    auto it = levelIndex.find(name);
+    if(it != levelIndex.end()) {
+      return it->second;
+    }
+    levels.push_back(name);
+    return levelIndex[name] = levels.size();   // note: R factor level indices start at 1
+  }
+
+  template<typename IT>
+  void mapIndexes(const ch::ColumnVector<IT> &indexes, const CT &dict, bool nullable,
+      Rcpp::IntegerVector &out, size_t offset, size_t start, size_t end) {
+    const IT *pos = indexes.Data();
+    for(size_t j = start; j < end; j++) {
+      size_t k = pos[j];
+      if(nullable && k == 0) {
+        out[offset+j-start] = NA_INTEGER;
+        continue;
+      }
+      int &code = codes[k];
+      if(code == 0) {
+        code = levelOf(dict[k]);
+      }
+      out[offset+j-start] = code;
+    }
+  }
+
+public:
+  using RT = Rcpp::IntegerVector;
+  static const bool threadSafe = true;
+
+  explicit LowCardinalityPolicy(cetype_t encoding) : encoding(encoding) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  //NOTE: LowCardinality can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    auto &lcCol = static_cast<const ch::ColumnLowCardinality &>(col);
+    ch::ColumnRef dictRef = lcCol.GetDictionary();
+    auto &dict = static_cast<const CT &>(*dictRef);
+    const ch::Column &indexes = *lcCol.GetIndexes();
+    // slices (e.g. the entries of an array column) share the dictionary of
+    // their block
+    if(codesDict != dictRef) {
+      codes.assign(dict.Size(), 0);
+      codesDict = std::move(dictRef);
+    }
+
+    switch(indexes.Type()->GetCode()) {
+      case ch::Type::Code::UInt8:
+        mapIndexes(static_cast<const ch::ColumnUInt8 &>(indexes), dict, lcCol.IsNullable(), out, offset, start, end);
+        break;
+      case ch::Type::Code::UInt16:
+        mapIndexes(static_cast<const ch::ColumnUInt16 &>(indexes), dict, lcCol.IsNullable(), out, offset, start, end);
+        break;
+      case ch::Type::Code::UInt32:
+        mapIndexes(static_cast<const ch::ColumnUInt32 &>(indexes), dict, lcCol.IsNullable(), out, offset, start, end);
+        break;
+      default:
+        mapIndexes(static_cast<const ch::ColumnUInt64 &>(indexes), dict, lcCol.IsNullable(), out, offset, start, end);
+        break;
+    }
+  }
+
+  void finish(RT &out) const {
+    Rcpp::CharacterVector levelNames(levels.size());
+    for(size_t i = 0; i < levels.size(); i++) {
+      SET_STRING_ELT(levelNames, i, Rf_mkCharLenCE(levels[i].data(), levels[i].size(), encoding));
+    }
+    out.attr("class") = "factor";
+    out.attr("levels") = levelNames;
+  }
+
+  void reset() {
+    levelIndex.clear();
+    levels.clear();
+    codesDict = nullptr;
+  }
+};
+
+template<typename T, typename RT_>
+struct NumericPolicy {
+  using RT = RT_;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    convertNumericEntries<T, RT>(static_cast<const ch::ColumnVector<T> &>(col), nullCol, out, offset, start, end);
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+// integer columns of a wider range than R's integers (UInt32, Int64, UInt64):
+// the values beyond it become NA, with a warning once the fetch is done
+template<typename T>
+class CheckedIntegerPolicy {
+  std::string name;
+  bool overflow = false;
+  bool warned = false;
+
+public:
+  using RT = Rcpp::IntegerVector;
+  static const bool threadSafe = true;
+
+  explicit CheckedIntegerPolicy(std::string name) : name(std::move(name)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const T *src = static_cast<const ch::ColumnVector<T> &>(col).Data()+start;
+    const size_t n = end-start;
+    int *dst = out.begin()+offset;
+    const uint8_t *mask = nullptr;
+    if(nullCol) {
+      mask = std::static_pointer_cast<ch::ColumnUInt8>(nullCol->Nulls())->Data()+start;
+    }
+    // NA_INTEGER is INT_MIN, so the range is symmetric
+    for(size_t j = 0; j < n; j++) {
+      const T v = src[j];
+      const bool inRange = v <= static_cast<T>(std::numeric_limits<int>::max()) &&
+          (!std::is_signed<T>::value || v >= static_cast<T>(-std::numeric_limits<int>::max()));
+      overflow |= !inRange && !(mask && mask[j]);
+      dst[j] = (mask && mask[j]) || !inRange ? NA_INTEGER : static_cast<int>(v);
+    }
+  }
+
+  // also called for each row of arrays, but warns only once per fetch
+  void finish(RT &) {
+    if(overflow && !warned) {
+      warned = true;
+      warn("values of column "+name+" beyond the range of integers converted to NA");
+    }
+  }
+
+  void reset() {
+    overflow = warned = false;
+  }
+};
+
+template<typename T>
+struct Integer64Policy {
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    convertInteger64Entries<T>(static_cast<const ch::ColumnVector<T> &>(col), nullCol, out, offset, start, end);
+  }
+
+  void finish(RT &out) const {
+    out.attr("class") = "integer64";
+  }
+
+  void reset() {}
+};
+
+// Decimal columns stored as T (Int32 or Int64): the unscaled values are
+// divided by 10^scale, or, in exact mode, copied into a bit64::integer64
+// vector which keeps the scale in its attribute "scale"
+template<typename T>
+class DecimalPolicy {
+  int scale;
+  double factor;
+  bool exact;
+
+public:
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  DecimalPolicy(int scale, bool exact) : scale(scale), factor(std::pow(10.0, scale)), exact(exact) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    ch::ColumnRef data = static_cast<const ch::ColumnDecimal &>(col).GetNestedColumn();
+    const T *src = static_cast<const ch::ColumnVector<T> &>(*data).Data()+start;
+    const size_t n = end-start;
+    const uint8_t *mask = nullptr;
+    if(nullCol) {
+      mask = std::static_pointer_cast<ch::ColumnUInt8>(nullCol->Nulls())->Data()+start;
+    }
+
+    if(exact) {
+      int64_t *dst = reinterpret_cast<int64_t *>(out.begin()+offset);
+      for(size_t j = 0; j < n; j++) {
+        dst[j] = mask && mask[j] ? NA_INTEGER64 : static_cast<int64_t>(src[j]);
+      }
+    } else {
+      double *dst = out.begin()+offset;
+      for(size_t j = 0; j < n; j++) {
+        dst[j] = mask && mask[j] ? NA_REAL : src[j]/factor;
+      }
+    }
+  }
+
+  void finish(RT &out) const {
+    if(exact) {
+      out.attr("class") = "integer64";
+      out.attr("scale") = scale;
+    }
+  }
+
+  void reset() {}
+};
+
+// UUIDs as the rows of a raw matrix with 16 columns, which hold the bytes in
+// the order of the textual form; NULL entries are all zero
+struct UUIDRawPolicy {
+  using RT = Rcpp::RawVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len*16);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const uint64_t *halves = static_cast<const ch::ColumnUUID &>(col).Data();
+    const size_t nrow = XLENGTH(out)/16;
+    Rbyte *dst = RAW(out)+offset;
+    for(size_t j = start; j < end; j++, dst++) {
+      bool isNull = nullCol && nullCol->IsNull(j);
+      for(int k = 0; k < 16; k++) {
+        uint64_t half = halves[2*j+k/8];
+        dst[k*nrow] = isNull ? 0 : static_cast<Rbyte>(half >> (56-8*(k%8)));
+      }
+    }
+  }
+
+  void finish(RT &out) const {
+    out.attr("dim") = Rcpp::Dimension(out.size()/16, 16);
+  }
+
+  void reset() {}
+};
+
+// UUIDs as the rows of a bit64::integer64 matrix holding the high and the low
+// 64 bits; NULL entries are NA in both columns
+struct UUIDInteger64Policy {
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len*2);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const uint64_t *halves = static_cast<const ch::ColumnUUID &>(col).Data();
+    const size_t nrow = XLENGTH(out)/2;
+    int64_t *hi = reinterpret_cast<int64_t *>(REAL(out))+offset,
+            *lo = hi+nrow;
+    for(size_t j = start; j < end; j++, hi++, lo++) {
+      bool isNull = nullCol && nullCol->IsNull(j);
+      *hi = isNull ? NA_INTEGER64 : static_cast<int64_t>(halves[2*j]);
+      *lo = isNull ? NA_INTEGER64 : static_cast<int64_t>(halves[2*j+1]);
+    }
+  }
+
+  void finish(RT &out) const {
+    out.attr("dim") = Rcpp::Dimension(out.size()/2, 2);
+    out.attr("class") = "integer64";
+  }
+
+  void reset() {}
+};
+
+// Date columns hold the days since the epoch like R's Dates, which are widened
+// from the column storage
+struct DatePolicy {
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const uint16_t *src = static_cast<const ch::ColumnDate &>(col).Data();
+    if(nullCol) {
+      double *dst = out.begin()+offset;
+      for(size_t j = start; j < end; j++) {
+        *dst++ = nullCol->IsNull(j) ? NA_REAL : src[j];
+      }
+    } else {
+      std::copy(src+start, src+end, out.begin()+offset);
+    }
+  }
+
+  void finish(RT &out) const {
+    out.attr("class") = "Date";
+  }
+
+  void reset() {}
+};
+
+// DateTime and DateTime64 columns as POSIXct, whose seconds are computed from
+// the seconds or ticks in one pass over the column storage; the vector gets
+// the time zone of the column type (or UTC, like Rcpp's DatetimeVector)
+template<typename CT>
+class DateTimePolicy {
+  double ticksPerSecond;
+  std::string timezone;
+
+public:
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  DateTimePolicy(double ticksPerSecond, std::string timezone)
+    : ticksPerSecond(ticksPerSecond), timezone(timezone.empty() ? "UTC" : std::move(timezone)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const auto *src = static_cast<const CT &>(col).Data();
+    double *dst = out.begin()+offset;
+    if(ticksPerSecond == 1) {
+      for(size_t j = start; j < end; j++) {
+        *dst++ = nullCol && nullCol->IsNull(j) ? NA_REAL : static_cast<double>(src[j]);
+      }
+    } else {
+      for(size_t j = start; j < end; j++) {
+        *dst++ = nullCol && nullCol->IsNull(j) ? NA_REAL : src[j]/ticksPerSecond;
+      }
+    }
+  }
+
+  void finish(RT &out) const {
+    out.attr("class") = Rcpp::CharacterVector::create("POSIXct", "POSIXt");
+    out.attr("tzone") = timezone;
+  }
+
+  void reset() {}
+};
+
+// IPv4 addresses as their numeric values (doubles, since UInt32 exceeds the
+// range of R's integers)
+struct IPv4Policy {
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const uint32_t *src = static_cast<const ch::ColumnIPv4 &>(col).Data();
+    double *dst = out.begin()+offset;
+    for(size_t j = start; j < end; j++) {
+      *dst++ = nullCol && nullCol->IsNull(j) ? NA_REAL : src[j];
+    }
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+// IPv4 addresses in dotted notation, formatted without going through
+// inet_ntoa and std::string
+struct IPv4StringPolicy {
+  using RT = Rcpp::StringVector;
+  static const bool threadSafe = false;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const uint32_t *src = static_cast<const ch::ColumnIPv4 &>(col).Data();
+    char buf[16];
+    for(size_t j = start; j < end; j++) {
+      if(nullCol && nullCol->IsNull(j)) {
+        SET_STRING_ELT(out, offset+j-start, NA_STRING);
+        continue;
+      }
+      char *p = buf;
+      for(int shift = 24; shift >= 0; shift -= 8) {
+        unsigned b = (src[j] >> shift) & 0xFF;
+        if(b >= 100) {
+          *p++ = '0'+b/100;
+        }
+        if(b >= 10) {
+          *p++ = '0'+b/10%10;
+        }
+        *p++ = '0'+b%10;
+        *p++ = '.';
+      }
+      SET_STRING_ELT(out, offset+j-start, Rf_mkCharLen(buf, p-buf-1));
+    }
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+// IPv6 addresses as the rows of a raw matrix with their 16 bytes (in network
+// byte order); NULL entries are all zero
+struct IPv6RawPolicy {
+  using RT = Rcpp::RawVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len*16);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const unsigned char *src = static_cast<const ch::ColumnIPv6 &>(col).Data();
+    const size_t nrow = XLENGTH(out)/16;
+    Rbyte *dst = RAW(out)+offset;
+    for(size_t j = start; j < end; j++, dst++) {
+      bool isNull = nullCol && nullCol->IsNull(j);
+      for(int k = 0; k < 16; k++) {
+        dst[k*nrow] = isNull ? 0 : src[16*j+k];
+      }
+    }
+  }
+
+  void finish(RT &out) const {
+    out.attr("dim") = Rcpp::Dimension(out.size()/16, 16);
+  }
+
+  void reset() {}
+};
+
+// IPv6 addresses in their textual form
+struct IPv6StringPolicy {
+  using RT = Rcpp::StringVector;
+  static const bool threadSafe = false;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    const unsigned char *src = static_cast<const ch::ColumnIPv6 &>(col).Data();
+    char buf[INET6_ADDRSTRLEN];
+    for(size_t j = start; j < end; j++) {
+      if(nullCol && nullCol->IsNull(j)) {
+        SET_STRING_ELT(out, offset+j-start, NA_STRING);
+      } else if(inet_ntop(AF_INET6, src+16*j, buf, sizeof(buf))) {
+        SET_STRING_ELT(out, offset+j-start, Rf_mkChar(buf));
+      } else {
+        throw std::runtime_error("invalid IPv6 address");
+      }
+    }
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+// columns of type Nothing (e.g. of SELECT NULL) only hold NULLs
+struct NothingPolicy {
+  using RT = Rcpp::LogicalVector;
+  static const bool threadSafe = true;
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    std::fill(out.begin()+offset, out.begin()+offset+(end-start), NA_LOGICAL);
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {}
+};
+
+template<typename CT, typename VT>
+class EnumPolicy {
+  Rcpp::CharacterVector levels;
+  LevelTable<VT> levelTable;  // mapping from enum values in the column type to
+                              // level indices in the R factor to be created
+
+public:
+  using RT = Rcpp::IntegerVector;
+  static const bool threadSafe = true;
+
+  EnumPolicy(const ch::EnumType &type) {
+    for (auto it = type.BeginValueToName(); it != type.EndValueToName(); it++) {
+      levels.push_back(it->second);
+      levelTable.set(it->first, levels.size());  // note: R factor level indices start at 1
+    }
+  }
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    convertEnumEntries<CT, VT>(static_cast<const CT &>(col), levelTable, nullCol, out, offset, start, end);
+  }
+
+  void finish(RT &out) const {
+    out.attr("class") = "factor";
+    out.attr("levels") = levels;
+  }
+
+  void reset() {}
+};
+
+template<typename P>
+class NullablePolicy {
+  P elem;
+
+public:
+  using RT = typename P::RT;
+  static const bool threadSafe = P::threadSafe;
+
+  NullablePolicy(P elem) : elem(std::move(elem)) {}
+
+  RT alloc(size_t len) const {
+    return elem.alloc(len);
+  }
+
+  //NOTE: nested nullable is not currently permitted in Clickhouse
+  // without NULLs in the range, the entries are converted like those of the
+  // nested column, skipping the null flags
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    auto &nullCol = static_cast<const ch::ColumnNullable &>(col);
+    const bool anyNull = nullCol.NullCount(start, end-start) > 0;
+    elem.convert(*nullCol.Nested(), anyNull ? &nullCol : nullptr, out, offset, start, end);
+  }
+
+  void finish(RT &out) {
+    elem.finish(out);
+  }
+
+  void reset() {
+    elem.reset();
+  }
+};
+
+// the entries of an array column are converted from its flat data column, with
+// the element policy P, over the ranges given by the offsets
+template<typename P>
+class ArrayPolicy {
+  P elem;
+
+public:
+  using RT = Rcpp::List;
+  static const bool threadSafe = false;
+
+  ArrayPolicy(P elem) : elem(std::move(elem)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  //NOTE: arrays can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    auto &arrCol = static_cast<const ch::ColumnArray &>(col);
+    ch::ColumnRef data = arrCol.GetData();
+    const uint64_t *offsets = arrCol.GetOffsets()->Data();
+    for(size_t j = start; j < end; j++) {
+      size_t first = j == 0 ? 0 : offsets[j-1];
+      typename P::RT v = elem.alloc(offsets[j]-first);
+      elem.convert(*data, nullptr, v, 0, first, offsets[j]);
+      elem.finish(v);
+      out[offset+j-start] = v;
+    }
+  }
+
+  void finish(RT &) const {}
+
+  void reset() {
+    elem.reset();
+  }
+};
+
+// the entries of a column in flat form, converted block by block with the
+// policy P, as one vector
+template<typename P>
+Rcpp::RObject joinChunks(P &elem, const std::vector<typename P::RT> &chunks) {
+  if(chunks.empty()) {
+    typename P::RT v = elem.alloc(0);
+    elem.finish(v);
+    return v;
+  } else if(chunks.size() == 1) {
+    return chunks.front();
+  }
+  // c() also merges the levels of factors and keeps classes like integer64
+  Rcpp::List parts(chunks.begin(), chunks.end());
+  Rcpp::Function doCall("do.call");
+  return doCall("c", parts);
+}
+
+// array columns in flat form: the column holds the end offset of the entries
+// of each row within the vector of all entries, which is attached as its
+// attribute "values" (converted with the element policy P once per block)
+template<typename P>
+class FlatArrayPolicy {
+  P elem;
+  std::vector<typename P::RT> chunks;   // converted entries of each block
+  double numEntries = 0;
+
+public:
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = false;
+
+  FlatArrayPolicy(P elem) : elem(std::move(elem)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
+  }
+
+  //NOTE: arrays can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    if(start == end) {
+      return;
+    }
+    auto &arrCol = static_cast<const ch::ColumnArray &>(col);
+    ch::ColumnRef data = arrCol.GetData();
+    const uint64_t *offsets = arrCol.GetOffsets()->Data();
+    size_t first = start == 0 ? 0 : offsets[start-1];
+    for(size_t j = start; j < end; j++) {
+      out[offset+j-start] = numEntries+(offsets[j]-first);
+    }
+
+    typename P::RT v = elem.alloc(offsets[end-1]-first);
+    elem.convert(*data, nullptr, v, 0, first, offsets[end-1]);
+    elem.finish(v);
+    chunks.push_back(v);
+    numEntries += offsets[end-1]-first;
+  }
+
+  void finish(RT &out) {
+    out.attr("values") = joinChunks(elem, chunks);
+  }
+
+  void reset() {
+    elem.reset();
+    chunks.clear();
+    numEntries = 0;
+  }
+};
+
+// copy the first rows entries of from into to, vectors of the same type
+// allocated by a policy for fromLen and toLen entries; the values are stored
+// column by column, as the matrices of UUIDs and IPv6 addresses hold several
+// per entry
+static void copyRows(SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) {
+  if(rows == 0) {
+    return;
+  }
+  const size_t width = XLENGTH(to)/toLen;
+  for(size_t k = 0; k < width; k++) {
+    const size_t src = k*fromLen, dst = k*toLen;
+    switch(TYPEOF(to)) {
+      case LGLSXP:
+      case INTSXP:
+        std::memcpy(INTEGER(to)+dst, INTEGER(from)+src, rows*sizeof(int));
+        break;
+      case REALSXP:
+        std::memcpy(REAL(to)+dst, REAL(from)+src, rows*sizeof(double));
+        break;
+      case RAWSXP:
+        std::memcpy(RAW(to)+dst, RAW(from)+src, rows);
+        break;
+      case STRSXP:
+        for(size_t i = 0; i < rows; i++) {
+          SET_STRING_ELT(to, dst+i, STRING_ELT(from, src+i));
+        }
+        break;
+      case VECSXP:
+        for(size_t i = 0; i < rows; i++) {
+          SET_VECTOR_ELT(to, dst+i, VECTOR_ELT(from, src+i));
+        }
+        break;
+      default:
+        Rcpp::stop(std::string("can't copy the entries of a ")+Rf_type2char(TYPEOF(to)));
+    }
+  }
+}
+
+// copy the entries converted by policy (see copyRows), overloaded for
+// policies whose vectors don't hold their entries themselves
+template<typename P>
+void copyPolicyRows(const P &, SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) {
+  copyRows(from, to, rows, fromLen, toLen);
+}
+
+// type-erased policy, used for the elements of tuples and for the arrays
+// between the outermost and the innermost one of nested arrays, so that
+// policies are not instantiated for every combination of nesting
+class AnyPolicy {
+  struct Impl {
+    virtual ~Impl() {};
+    virtual Rcpp::RObject alloc(size_t len) const = 0;
+    virtual void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+        SEXP out, size_t offset, size_t start, size_t end) = 0;
+    virtual void finish(SEXP out) = 0;
+    virtual void reset() = 0;
+    virtual void copyRows(SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) const = 0;
+  };
+
+  // the vectors are wrapped (without copying) in the RT of the policy
+  template<typename P>
+  struct TypedImpl : Impl {
+    P policy;
+    TypedImpl(P policy) : policy(std::move(policy)) {}
+    Rcpp::RObject alloc(size_t len) const override {
+      return policy.alloc(len);
+    }
+    void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+        SEXP out, size_t offset, size_t start, size_t end) override {
+      typename P::RT v(out);
+      policy.convert(col, nullCol, v, offset, start, end);
+    }
+    void finish(SEXP out) override {
+      typename P::RT v(out);
+      policy.finish(v);
+    }
+    void reset() override {
+      policy.reset();
+    }
+    void copyRows(SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) const override {
+      copyPolicyRows(policy, from, to, rows, fromLen, toLen);
+    }
+  };
+
+  std::unique_ptr<Impl> impl;
+
+  explicit AnyPolicy(Impl *impl) : impl(impl) {}
+
+public:
+  using RT = Rcpp::RObject;
+  static const bool threadSafe = false;
+
+  template<typename P>
+  static AnyPolicy of(P policy) {
+    return AnyPolicy(new TypedImpl<P>(std::move(policy)));
+  }
+
+  AnyPolicy(AnyPolicy &&) = default;
+  AnyPolicy &operator=(AnyPolicy &&) = default;
+
+  RT alloc(size_t len) const {
+    return impl->alloc(len);
+  }
+
+  void convert(const ch::Column &col, const ch::ColumnNullable *nullCol,
+      RT &out, size_t offset, size_t start, size_t end) {
+    impl->convert(col, nullCol, out, offset, start, end);
+  }
+
+  void finish(RT &out) {
+    impl->finish(out);
+  }
+
+  void reset() {
+    impl->reset();
+  }
+
+  void copyRows(SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) const {
+    impl->copyRows(from, to, rows, fromLen, toLen);
+  }
+};
+
+// tuples become data frames with a column per element (named by position)
+class TuplePolicy {
+  std::vector<AnyPolicy> elems;
+
+public:
+  using RT = Rcpp::List;
+  static const bool threadSafe = false;
+
+  TuplePolicy(std::vector<AnyPolicy> elems) : elems(std::move(elems)) {}
+
+  RT alloc(size_t len) const {
+    RT out(elems.size());
+    for(size_t k = 0; k < elems.size(); k++) {
+      out[k] = elems[k].alloc(len);
+    }
+    out.attr("row.names") = rowNames(0, len);
+    return out;
+  }
+
+  //NOTE: tuples can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    auto &tupleCol = static_cast<const ch::ColumnTuple &>(col);
+    for(size_t k = 0; k < elems.size(); k++) {
+      Rcpp::RObject v = out[k];
+      elems[k].convert(*tupleCol[k], nullptr, v, offset, start, end);
+    }
+  }
 
-template<>
-void convertEntries<ch::ColumnUInt64, Rcpp::StringVector>(std::shared_ptr<const ch::ColumnUInt64> in, NullCol nullCol, Rcpp::StringVector &out,
-                                                         size_t offset, size_t start, size_t end) {
-  for(size_t j = start; j < end; j++) {
-    // can't use the ternary operator here, since that would require explicit
-    // conversion from the Clickhouse storage type (which is far messier)
-    if(nullCol && nullCol->IsNull(j)) {
-      out[offset+j-start] = Rcpp::StringVector::get_na();
-    } else {
-      out[offset+j-start] = std::to_string(in->At(j));
+  void finish(RT &out) {
+    Rcpp::CharacterVector names(elems.size());
+    for(size_t k = 0; k < elems.size(); k++) {
+      Rcpp::RObject v = out[k];
+      elems[k].finish(v);
+      names[k] = std::to_string(k+1);
     }
+    out.attr("names") = names;
+    out.attr("class") = "data.frame";
   }
-}
-// Date requires specialization: otherwise causes problems due to type
-// ambiguities in the Rcpp::Date constructor, which expects either int or
-// double, whereas ColumnDate values are uint32_t
-template<>
-void convertEntries<ch::ColumnDate, Rcpp::DateVector>(std::shared_ptr<const ch::ColumnDate> in,
-    NullCol nullCol, Rcpp::DateVector &out, size_t offset, size_t start, size_t end) {
-  for(size_t j = start; j < end; j++) {
-    if(nullCol && nullCol->IsNull(j)) {
-      out[offset+j-start] = Rcpp::DateVector::get_na();
-    } else {
-      out[offset+j-start] = static_cast<int>(in->At(j)/(60*60*24));
+
+  void reset() {
+    for(auto &e : elems) {
+      e.reset();
     }
   }
-}
 
-std::string formatUUID(const ch::UInt128 &v) {
-  const size_t bufsize = 128/4 + 4 + 1;  // 128 bit in hexadecimal + 4 dashes + null terminator
-  char buf[bufsize];
+  void copyRows(SEXP from, SEXP to, size_t rows, size_t fromLen, size_t toLen) const {
+    for(size_t k = 0; k < elems.size(); k++) {
+      elems[k].copyRows(VECTOR_ELT(from, k), VECTOR_ELT(to, k), rows, fromLen, toLen);
+    }
+  }
+};
 
-  std::snprintf(&buf[0], bufsize, "%08llx-%04llx-%04llx-%04llx-%012llx",
-      static_cast<unsigned long long>(v.first>>32),
-      (v.first>>16)&0xFFFFllu,
-      v.first&0xFFFFllu,
-      static_cast<unsigned long long>(v.second>>48),
-      v.second&0xFFFFFFFFFFFFllu);
-  return std::string(buf);
+// the elements of tuples are copied one by one
+void copyPolicyRows(const TuplePolicy &policy, SEXP from, SEXP to, size_t rows,
+    size_t fromLen, size_t toLen) {
+  policy.copyRows(from, to, rows, fromLen, toLen);
 }
 
-template<>
-void convertEntries<ch::ColumnUUID, Rcpp::StringVector>(std::shared_ptr<const ch::ColumnUUID> in,
-    NullCol nullCol, Rcpp::StringVector &out, size_t offset, size_t start, size_t end) {
-  for(size_t j = start; j < end; j++) {
-    if(nullCol && nullCol->IsNull(j)) {
-      out[offset+j-start] = Rcpp::StringVector::get_na();
-    } else {
-      out[offset+j-start] = formatUUID(in->At(j));
-    }
+// the keys of a map, converted by the key policy, as the names of its values
+static Rcpp::RObject keyNames(SEXP keys) {
+  if(TYPEOF(keys) == STRSXP && !OBJECT(keys)) {
+    return keys;
+  } else if(OBJECT(keys)) {
+    // factors, integer64, dates, ...
+    Rcpp::Function asCharacter("as.character");
+    return asCharacter(keys);
   }
+  return Rf_coerceVector(keys, STRSXP);
 }
 
-template<typename VT>
-using LevelMapT = std::map<VT, unsigned>;
+// map columns become lists of one vector of the values per row, named by the
+// keys; the entries of each row are converted from the flat key and value
+// columns of the maps, like the entries of arrays
+class MapPolicy {
+  AnyPolicy keys, values;
 
-template<typename CT, typename VT, typename RT>
-void convertEnumEntries(std::shared_ptr<const CT> in, LevelMapT<VT> &levelMap,
-    NullCol nullCol, RT &out, size_t offset, size_t start, size_t end) {
-  for(size_t j = start; j < end; j++) {
-    if(nullCol && nullCol->IsNull(j)) {
-      out[offset+j-start] = RT::get_na();
-    } else {
-      out[offset+j-start] = levelMap[in->At(j)];
-    }
+public:
+  using RT = Rcpp::List;
+  static const bool threadSafe = false;
+
+  MapPolicy(AnyPolicy keys, AnyPolicy values) : keys(std::move(keys)), values(std::move(values)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
   }
-}
 
-template<typename CT, typename RT>
-class ScalarConverter : public Converter {
-  void processBlocks(Result &r, Result::AccFunc colAcc, Rcpp::List &target,
-      size_t start, size_t len, Result::AccFunc nullAcc) {
-    r.convertTypedColumn<CT, RT>(colAcc, target, start, len,
-        [&nullAcc](const Result::ColBlock &cb, std::shared_ptr<const CT> in,
-          RT &out, size_t offset, size_t start, size_t end) {
-      NullCol nullCol =
-        nullAcc ? nullAcc(cb)->As<ch::ColumnNullable>() : nullptr;
-      convertEntries<CT,RT>(in, nullCol, out, offset, start, end);
-    });
+  //NOTE: maps can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    auto &mapCol = static_cast<const ch::ColumnMap &>(col);
+    ch::ColumnRef keyCol = mapCol.GetKeys(), valueCol = mapCol.GetValues();
+    const uint64_t *offsets = mapCol.GetOffsets()->Data();
+    for(size_t j = start; j < end; j++) {
+      size_t first = j == 0 ? 0 : offsets[j-1];
+      Rcpp::RObject k = keys.alloc(offsets[j]-first);
+      keys.convert(*keyCol, nullptr, k, 0, first, offsets[j]);
+      keys.finish(k);
+      Rcpp::RObject v = values.alloc(offsets[j]-first);
+      values.convert(*valueCol, nullptr, v, 0, first, offsets[j]);
+      values.finish(v);
+      v.attr("names") = keyNames(k);
+      out[offset+j-start] = v;
+    }
   }
 
-  void processCol(ch::ColumnRef col, Rcpp::List &target, size_t targetIdx,
-      NullCol nullCol) {
-    auto typedCol = col->As<CT>();
-    RT v(col->Size());
-    convertEntries<CT,RT>(typedCol, nullCol, v, 0, 0, col->Size());
-    target[targetIdx] = v;
+  void finish(RT &) const {}
+
+  void reset() {
+    keys.reset();
+    values.reset();
   }
 };
 
-class NullableConverter : public Converter {
-  using CT = ch::ColumnNullable;
-  std::unique_ptr<Converter> elemConverter;
+// map columns in flat form: like arrays in flat form, the column holds the end
+// offset of the entries of each row, and the vectors of all keys and values
+// are attached as its attributes "keys" and "values"
+class FlatMapPolicy {
+  AnyPolicy keys, values;
+  std::vector<Rcpp::RObject> keyChunks, valueChunks;
+  double numEntries = 0;
 
 public:
-  NullableConverter(std::unique_ptr<Converter> elemProc) : elemConverter(std::move(elemProc)) {}
+  using RT = Rcpp::NumericVector;
+  static const bool threadSafe = false;
 
-  //NOTE: nested nullable is not currently permitted in Clickhouse
-  void processBlocks(Result &r, Result::AccFunc colAcc, Rcpp::List &target, size_t start, size_t len, Result::AccFunc) {
-    elemConverter->processBlocks(r, [&colAcc](const Result::ColBlock &cb){return colAcc(cb)->As<CT>()->Nested();}, target, start, len, [&colAcc](const Result::ColBlock &cb){return colAcc(cb)->As<ch::ColumnNullable>();});
+  FlatMapPolicy(AnyPolicy keys, AnyPolicy values) : keys(std::move(keys)), values(std::move(values)) {}
+
+  RT alloc(size_t len) const {
+    return RT(len);
   }
 
-  void processCol(ch::ColumnRef col, Rcpp::List &target, size_t targetIdx, NullCol) {
-    auto typedCol = col->As<CT>();
-    elemConverter->processCol(typedCol->Nested(), target, targetIdx, typedCol);
+  //NOTE: maps can't be nested in a Nullable, so nullCol can be ignored
+  void convert(const ch::Column &col, const ch::ColumnNullable *,
+      RT &out, size_t offset, size_t start, size_t end) {
+    if(start == end) {
+      return;
+    }
+    auto &mapCol = static_cast<const ch::ColumnMap &>(col);
+    const uint64_t *offsets = mapCol.GetOffsets()->Data();
+    size_t first = start == 0 ? 0 : offsets[start-1];
+    for(size_t j = start; j < end; j++) {
+      out[offset+j-start] = numEntries+(offsets[j]-first);
+    }
+
+    Rcpp::RObject k = keys.alloc(offsets[end-1]-first);
+    keys.convert(*mapCol.GetKeys(), nullptr, k, 0, first, offsets[end-1]);
+    keys.finish(k);
+    keyChunks.push_back(k);
+    Rcpp::RObject v = values.alloc(offsets[end-1]-first);
+    values.convert(*mapCol.GetValues(), nullptr, v, 0, first, offsets[end-1]);
+    values.finish(v);
+    valueChunks.push_back(v);
+    numEntries += offsets[end-1]-first;
+  }
+
+  void finish(RT &out) {
+    out.attr("keys") = joinChunks(keys, keyChunks);
+    out.attr("values") = joinChunks(values, valueChunks);
+  }
+
+  void reset() {
+    keys.reset();
+    values.reset();
+    keyChunks.clear();
+    valueChunks.clear();
+    numEntries = 0;
   }
 };
 
-class ArrayConverter : public Converter {
-  std::unique_ptr<Converter> elemConverter;
+// converter for a column whose type is fully described by the policy P
+template<typename P>
+class TypedConverter : public Converter {
+  P policy;
+  typename P::RT v;
+  size_t rows = 0,      // entries converted into v
+         capacity = 0;  // entries v has been allocated for
 
 public:
-  ArrayConverter(std::unique_ptr<Converter> elemProc) : elemConverter(std::move(elemProc)) {}
-
-  //NOTE: arrays can't be nested in a Nullable, so that can be ignored
-  void processBlocks(Result &r, Result::AccFunc colAcc, Rcpp::List &target, size_t start, size_t len, Result::AccFunc) {
-    using CT = ch::ColumnArray;
-    using RT = Rcpp::List;
-    auto eproc = std::move(elemConverter);
-    r.convertTypedColumn<ch::ColumnArray, Rcpp::List>(colAcc, target, start, len, [&eproc](const Result::ColBlock &, std::shared_ptr<const CT> in, RT &out, size_t offset, size_t start, size_t end) {
-      for(size_t j = start; j < end; j++) {
-        ch::ColumnRef entry = in->GetAsColumn(j);
-        eproc->processCol(entry, out, offset+j-start, nullptr);
-      }
-    });
+  TypedConverter(P policy) : policy(std::move(policy)) {}
+
+  void alloc(size_t len) override {
+    v = policy.alloc(len);
+    rows = 0;
+    capacity = len;
   }
 
-  void processCol(ch::ColumnRef, Rcpp::List &, size_t, NullCol) {
-    throw std::invalid_argument("nested arrays are currently not supported");
+  void append(size_t len) override {
+    if(rows+len <= capacity) {
+      return;
+    }
+    const size_t grown = std::max(rows+len, 2*capacity);
+    typename P::RT w = policy.alloc(grown);
+    copyPolicyRows(policy, v, w, rows, capacity, grown);
+    v = w;
+    capacity = grown;
   }
-};
 
-template<typename CT, typename VT, typename RT>
-class EnumConverter : public Converter {
-  ch::EnumType type;
-  Rcpp::CharacterVector levels;
-  LevelMapT<VT> levelMap;   // mapping from enum values in the column type to
-                            // level indices in the R factor to be created
+  void convert(const Result &r, size_t colIdx, size_t start, size_t len) override {
+    const size_t base = rows;
+    r.forEachBlock(colIdx, start, len, [this, base](const ch::Column &col,
+          size_t offset, size_t localStart, size_t localEnd) {
+      policy.convert(col, nullptr, v, base+offset, localStart, localEnd);
+    });
+    rows += len;
+  }
 
-  void genLevelMap(LevelMapT<VT> &levelMap, Rcpp::CharacterVector &levels) {
-    for (auto it = type.BeginValueToName(); it != type.EndValueToName(); it++) {
-      levels.push_back(it->second);
-      levelMap[it->first] = levels.size();  // note: R factor level indices start at 1
+  void finish(Rcpp::List &target) override {
+    if(rows < capacity) {
+      // the spare room of accumulated entries
+      typename P::RT w = policy.alloc(rows);
+      copyPolicyRows(policy, v, w, rows, capacity, rows);
+      v = w;
     }
+    policy.finish(v);
+    policy.reset();
+    target.push_back(v);
+    v = typename P::RT();
+    rows = capacity = 0;
   }
 
-public:
-  EnumConverter(ch::TypeRef type, const std::vector<EnumItem>& items) : type(type->GetCode(), items) {
-    genLevelMap(levelMap, levels);
+  bool threadSafe() const override {
+    return P::threadSafe;
   }
+};
 
-  void processBlocks(Result &r, Result::AccFunc colAcc, Rcpp::List &target,
-      size_t start, size_t len, Result::AccFunc nullAcc) {
+// nesting of the innermost element type
+struct Nesting {
+  size_t arrayDepth;  // number of enclosing arrays
+  bool isNullable;
+  bool flatArrays;    // convert the outermost array to the flat form
+};
 
-    r.convertTypedColumn<CT, RT>(colAcc, target, start, len,
-        [&](const Result::ColBlock &cb, std::shared_ptr<const CT> in,
-          RT &out, size_t offset, size_t start, size_t end) {
-      NullCol nullCol =
-        nullAcc ? nullAcc(cb)->As<ch::ColumnNullable>() : nullptr;
-      convertEnumEntries<CT,VT,RT>(in, levelMap, nullCol, out, offset, start, end);
+// the final step of building a converter from the nested policies
+struct MakeConverter {
+  using Made = std::unique_ptr<Converter>;
+  template<typename P>
+  Made operator()(P policy) const {
+    return Made(new TypedConverter<P>(std::move(policy)));
+  }
+};
 
-      out.attr("class") = "factor";
-      out.attr("levels") = levels;
-    });
+// the final step of building the policy of a tuple element
+struct MakeAnyPolicy {
+  using Made = AnyPolicy;
+  template<typename P>
+  Made operator()(P policy) const {
+    return AnyPolicy::of(std::move(policy));
   }
-  void processCol(ch::ColumnRef col, Rcpp::List &target, size_t targetIdx,
-      NullCol nullCol) {
-    auto typedCol = col->As<CT>();
-    RT v(col->Size());
+};
 
-    convertEnumEntries<CT,VT,RT>(typedCol, levelMap, nullCol, v, 0, 0, col->Size());
+template<typename P, typename W>
+typename W::Made nestArray(P elem, const Nesting &nesting, W &wrap) {
+  if(nesting.flatArrays) {
+    return wrap(FlatArrayPolicy<P>(std::move(elem)));
+  }
+  return wrap(ArrayPolicy<P>(std::move(elem)));
+}
 
-    v.attr("class") = "factor";
-    v.attr("levels") = levels;
-    target[targetIdx] = v;
+template<typename P, typename W>
+typename W::Made nestArrays(P elem, const Nesting &nesting, W &wrap) {
+  if(nesting.arrayDepth == 0) {
+    return wrap(std::move(elem));
+  } else if(nesting.arrayDepth == 1) {
+    return nestArray(std::move(elem), nesting, wrap);
   }
-};
+  // the arrays between the outermost and the innermost one
+  AnyPolicy inner = AnyPolicy::of(ArrayPolicy<P>(std::move(elem)));
+  for(size_t i = 2; i < nesting.arrayDepth; i++) {
+    inner = AnyPolicy::of(ArrayPolicy<AnyPolicy>(std::move(inner)));
+  }
+  return nestArray(std::move(inner), nesting, wrap);
+}
+
+// wrap the policy for the innermost element type according to the nesting of
+// the column type, and pass the result to wrap
+template<typename P, typename W>
+typename W::Made nestPolicy(P elem, const Nesting &nesting, W &wrap) {
+  if(nesting.isNullable) {
+    return nestArrays(NullablePolicy<P>(std::move(elem)), nesting, wrap);
+  }
+  return nestArrays(std::move(elem), nesting, wrap);
+}
 
 std::unique_ptr<Converter> Result::buildConverter(std::string name, ch::TypeRef type) const {
+  MakeConverter wrap;
+  return withPolicy(name, type, true, wrap);
+}
+
+template<typename W>
+typename W::Made Result::withPolicy(std::string name, ch::TypeRef type, bool topLevel,
+    W &wrap) const {
   using TC = ch::Type::Code;
 
+  Nesting nesting{0, false, false};
+  while(type->GetCode() == TC::Array) {
+    nesting.arrayDepth++;
+    // downcast to ArrayType to access GetItemType member
+    type = std::static_pointer_cast<ch::ArrayType>(type)->GetItemType();
+  }
+  nesting.flatArrays = flatArrays && topLevel && nesting.arrayDepth > 0;
+  if(type->GetCode() == TC::Nullable) {
+    nesting.isNullable = true;
+    // downcast to NullableType to access GetNestedType member
+    type = std::static_pointer_cast<ch::NullableType>(type)->GetNestedType();
+  }
+
   switch(type->GetCode()) {
     case TC::Int8:
-      return std::unique_ptr<ScalarConverter<ch::ColumnInt8, Rcpp::IntegerVector>>(new ScalarConverter<ch::ColumnInt8, Rcpp::IntegerVector>);
+      return nestPolicy(NumericPolicy<int8_t, Rcpp::IntegerVector>(), nesting, wrap);
     case TC::Int16:
-      return std::unique_ptr<ScalarConverter<ch::ColumnInt16, Rcpp::IntegerVector>>(new ScalarConverter<ch::ColumnInt16, Rcpp::IntegerVector>);
+      return nestPolicy(NumericPolicy<int16_t, Rcpp::IntegerVector>(), nesting, wrap);
     case TC::Int32:
-      return std::unique_ptr<ScalarConverter<ch::ColumnInt32, Rcpp::IntegerVector>>(new ScalarConverter<ch::ColumnInt32, Rcpp::IntegerVector>);
+      return nestPolicy(NumericPolicy<int32_t, Rcpp::IntegerVector>(), nesting, wrap);
     case TC::Int64:
-      return std::unique_ptr<ScalarConverter<ch::ColumnInt64, Rcpp::StringVector>>(new ScalarConverter<ch::ColumnInt64, Rcpp::StringVector>);
+      switch(int64Format) {
+        case Int64Format::Integer64:
+          return nestPolicy(Integer64Policy<int64_t>(), nesting, wrap);
+        case Int64Format::Numeric:
+          return nestPolicy(NumericPolicy<int64_t, Rcpp::NumericVector>(), nesting, wrap);
+        case Int64Format::Integer:
+          return nestPolicy(CheckedIntegerPolicy<int64_t>(name), nesting, wrap);
+        default:
+          return nestPolicy(ScalarPolicy<ch::ColumnInt64, Rcpp::StringVector>(), nesting, wrap);
+      }
     case TC::UInt8:
-      return std::unique_ptr<ScalarConverter<ch::ColumnUInt8, Rcpp::IntegerVector>>(new ScalarConverter<ch::ColumnUInt8, Rcpp::IntegerVector>);
+      return nestPolicy(NumericPolicy<uint8_t, Rcpp::IntegerVector>(), nesting, wrap);
     case TC::UInt16:
-      return std::unique_ptr<ScalarConverter<ch::ColumnUInt16, Rcpp::IntegerVector>>(new ScalarConverter<ch::ColumnUInt16, Rcpp::IntegerVector>);
-    case TC::UInt32: {
-      warn("column "+name+" converted from UInt32 to Numeric");
-      return std::unique_ptr<ScalarConverter<ch::ColumnUInt32, Rcpp::NumericVector>>(new ScalarConverter<ch::ColumnUInt32, Rcpp::NumericVector>);
-    }
-    case TC::UInt64: {
-      return std::unique_ptr<ScalarConverter<ch::ColumnUInt64, Rcpp::StringVector>>(new ScalarConverter<ch::ColumnUInt64, Rcpp::StringVector>);
-    }
+      return nestPolicy(NumericPolicy<uint16_t, Rcpp::IntegerVector>(), nesting, wrap);
+    case TC::UInt32:
+      if(uint32Format == UInt32Format::Integer) {
+        return nestPolicy(CheckedIntegerPolicy<uint32_t>(name), nesting, wrap);
+      }
+      return nestPolicy(NumericPolicy<uint32_t, Rcpp::NumericVector>(), nesting, wrap);
+    case TC::UInt64:
+      switch(int64Format) {
+        case Int64Format::Integer64:
+          return nestPolicy(Integer64Policy<uint64_t>(), nesting, wrap);
+        case Int64Format::Numeric:
+          return nestPolicy(NumericPolicy<uint64_t, Rcpp::NumericVector>(), nesting, wrap);
+        case Int64Format::Integer:
+          return nestPolicy(CheckedIntegerPolicy<uint64_t>(name), nesting, wrap);
+        default:
+          return nestPolicy(ScalarPolicy<ch::ColumnUInt64, Rcpp::StringVector>(), nesting, wrap);
+      }
     case TC::UUID:
-      return std::unique_ptr<ScalarConverter<ch::ColumnUUID, Rcpp::StringVector>>(new ScalarConverter<ch::ColumnUUID, Rcpp::StringVector>);
+      switch(uuidFormat) {
+        case UUIDFormat::Raw:
+          return nestPolicy(UUIDRawPolicy(), nesting, wrap);
+        case UUIDFormat::Integer64:
+          return nestPolicy(UUIDInteger64Policy(), nesting, wrap);
+        default:
+          return nestPolicy(ScalarPolicy<ch::ColumnUUID, Rcpp::StringVector>(), nesting, wrap);
+      }
+    case TC::Decimal:
+    case TC::Decimal32:
+    case TC::Decimal64:
+      {
+        // Decimal128 is backed by a column of BigInt, which is not read from
+        // the wire format correctly
+        auto dec_t = std::static_pointer_cast<ch::DecimalType>(type);
+        int scale = dec_t->GetScale();
+        if(dec_t->GetPrecision() <= 9) {
+          return nestPolicy(DecimalPolicy<int32_t>(scale, exactDecimal), nesting, wrap);
+        } else if(dec_t->GetPrecision() <= 18) {
+          return nestPolicy(DecimalPolicy<int64_t>(scale, exactDecimal), nesting, wrap);
+        }
+        throw std::invalid_argument("cannot read unsupported type: "+type->GetName());
+      }
     case TC::Float32:
-      return std::unique_ptr<ScalarConverter<ch::ColumnFloat32, Rcpp::NumericVector>>(new ScalarConverter<ch::ColumnFloat32, Rcpp::NumericVector>);
+      return nestPolicy(NumericPolicy<float, Rcpp::NumericVector>(), nesting, wrap);
     case TC::Float64:
-      return std::unique_ptr<ScalarConverter<ch::ColumnFloat64, Rcpp::NumericVector>>(new ScalarConverter<ch::ColumnFloat64, Rcpp::NumericVector>);
+      return nestPolicy(NumericPolicy<double, Rcpp::NumericVector>(), nesting, wrap);
     case TC::String:
-      return std::unique_ptr<ScalarConverter<ch::ColumnString, Rcpp::StringVector>>(new ScalarConverter<ch::ColumnString, Rcpp::StringVector>);
+      return nestPolicy(StringPolicy<ch::ColumnString>(stringEncoding()), nesting, wrap);
     case TC::FixedString:
-      return std::unique_ptr<ScalarConverter<ch::ColumnFixedString, Rcpp::StringVector>>(new ScalarConverter<ch::ColumnFixedString, Rcpp::StringVector>);
-    case TC::DateTime:
-      return std::unique_ptr<ScalarConverter<ch::ColumnDateTime, Rcpp::DatetimeVector>>(new ScalarConverter<ch::ColumnDateTime, Rcpp::DatetimeVector>);
+      return nestPolicy(StringPolicy<ch::ColumnFixedString>(stringEncoding()), nesting, wrap);
+    case TC::DateTime: {
+      auto dt_t = std::static_pointer_cast<ch::DateTimeType>(type);
+      return nestPolicy(DateTimePolicy<ch::ColumnDateTime>(1, dt_t->GetTimezone()), nesting, wrap);
+    }
+    case TC::DateTime64: {
+      auto dt_t = std::static_pointer_cast<ch::DateTime64Type>(type);
+      return nestPolicy(DateTimePolicy<ch::ColumnDateTime64>(std::pow(10.0, dt_t->GetPrecision()),
+          dt_t->GetTimezone()), nesting, wrap);
+    }
     case TC::Date:
-      return std::unique_ptr<ScalarConverter<ch::ColumnDate, Rcpp::DateVector>>(new ScalarConverter<ch::ColumnDate, Rcpp::DateVector>);
-    case TC::Nullable:
+      return nestPolicy(DatePolicy(), nesting, wrap);
+    case TC::Enum8:
       {
-        // downcast to NullableType to access GetNestedType member
-        std::shared_ptr<class ch::NullableType> nullable_t = std::static_pointer_cast<ch::NullableType>(type);
-
-        return std::unique_ptr<NullableConverter>(new NullableConverter(buildConverter(name, nullable_t->GetNestedType())));
+        // downcast to EnumType to access the enum items
+        auto enum_t = std::static_pointer_cast<ch::EnumType>(type);
+        return nestPolicy(EnumPolicy<ch::ColumnEnum8, int8_t>(*enum_t), nesting, wrap);
       }
-    case TC::Array:
+    case TC::Enum16:
       {
-        // downcast to ArrayType to access GetItemType member
-        std::shared_ptr<class ch::ArrayType> array_t = std::static_pointer_cast<ch::ArrayType>(type);
-
-        return std::unique_ptr<ArrayConverter>(new ArrayConverter(buildConverter(name, array_t->GetItemType())));
+        // downcast to EnumType to access the enum items
+        auto enum_t = std::static_pointer_cast<ch::EnumType>(type);
+        return nestPolicy(EnumPolicy<ch::ColumnEnum16, int16_t>(*enum_t), nesting, wrap);
       }
-    case TC::Enum8:
+    case TC::LowCardinality:
       {
-        // downcast to EnumType to access items member
-        auto enum_t = std::static_pointer_cast<ch::EnumType>(type);
-        // extract items
-        std::vector<EnumItem> items;
-
-        for (auto iter = enum_t->BeginValueToName(); iter != enum_t->EndValueToName(); iter++ ){
-          items.push_back(EnumItem(iter->second, iter->first));
+        // downcast to LowCardinalityType to access the dictionary type
+        auto dict_t = std::static_pointer_cast<ch::LowCardinalityType>(type)->GetNestedType();
+        if(dict_t->GetCode() == TC::Nullable) {
+          dict_t = std::static_pointer_cast<ch::NullableType>(dict_t)->GetNestedType();
         }
-
-        return std::unique_ptr<EnumConverter<ch::ColumnEnum8, int8_t, Rcpp::IntegerVector>>(new EnumConverter<ch::ColumnEnum8, int8_t, Rcpp::IntegerVector>(type, items));
+        if(dict_t->GetCode() == TC::String) {
+          return nestPolicy(LowCardinalityPolicy<ch::ColumnString>(stringEncoding()), nesting, wrap);
+        } else if(dict_t->GetCode() == TC::FixedString) {
+          return nestPolicy(LowCardinalityPolicy<ch::ColumnFixedString>(stringEncoding()), nesting, wrap);
+        }
+        throw std::invalid_argument("cannot read unsupported type: "+type->GetName());
       }
-    case TC::Enum16:
+    case TC::IPv4:
+      if(ipAsText) {
+        return nestPolicy(IPv4StringPolicy(), nesting, wrap);
+      }
+      return nestPolicy(IPv4Policy(), nesting, wrap);
+    case TC::IPv6:
+      if(ipAsText) {
+        return nestPolicy(IPv6StringPolicy(), nesting, wrap);
+      }
+      return nestPolicy(IPv6RawPolicy(), nesting, wrap);
+    case TC::Void:
+      return nestPolicy(NothingPolicy(), nesting, wrap);
+    case TC::Tuple:
       {
-        // downcast to EnumType to access items member
-        auto enum_t = std::static_pointer_cast<ch::EnumType>(type);
-        // extract items
-        std::vector<EnumItem> items;
-
-        for (auto iter = enum_t->BeginValueToName(); iter != enum_t->EndValueToName(); iter++ ){
-          items.push_back(EnumItem(iter->second, iter->first));
+        // downcast to TupleType to access the element types
+        auto tuple_t = std::static_pointer_cast<ch::TupleType>(type);
+        MakeAnyPolicy wrapElem;
+        std::vector<AnyPolicy> elems;
+        for(ch::TypeRef t : tuple_t->GetTupleType()) {
+          elems.push_back(withPolicy(name, t, false, wrapElem));
         }
-
-        return std::unique_ptr<EnumConverter<ch::ColumnEnum16, int16_t, Rcpp::IntegerVector>>(new EnumConverter<ch::ColumnEnum16, int16_t, Rcpp::IntegerVector>(type, items));
+        return nestPolicy(TuplePolicy(std::move(elems)), nesting, wrap);
+      }
+    case TC::Map:
+      {
+        // downcast to MapType to access the key and value types
+        auto map_t = std::static_pointer_cast<ch::MapType>(type);
+        MakeAnyPolicy wrapElem;
+        AnyPolicy keys = withPolicy(name, map_t->GetKeyType(), false, wrapElem);
+        AnyPolicy values = withPolicy(name, map_t->GetValueType(), false, wrapElem);
+        if(flatArrays && topLevel && nesting.arrayDepth == 0) {
+          return nestPolicy(FlatMapPolicy(std::move(keys), std::move(values)), nesting, wrap);
+        } else if(map_t->GetValueType()->GetCode() == TC::Tuple) {
+          // the names of the values would clash with those of the data frames
+          throw std::invalid_argument("maps of tuples can only be read in flat form: "+type->GetName());
+        }
+        return nestPolicy(MapPolicy(std::move(keys), std::move(values)), nesting, wrap);
       }
     default:
       throw std::invalid_argument("cannot read unsupported type: "+type->GetName());
@@ -346,8 +2196,310 @@ void Result::setColInfo(const ch::Block &block) {
   }
 }
 
+void Result::setInt64Format(Int64Format format) {
+  int64Format = format;
+}
+
+void Result::setUInt32Format(UInt32Format format) {
+  uint32Format = format;
+}
+
+void Result::setIPAsText(bool enable) {
+  ipAsText = enable;
+}
+
+void Result::setFlatArrays(bool enable) {
+  flatArrays = enable;
+}
+
+void Result::setExactDecimal(bool enable) {
+  exactDecimal = enable;
+}
+
+void Result::setUUIDFormat(UUIDFormat format) {
+  uuidFormat = format;
+}
+
+void Result::setUTF8Strings(bool enable) {
+  utf8Strings = enable;
+}
+
+void Result::setConversionThreads(unsigned n) {
+  conversionThreads = std::max(n, 1u);
+}
+
+void Result::convertParallel(size_t nRows, const std::vector<bool> &skip) {
+  // handing columns to other threads only pays off for enough entries
+  const size_t minParallelRows = 10000;
+
+  std::vector<size_t> parallelCols, serialCols;
+  for(size_t i = 0; i < converters.size(); i++) {
+    if(skip[i]) {
+      continue;
+    } else if(converters[i]->threadSafe() && conversionThreads > 1 && nRows >= minParallelRows) {
+      parallelCols.push_back(i);
+    } else {
+      serialCols.push_back(i);
+    }
+  }
+
+  if(!parallelCols.empty()) {
+    // up to conversionThreads tasks of the shared executor take the columns
+    // in turn; the R thread takes part in the work while waiting for them,
+    // so that they are all done before any R API function is called again
+    std::atomic<size_t> next(0);
+    ch::TaskGroup group;
+    auto work = [&]() {
+      for(size_t k; !group.Canceled() && (k = next++) < parallelCols.size(); ) {
+        convertColumn(parallelCols[k], nRows);
+      }
+    };
+    const size_t numTasks = std::min<size_t>(conversionThreads, parallelCols.size());
+    for(size_t t = 0; t < numTasks; t++) {
+      group.Run(work);
+    }
+    group.Wait();
+  }
+
+  for(size_t i : serialCols) {
+    convertColumn(i, nRows);
+  }
+}
+
+// each column is converted by a single thread, which alone updates its counters
+void Result::convertColumn(size_t i, size_t nRows) {
+  CLICKHOUSE_PROBE2(convert_start, i, nRows);
+  auto start = std::chrono::steady_clock::now();
+  converters[i]->convert(*this, i, fetchedRows, nRows);
+  ConvertCounters &c = convertCounters[i];
+  c.calls++;
+  c.rows += nRows;
+  c.time += std::chrono::steady_clock::now() - start;
+  if(trace) {
+    trace->Add("convert", start, "rows", nRows);
+    ownTrace->Add("convert", start, "rows", nRows);
+  }
+  CLICKHOUSE_PROBE2(convert_done, i, nRows);
+}
+
+void Result::Progress::add(const ch::Progress &p) {
+  rowsRead += p.rows;
+  bytesRead += p.bytes;
+  totalRows += p.total_rows;
+}
+
+void Result::Progress::add(const ch::Profile &p) {
+  if(p.calculated_rows_before_limit) {
+    hasRowsBeforeLimit = true;
+    rowsBeforeLimit = p.rows_before_limit;
+  }
+}
+
+void Result::Progress::finish() {
+  if(!done) {
+    done = true;
+    end = std::chrono::steady_clock::now();
+  }
+}
+
+double Result::Progress::elapsed() const {
+  auto until = done ? end : std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(until - start).count();
+}
+
+void Result::setRowLimit(double rows) {
+  rowLimit = rows >= 0 && std::isfinite(rows) ? static_cast<size_t>(rows) : SIZE_MAX;
+  // blocks may have been queued already, the limit takes effect with the
+  // next one
+  if(async) {
+    std::lock_guard<std::mutex> lock(async->mutex);
+    async->rowLimit = rowLimit;
+  }
+}
+
+void Result::setProgressCallback(Rcpp::RObject fn, double interval) {
+  progressFn = fn;
+  progressInterval = interval;
+}
+
+Result::Progress Result::progress() const {
+  if(async) {
+    std::lock_guard<std::mutex> lock(async->mutex);
+    return async->progress;
+  }
+  if(flight && flight->receiver) {
+    return flight->receiver->progress();
+  }
+  return queryProgress;
+}
+
+Rcpp::List Result::progressList() const {
+  Progress p = progress();
+  return Rcpp::List::create(
+      Rcpp::Named("rows.read") = static_cast<double>(p.rowsRead),
+      Rcpp::Named("bytes.read") = static_cast<double>(p.bytesRead),
+      Rcpp::Named("total.rows") = static_cast<double>(p.totalRows),
+      Rcpp::Named("rows.before.limit") = p.hasRowsBeforeLimit ?
+        static_cast<double>(p.rowsBeforeLimit) : NA_REAL,
+      Rcpp::Named("elapsed") = p.elapsed());
+}
+
+void Result::onProgress(const ch::Progress &p) {
+  queryProgress.add(p);
+}
+
+void Result::onProfile(const ch::Profile &p) {
+  queryProgress.add(p);
+}
+
+void Result::onDone() {
+  queryProgress.finish();
+  reportProgress(true);
+}
+
+// evaluates the call of the progress callback; run by R_ToplevelExec, so
+// that its errors don't longjmp past the client
+static void callProgressFn(void *call) {
+  Rf_eval(static_cast<SEXP>(call), R_GlobalEnv);
+}
+
+bool Result::reportProgress(bool force) {
+  if(progressFn.isNULL() || progressFailed) {
+    return !progressFailed;
+  }
+  auto now = std::chrono::steady_clock::now();
+  if(!force && std::chrono::duration<double>(now - lastReport).count() < progressInterval) {
+    return true;
+  }
+  lastReport = now;
+
+  Rcpp::List p = progressList();
+  SEXP call = PROTECT(Rf_lang2(progressFn, p));
+  progressFailed = R_ToplevelExec(callProgressFn, call) == FALSE;
+  UNPROTECT(1);
+  return !progressFailed;
+}
+
+bool Result::progressCallbackFailed() const {
+  return progressFailed;
+}
+
+void Result::startClientStats(const ch::Client &client) {
+  clientStatsStart = client.GetStats();
+  startTrace(client);
+}
+
+void Result::finishClientStats(const ch::Client &client) {
+  if(!clientStatsDone) {
+    clientStats = client.GetStats().Since(clientStatsStart);
+    clientStatsDone = true;
+    traceEnd = std::chrono::steady_clock::now();
+  }
+}
+
+void Result::startTrace(const ch::Client &client) {
+  trace = client.GetTrace();
+  if(trace) {
+    ownTrace.reset(new ch::Trace);
+  }
+  traceStart = std::chrono::steady_clock::now();
+}
+
+Rcpp::DataFrame Result::statsFrame() const {
+  std::vector<std::string> stage, item;
+  std::vector<double> calls, bytes, rows, seconds;
+  auto add = [&] (const char *s, const std::string &i, uint64_t c, double b, double r,
+      std::chrono::nanoseconds t) {
+    stage.push_back(s);
+    item.push_back(i);
+    calls.push_back(static_cast<double>(c));
+    bytes.push_back(b);
+    rows.push_back(r);
+    seconds.push_back(std::chrono::duration<double>(t).count());
+  };
+
+  // the client of a streamed query is used by the R thread only, so that its
+  // counters so far can be taken; those of an asynchronous query only once
+  // the query is done
+  ch::ClientStats cs = clientStats;
+  bool haveClientStats = clientStatsDone;
+  const ch::Client *client = streamClient();
+  if(!haveClientStats && client) {
+    cs = client->GetStats().Since(clientStatsStart);
+    haveClientStats = true;
+  }
+  if(haveClientStats) {
+    add("receive", "", cs.receive.calls, cs.receive.bytes, NA_REAL, cs.receive.time);
+    add("send", "", cs.send.calls, cs.send.bytes, NA_REAL, cs.send.time);
+    add("decompress", "", cs.decompress.calls, cs.decompress.bytes, NA_REAL, cs.decompress.time);
+    for(const auto &l : cs.load) {
+      add("load", l.first, l.second.columns, NA_REAL, l.second.rows, l.second.time);
+    }
+    for(const auto &l : cs.skip) {
+      add("skip", l.first, l.second.columns, NA_REAL, l.second.rows, l.second.time);
+    }
+  }
+
+  // conversions by column type
+  std::map<std::string, ConvertCounters> byType;
+  for(size_t i = 0; i < convertCounters.size(); i++) {
+    ConvertCounters &c = byType[colTypes[i]->GetName()];
+    c.calls += convertCounters[i].calls;
+    c.rows += convertCounters[i].rows;
+    c.time += convertCounters[i].time;
+  }
+  for(const auto &c : byType) {
+    add("convert", c.first, c.second.calls, NA_REAL, c.second.rows, c.second.time);
+  }
+
+  // blocks spilled beyond the memory budget, in bytes written to the file
+  if(spillCounters.calls > 0) {
+    add("spill", "", spillCounters.calls, spillCounters.bytes, spillCounters.rows, spillCounters.time);
+    add("reload", "", reloadCounters.calls, reloadCounters.bytes, reloadCounters.rows,
+        reloadCounters.time);
+  }
+  // blocks packed with memory compression, in compressed bytes
+  if(packCounters.calls > 0) {
+    add("pack", "", packCounters.calls, packCounters.bytes, packCounters.rows, packCounters.time);
+    add("unpack", "", unpackCounters.calls, unpackCounters.bytes, unpackCounters.rows,
+        unpackCounters.time);
+  }
+
+  return Rcpp::DataFrame::create(
+      Rcpp::Named("stage") = stage,
+      Rcpp::Named("item") = item,
+      Rcpp::Named("calls") = calls,
+      Rcpp::Named("bytes") = bytes,
+      Rcpp::Named("rows") = rows,
+      Rcpp::Named("seconds") = seconds,
+      Rcpp::Named("stringsAsFactors") = false);
+}
+
+std::string Result::traceJSON(long pid) const {
+  if(!trace) {
+    return std::string();
+  }
+  // the spans of the client while it ran the query, without the
+  // conversions, which may be those of other results fetched meanwhile;
+  // those of this result are taken from its own trace
+  std::vector<ch::TraceSpan> spans;
+  for(const ch::TraceSpan &span : trace->Spans(traceStart)) {
+    if(span.start < traceEnd && std::strcmp(span.name, "convert") != 0 &&
+        std::strcmp(span.name, "fetch_frame") != 0) {
+      spans.push_back(span);
+    }
+  }
+  for(const ch::TraceSpan &span : ownTrace->Spans()) {
+    spans.push_back(span);
+  }
+  std::stable_sort(spans.begin(), spans.end(), [] (const ch::TraceSpan &a, const ch::TraceSpan &b) {
+    return a.start + a.duration < b.start + b.duration;
+  });
+  return ch::ChromeTraceJSON(spans, pid);
+}
+
 bool Result::isComplete() const {
-  return fetchedRows >= availRows;
+  return !streaming && !async && !flight && !asyncError && fetchedRows >= availRows;
 }
 
 size_t Result::numFetchedRows() const {
@@ -366,39 +2518,207 @@ Result::TypeList Result::getColTypes() const {
   return colTypes;
 }
 
+// whether the columns of a type keep their entries in flat buffers which
+// Column::Append concatenates (arrays append row by row, and the dictionaries
+// of LowCardinality columns would hold their values repeatedly)
+static bool isAppendable(const ch::TypeRef &type) {
+  switch(type->GetCode()) {
+    case ch::Type::Nullable:
+      return isAppendable(std::static_pointer_cast<ch::NullableType>(type)->GetNestedType());
+    case ch::Type::Array: case ch::Type::Tuple: case ch::Type::LowCardinality:
+    case ch::Type::Map: case ch::Type::Void:
+      return false;
+    default:
+      return true;
+  }
+}
+
+bool Result::coalesceBlock(const ColBlock &cb) {
+  if(!coalescable || cb.rows >= coalesceRows || columnBlocks.empty() ||
+      columnBlocks.back().spilled || columnBlocks.back().packed ||
+      columnBlocks.back().rows >= coalesceRows) {
+    return false;
+  }
+  for(size_t i = 0; i < cb.columns.size(); i++) {
+    if(!cb.columns[i]->Type()->IsEqual(colTypes[i])) {
+      return false;
+    }
+  }
+  size_t bytes = 0;
+  for(const auto &col : cb.columns) {
+    bytes += col->MemoryUsage();
+  }
+  if(!keepInMemory(bytes)) {
+    return false;   // spilled as a block of its own, or dropped
+  }
+
+  // the columns of a received block may still be referenced elsewhere, so
+  // they are copied before being appended to
+  ColBlock &last = columnBlocks.back();
+  if(!coalescing) {
+    for(auto &col : last.columns) {
+      ch::ColumnRef copy = ch::CreateColumnByType(col->Type()->GetName());
+      if(!copy) {
+        return false;
+      }
+      copy->Append(col);
+      col = copy;
+    }
+    coalescing = true;
+  }
+  for(size_t i = 0; i < cb.columns.size(); i++) {
+    last.columns[i]->Append(cb.columns[i]);
+  }
+  last.rows += cb.rows;
+  // the copies and the storage grown by appending take what they take
+  bytes = 0;
+  for(const auto &col : last.columns) {
+    bytes += col->MemoryUsage();
+  }
+  releaseBytes(last.bytes);
+  holdBytes(bytes);
+  last.bytes = bytes;
+  return true;
+}
+
 void Result::addBlock(const ch::Block &block) {
   if(static_cast<size_t>(colNames.size()) < block.GetColumnCount()) {
     setColInfo(block);
+    coalescable = std::all_of(colTypes.begin(), colTypes.end(), isAppendable);
   }
 
-  if(block.GetRowCount() > 0) {   // don't add empty blocks
-    ColBlock cb;
+  // the query is being canceled for exceeding the memory limit
+  if(exceededMemoryLimit()) {
+    return;
+  }
+  if(block.GetRowCount() > 0 && availRows < rowLimit) {   // don't add empty blocks
+    // the rows beyond the limit are dropped
+    const size_t rows = std::min<size_t>(block.GetRowCount(), rowLimit-availRows);
+    ColBlock cb = ColBlock();
     for(ch::Block::Iterator bi(block); bi.IsValid(); bi.Next()) {
-      cb.columns.push_back(bi.Column());
+      cb.columns.push_back(rows < block.GetRowCount() ? bi.Column()->Slice(0, rows) : bi.Column());
+    }
+    cb.rows = rows;
+    if(!coalesceBlock(cb)) {
+      if(!bufferBlock(cb)) {
+        return;
+      }
+      columnBlocks.push_back(std::move(cb));
+      coalescing = false;
     }
-    columnBlocks.push_back(cb);
-    availRows += block.GetRowCount();
+    availRows += rows;
   }
 }
 
-Rcpp::DataFrame Result::fetchFrame(ssize_t n) {
+size_t Result::prepareFetch(ssize_t n, bool wait) {
+  receiveBlocks(n);
+  receiveAsyncBlocks(n, wait);
+  rethrowAsyncError();
+  checkMemoryLimit();
+
   size_t nRows = n >= 0 ? std::min(static_cast<size_t>(n), availRows-fetchedRows) : availRows-fetchedRows;
-  Rcpp::DataFrame df;
+  loadBlocks(nRows);
 
-  for(size_t i = 0; i < static_cast<size_t>(colNames.size()); i++) {
-    //TODO: it would be sufficient to build the Converter just once
-    std::unique_ptr<Converter> proc = buildConverter(std::string(colNames[i]), colTypes[i]);
-    proc->processBlocks(*this, [&i](const ColBlock &cb){return cb.columns[i];}, df, fetchedRows, nRows, nullptr);
-    //TODO: release blocks once they have been fetched
+  if(converters.size() != colTypes.size()) {
+    converters.clear();
+    for(size_t i = 0; i < colTypes.size(); i++) {
+      converters.push_back(buildConverter(std::string(colNames[i]), colTypes[i]));
+    }
+    convertCounters.assign(converters.size(), ConvertCounters());
   }
+  return nRows;
+}
 
+void Result::setFrameAttributes(Rcpp::DataFrame &df, size_t first, size_t nRows) const {
   df.attr("class") = "data.frame";
   if(nRows > 0) {
-    df.attr("row.names") = Rcpp::Range(fetchedRows+1, fetchedRows+nRows);
+    df.attr("row.names") = rowNames(first, nRows);
   }
   df.attr("names") = colNames;
   df.attr("data.type") = colTypesString;
+}
+
+Rcpp::DataFrame Result::fetchFrame(ssize_t n, bool wait, bool lazy) {
+  if(accumulatedRows > 0) {
+    throw std::runtime_error("the accumulated rows have to be taken before fetching others");
+  }
+  // the span includes the blocks received for the fetch in streaming mode
+  ch::ScopedSpan span(trace.get(), "fetch_frame", "rows");
+  ch::ScopedSpan ownSpan(ownTrace.get(), "fetch_frame", "rows");
+  size_t nRows = prepareFetch(n, wait);
+  span.SetCount(nRows);
+  ownSpan.SetCount(nRows);
+  checkFrameRows(nRows);
+  Rcpp::DataFrame df;
+
+  // lazy columns keep their blocks and are not converted here
+  Rcpp::List lazyCols(converters.size());
+  std::vector<bool> isLazy(converters.size());
+  for(size_t i = 0; lazy && i < converters.size(); i++) {
+    SEXP col = lazyColumn(i, nRows);
+    isLazy[i] = col != R_NilValue;
+    lazyCols[i] = col;
+  }
+
+  for(size_t i = 0; i < converters.size(); i++) {
+    if(!isLazy[i]) converters[i]->alloc(nRows);
+  }
+  convertParallel(nRows, isLazy);
+  for(size_t i = 0; i < converters.size(); i++) {
+    if(isLazy[i]) {
+      df.push_back(lazyCols[i]);
+    } else {
+      converters[i]->finish(df);
+    }
+  }
+
+  setFrameAttributes(df, fetchedRows, nRows);
+  fetchedRows += nRows;
+  releaseFetchedBlocks();
+
+  return df;
+}
+
+size_t Result::accumulateFrame(ssize_t n, bool wait) {
+  size_t nRows = prepareFetch(n, wait);
+  checkFrameRows(accumulatedRows+nRows);
+  for(auto &c : converters) {
+    c->append(nRows);
+  }
+  convertParallel(nRows, std::vector<bool>(converters.size()));
   fetchedRows += nRows;
+  accumulatedRows += nRows;
+  releaseFetchedBlocks();
+  return nRows;
+}
 
+Rcpp::DataFrame Result::accumulatedFrame() {
+  prepareFetch(0, false);
+  Rcpp::DataFrame df;
+  for(auto &c : converters) {
+    if(accumulatedRows == 0) {
+      c->alloc(0);
+    }
+    c->finish(df);
+  }
+  setFrameAttributes(df, fetchedRows-accumulatedRows, accumulatedRows);
+  accumulatedRows = 0;
   return df;
 }
+
+void Result::releaseFetchedBlocks() {
+  // the fetched columns may be referenced by lazy columns or Arrow arrays
+  coalescing = false;
+  while(!columnBlocks.empty() &&
+      firstBlockRow+columnBlocks.front().rows <= fetchedRows) {
+    firstBlockRow += columnBlocks.front().rows;
+    if(!columnBlocks.front().spilled) {
+      releaseBytes(columnBlocks.front().bytes);
+    }
+    auto hot = std::find(hotBlocks.begin(), hotBlocks.end(), &columnBlocks.front());
+    if(hot != hotBlocks.end()) {
+      hotBlocks.erase(hot);
+    }
+    columnBlocks.pop_front();
+  }
+}
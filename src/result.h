@@ -1,23 +1,98 @@
 #pragma once
 
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <vector>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 #define RCPP_NEW_DATE_DATETIME_VECTORS 1
+#define NA_INTEGER64 LLONG_MIN
 #include <Rcpp.h>
 #include <clickhouse/client.h>
+#include "spill.h"
 
 namespace ch = clickhouse;
 
 class Converter;
+class Result;
+struct ArrowArray;
+struct ArrowArrayStream;
+struct ArrowSchema;
 
-using NullCol = std::shared_ptr<ch::ColumnNullable>;
-using EnumItem = std::pair<std::string /* name */, int16_t /* value */>;
+// R representation of UUID columns: strings, the rows of a raw matrix with
+// 16 columns, or the rows of an integer64 matrix with the high and low halves
+enum class UUIDFormat { Character, Raw, Integer64 };
+
+// R representation of Int64 and UInt64 columns: strings, bit64::integer64,
+// doubles (exact up to 2^53), or integers, with NA for values out of range
+enum class Int64Format { Character, Integer64, Numeric, Integer };
+
+// R representation of UInt32 columns: doubles, or integers with NA for values
+// beyond 2^31-1
+enum class UInt32Format { Numeric, Integer };
+
+// the result whose query is still being received by a background thread
+// from the given client, or nullptr; such a client must not be used by the
+// R thread until the result has been completed or cleared
+Result *asyncResult(const ch::Client *client);
+
+// a C++ callback of dbStreamQuery, which is passed an external pointer to
+// it: fn is called with data and each block of the query as it is received,
+// without converting it to R, and the query is canceled once it returns
+// false; the block is only valid during the call
+struct BlockCallback {
+  bool (*fn)(const ch::Block &block, void *data);
+  void *data;
+};
+
+// fill schema with the Arrow type of the columns of block, and array with a
+// struct array of them which refers to their buffers and keeps them alive
+// until it is released (see arrow.cpp)
+void exportBlock(const ch::Block &block, ArrowSchema *schema, ArrowArray *array);
 
 class Result {
   public:
   struct ColBlock {
     std::vector<ch::ColumnRef> columns;
+    size_t rows;  // number of rows in each of the columns
+    size_t bytes; // estimated memory taken by the columns
+    // a spilled block is kept in the spill file instead, with its columns
+    // serialized at spillOffset
+    bool spilled;
+    uint64_t spillOffset;
+    size_t spillSize;
+    // a packed block keeps its columns serialized in packedData, and only
+    // holds them loaded while it is among the hot blocks
+    bool packed;
+    ch::Buffer packedData;
+    // whether the serialized columns are compressed with LZ4
+    bool compressed;
+  };
+
+  // progress of the query as reported by the server
+  struct Progress {
+    uint64_t rowsRead = 0, bytesRead = 0;
+    uint64_t totalRows = 0;   // estimate of the rows to be read in total
+    bool hasRowsBeforeLimit = false;
+    uint64_t rowsBeforeLimit = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(), end;
+    bool done = false;
+
+    // accumulate a progress packet, which holds the increments since the
+    // previous one
+    void add(const ch::Progress &p);
+    void add(const ch::Profile &p);
+    void finish();
+    // seconds since the query has been sent, until it has been done
+    double elapsed() const;
   };
 
   private:
@@ -26,30 +101,426 @@ class Result {
   size_t fetchedRows = 0, // number of rows fetched so far
          availRows = 0;   // number of rows received from DB
   std::string statement;  // SQL statement corresponding to this result
+  std::string queryId;    // id the statement is sent with, if any
+
+  // in streaming mode, blocks are pulled from this connection on demand; in
+  // async mode, a background thread receives them (the external pointer also
+  // keeps the connection alive while the result is)
+  Rcpp::RObject streamConn;
+  bool streaming = false;
+
+  // the blocks of a streamed result which is put in the result cache under
+  // cacheKey, for cacheTTL seconds, once it has been received completely
+  // (without being interrupted)
+  std::vector<ch::Block> cacheBlocks;
+  std::string cacheKey;
+  double cacheTTL = 0;
+
+  // state shared with the thread receiving the blocks of an asynchronous
+  // query from all the clients it is sent to (the shards of a fan-out
+  // query); only the R thread touches the result itself, the receiver merely
+  // queues the decoded blocks
+  struct AsyncQuery {
+    std::vector<ch::Client *> clients;
+    std::vector<ch::ClientStats> statsStart;
+    std::mutex mutex;
+    std::condition_variable received;
+    // blocks not yet added to the result: in the order they arrive in the
+    // first queue, or in one queue per client if the result is ordered,
+    // which are handed over one after the other
+    std::vector<std::deque<ch::Block>> queues;
+    size_t current = 0;             // queue handed over next
+    std::vector<bool> clientDone;
+    size_t running = 0;             // clients still receiving
+    bool done = false;
+    bool cancel = false;            // stop at the next block
+    Progress progress;
+    size_t rows = 0;                // received by all clients
+    size_t rowLimit = SIZE_MAX;     // after which the query is canceled
+    std::exception_ptr error;       // of the first client to fail
+    std::vector<std::thread> threads;
+  };
+  std::unique_ptr<AsyncQuery> async;
+
+  // send queries[i] to clients[i], whose streams are received by one thread
+  // (see AsyncQuery and receiveAsync)
+  void startAsync(const std::vector<ch::Client *> &clients,
+      const std::vector<ch::Query> &queries, bool ordered);
+
+  // the receiver thread of an asynchronous query: starts queries[i] on
+  // state->clients[i] and receives the next packet of whichever stream has
+  // one, until all of them have ended
+  static void receiveAsync(AsyncQuery *state, const std::vector<ch::Query> &queries);
+
+  // the blocks of an asynchronous query with a time to live while it is
+  // running, shared by the results of the identical statements sent
+  // meanwhile, which join it instead of being sent to the server; the
+  // receiver takes the blocks queued by the background thread, and the
+  // others add them as they wait for rows. If the receiver is cleared
+  // before the query is done, another member takes over its connection and
+  // background thread. Only used by the R thread
+  struct Flight {
+    std::string key;              // of the query in the result cache
+    double ttl;                   // for which it is cached once received
+    std::string queryId;
+    std::vector<ch::Block> blocks;  // received so far, the header first
+    Result *receiver;             // holder of the async state, if not done
+    std::vector<Result *> members;  // the results still receiving blocks
+    bool done = false;
+    Progress progress;
+    std::exception_ptr error;     // raised by the fetches of the members
+  };
+  std::shared_ptr<Flight> flight;
+  size_t flightBlocks = 0;      // blocks of the flight added to the result
+
+  // the queries in flight, by their key in the result cache
+  static std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+
+  // add the blocks of the flight received by another result, and its error
+  // once it is done
+  void addFlightBlocks();
+  // close the flight after the receiver is done with the query, caching
+  // the blocks unless there is an error
+  void endFlight(std::exception_ptr error);
+  // stop receiving blocks: leave the flight, handing the query over to
+  // another member if this is its receiver, or cancel the query
+  void stopAsync();
+
+  // add the blocks queued by the background thread (to the flight as well),
+  // waiting a little for one if wait is set, and finish the query once it
+  // is done
+  void takeAsyncBlocks(bool wait);
 
   Rcpp::StringVector colNames;
   TypeList colTypes;
   Rcpp::StringVector colTypesString;
-  std::vector<ColBlock> columnBlocks;
+  // blocks which have not been fetched completely yet; blocks are released as
+  // soon as all of their rows have been fetched
+  std::deque<ColBlock> columnBlocks;
+  size_t firstBlockRow = 0;   // index of the first row in columnBlocks.front()
+
+  // drop the blocks whose rows have all been fetched
+  void releaseFetchedBlocks();
+
+  // small received blocks are appended to the last block while it has fewer
+  // than coalesceRows rows, so that queries returning many tiny blocks (such
+  // as aggregations) are converted from a few large columns; the last block
+  // is only appended to while its columns are copies owned by the result
+  // which no fetch has handed out yet (see addBlock)
+  static const size_t coalesceRows = 65536;
+  bool coalescing = false;
+  // whether the columns of all types can be appended to
+  bool coalescable = false;
+
+  // append cb to the last block if both are small enough, returning false
+  // if cb has to be added as a block of its own
+  bool coalesceBlock(const ColBlock &cb);
+
+  // once the unfetched blocks in memory take more than memoryBudget bytes
+  // (if not 0), further blocks are written to the spill file at spillPath,
+  // compressed with LZ4 if spillCompression is set
+  size_t memoryBudget = 0;
+  std::string spillPath;
+  bool spillCompression = true;
+  size_t bufferedBytes = 0;   // memory of the blocks not spilled
+  size_t peakBytes = 0;       // the most bufferedBytes has been
+  // once the blocks in memory would take more than memoryLimit bytes (if not
+  // 0), or those of all results more than the limit of the process while the
+  // result can't spill, the query is canceled and fetches fail with
+  // memoryLimitError
+  size_t memoryLimit = 0;
+  std::string memoryLimitError;
+
+  // the result holds at most rowLimit rows: the query is canceled once they
+  // have been received, and the rest of the block is dropped
+  size_t rowLimit = SIZE_MAX;
+  std::unique_ptr<SpillFile> spillFile;
+  ch::Buffer spillBuffer;
+
+  // with memory compression, the blocks in memory are packed, compressed
+  // with LZ4, and the columns of up to maxHotBlocks of them (more if a fetch
+  // needs them) are kept loaded, dropping the least recently fetched ones
+  bool memoryCompression = false;
+  static const size_t maxHotBlocks = 4;
+  std::deque<ColBlock *> hotBlocks;
+
+  // calls, bytes in the spill file, rows and time spilling and reading back
+  // blocks
+  struct SpillCounters {
+    uint64_t calls = 0, bytes = 0, rows = 0;
+    std::chrono::nanoseconds time{0};
+  };
+  SpillCounters spillCounters, reloadCounters, packCounters, unpackCounters;
+
+  // account for the memory of a received block, packing it with memory
+  // compression, and spilling it if it exceeds the budget or the limit of the
+  // process (see spill.cpp); returns false if it is dropped for exceeding the
+  // memory limit
+  bool bufferBlock(ColBlock &cb);
+  // whether a block of bytes can be kept in memory; sets memoryLimitError
+  // if it can neither be kept nor spilled
+  bool keepInMemory(size_t bytes);
+  // count blocks kept in memory towards bufferedBytes and the process total
+  void holdBytes(size_t bytes);
+  void releaseBytes(size_t bytes);
+
+  // read back the spilled blocks and load the columns of the packed blocks
+  // holding the next nRows unfetched rows
+  void loadBlocks(size_t nRows);
+  // drop the loaded columns of a packed block
+  void dropColumns(ColBlock &cb);
+
+  // converter tree for each column, built once the column types are known
+  std::vector<std::unique_ptr<Converter>> converters;
+
+  Int64Format int64Format = Int64Format::Character;
+  UInt32Format uint32Format = UInt32Format::Numeric;
+
+  // read IPv4 and IPv6 columns as text instead of numbers and raw matrices
+  bool ipAsText = false;
+
+  // read array columns as the offsets of their rows into a flat vector of
+  // all entries, instead of a list of one vector per row
+  bool flatArrays = false;
+
+  // read Decimal columns as integer64 vectors of unscaled values
+  bool exactDecimal = false;
+
+  UUIDFormat uuidFormat = UUIDFormat::Character;
+
+  // mark the strings read from String and FixedString columns (and the
+  // levels of LowCardinality factors) as UTF-8, instead of the native
+  // encoding
+  bool utf8Strings = true;
+  cetype_t stringEncoding() const { return utf8Strings ? CE_UTF8 : CE_NATIVE; }
+
+  // number of threads converting the columns of a fetch in parallel
+  unsigned conversionThreads = 1;
+
+  Progress queryProgress;
+
+  // R function called with the progress at most every progressInterval
+  // seconds, if set
+  Rcpp::RObject progressFn;
+  double progressInterval = 1;
+  std::chrono::steady_clock::time_point lastReport;
+  bool progressFailed = false;
+
+  // the counters of the client before the query was sent, and the counters
+  // of the query itself once it is done
+  ch::ClientStats clientStatsStart, clientStats;
+  bool clientStatsDone = false;
+
+  // the trace of the client the query is sent to, if it records one, the
+  // time the query has been sent and the time the client has been released
+  // (after which the trace holds the spans of other queries); the
+  // conversions are recorded into it as well, and into ownTrace, since they
+  // go on after the client has been released
+  std::shared_ptr<ch::Trace> trace;
+  std::unique_ptr<ch::Trace> ownTrace;
+  std::chrono::steady_clock::time_point traceStart,
+      traceEnd = std::chrono::steady_clock::time_point::max();
+
+  // calls, rows and time converting each column
+  struct ConvertCounters {
+    uint64_t calls = 0, rows = 0;
+    std::chrono::nanoseconds time{0};
+  };
+  std::vector<ConvertCounters> convertCounters;
+
+  // number of rows converted by accumulateFrame since the rows accumulated
+  // before have been taken by accumulatedFrame
+  size_t accumulatedRows = 0;
+
+  // receive and load the next n rows (all of them, if n < 0) to be fetched
+  // (see fetchFrame) and build the converters, if not done yet; returns the
+  // number of rows available
+  size_t prepareFetch(ssize_t n, bool wait);
+
+  // set the class, names and row names of a data frame of the nRows rows
+  // following the first rows of the result
+  void setFrameAttributes(Rcpp::DataFrame &df, size_t first, size_t nRows) const;
+
+  // convert column i of the next nRows rows, counting the time it takes
+  void convertColumn(size_t i, size_t nRows);
+
+  // convert the columns whose converters are thread-safe in parallel,
+  // skipping those marked in skip
+  void convertParallel(size_t nRows, const std::vector<bool> &skip);
+
+  // an ALTREP vector converting the next nRows entries of column i only when
+  // R accesses them, or R_NilValue if the column has to be converted right
+  // away (see lazy.cpp)
+  SEXP lazyColumn(size_t i, size_t nRows) const;
 
   void setColInfo(const ch::Block &block);
 
-  using TypeAccFunc = std::function<ch::TypeRef(const TypeList &)>;
+  // build the policy converting the innermost element type of type, wrap it
+  // according to the enclosing arrays and Nullable, and pass it to wrap (see
+  // buildConverter in result.cpp); flat arrays are only used if topLevel
+  template<typename W>
+  typename W::Made withPolicy(std::string name, ch::TypeRef type, bool topLevel, W &wrap) const;
+
+  // client of a result in streaming mode, or nullptr if it has been released
+  ch::Client *streamClient() const;
+
+  // receive blocks from the stream until at least n unfetched rows (or all of
+  // them, if n < 0) are available, or the stream has been exhausted
+  void receiveBlocks(ssize_t n);
+
+  // add the blocks received by the background thread, waiting (if wait is
+  // set) until at least n unfetched rows are available or the query is done
+  void receiveAsyncBlocks(ssize_t n, bool wait);
+
+  // the error of an asynchronous query, raised by the next fetch
+  std::exception_ptr asyncError;
+
+  // join the background thread after the query is done, keeping its error
+  void finishAsync();
+
+  void rethrowAsyncError();
+
+  // the counters of the clients of an async query, which is done, and their
+  // release for other queries
+  void finishAsyncStats();
+
+  // takes the trace of client, if it records one, as the query is sent
+  void startTrace(const ch::Client &client);
+
+  // fails unless the columns of block are those of the result
+  void checkColumns(const ch::Block &block) const;
 
   public:
-  using AccFunc = std::function<ch::ColumnRef(const ColBlock &)>;
+  Result(std::string stmt, std::string queryId = std::string());
+
+  // create a result in streaming mode, where query (with its id, settings
+  // and external tables) is sent to conn and its blocks are only received as
+  // they are fetched, or in async mode, where query is executed on conn by a
+  // background thread, so that the R session is not blocked meanwhile
+  Result(Rcpp::XPtr<ch::Client> conn, const ch::Query &query, bool async = false);
+
+  // create a result in async mode whose queries are sent to each of conns at
+  // once, e.g. to the shards of a distributed table or for disjoint ranges
+  // of a table, and whose rows are those of all of them, in the order their
+  // blocks arrive, or if ordered, those of conns[0] first, then those of
+  // conns[1], and so on; queries holds one query for all conns, or one for
+  // each
+  Result(Rcpp::List conns, const std::vector<ch::Query> &queries, bool ordered);
+
+  // cancels the query if the stream has not been drained yet, or if the
+  // background thread is still running
+  ~Result();
+
+  // call f(col, offset, localStart, localEnd) for each block that holds some
+  // of the len entries of column colIdx beginning at start, where entries
+  // [localStart, localEnd) of col go to [offset, offset+localEnd-localStart)
+  // of the requested range
+  template<typename F>
+  void forEachBlock(size_t colIdx, size_t start, size_t len, F f) const;
 
-  template<typename CT, typename RT>
-  using ConvertFunc = std::function<void(const ColBlock &,
-      std::shared_ptr<const CT>, RT &, size_t, size_t, size_t)>;
+  // spill the blocks received beyond bytes of unfetched rows (if positive
+  // and finite) to a temporary file at path; must be set before the query
+  // is received
+  void setMemoryBudget(double bytes, std::string path, bool compress);
 
-  Result(std::string stmt);
+  // cancel the query, failing fetches, once the blocks in memory would take
+  // more than bytes (if positive and finite)
+  void setMemoryLimit(double bytes);
+  // keep the blocks in memory compressed, loading their columns as fetches
+  // reach them; must be set before the query is received
+  void setMemoryCompression(bool enable);
+  // throw memoryLimitError, if the limit has been exceeded
+  void checkMemoryLimit() const;
+  bool exceededMemoryLimit() const { return !memoryLimitError.empty(); }
+  // hold at most rows rows (if not negative and finite), canceling the
+  // query once they have been received; must be set before the first fetch
+  void setRowLimit(double rows);
+  bool reachedRowLimit() const { return colNames.size() > 0 && availRows >= rowLimit; }
+  // the memory taken by the blocks of the result which are held in memory
+  size_t memoryBytes() const { return bufferedBytes; }
 
-  template<typename CT, typename RT>
-  void convertTypedColumn(AccFunc colAcc, Rcpp::List &df,
-      size_t start, size_t len, ConvertFunc<CT, RT> convFunc) const;
+  // the memory taken by the blocks held by all results of the process, and
+  // the limit (0 for none) beyond which further blocks of results are
+  // spilled to disk, or make their queries fail if they can't spill
+  static size_t processMemory();
+  static size_t processMemoryLimit();
+  static void setProcessMemoryLimit(double bytes);
+
+  // cache the result of a streamed query under key for ttl seconds once all
+  // of its blocks have been received (see ResultCache)
+  void cacheWhenComplete(std::string key, double ttl);
+
+  // let the results of identical statements join the asynchronous query of
+  // this result while it is running, and cache its blocks under key for ttl
+  // seconds once they have all been received (see Flight)
+  void startFlight(std::string key, double ttl);
+  // the id of the query in flight under key, or an empty string if there
+  // is none
+  static std::string flightQueryId(const std::string &key);
+  // share the blocks of the query in flight under key (which must be set up
+  // like this result), which are added to it like those of an asynchronous
+  // query; if wait is set, wait until they have all been received, raising
+  // its errors
+  void joinFlight(const std::string &key, bool wait);
+
+  // must be set before the first fetch, since converters are built only once
+  void setInt64Format(Int64Format format);
+  void setUInt32Format(UInt32Format format);
+  void setIPAsText(bool enable);
+  void setFlatArrays(bool enable);
+  void setExactDecimal(bool enable);
+  void setUUIDFormat(UUIDFormat format);
+  void setUTF8Strings(bool enable);
+
+  // convert the columns of wide results with up to n threads; only columns
+  // whose entries are written straight into the storage of numeric R vectors
+  // (numbers, dates, enums, factors of LowCardinality) are converted by other
+  // threads than R's, strings and arrays are still converted one by one
+  void setConversionThreads(unsigned n);
+
+  // call fn with the progress of the query (see progressList) as it is
+  // received, at most every interval seconds, and once it is done
+  void setProgressCallback(Rcpp::RObject fn, double interval);
+
+  const std::string &getQueryId() const;
+
+  Progress progress() const;
+  // the progress as a named list of numbers
+  Rcpp::List progressList() const;
+
+  // called on the R thread as progress and profile packets of a synchronous
+  // or streamed query arrive
+  void onProgress(const ch::Progress &p);
+  void onProfile(const ch::Profile &p);
+  void onDone();
+
+  // call the progress callback if it is due (or if force is set); returns
+  // false if it has failed, after which the query should be canceled
+  bool reportProgress(bool force = false);
+  bool progressCallbackFailed() const;
+
+  // take the counters of client before the query is sent and after it is
+  // done, to report the work done for the query
+  void startClientStats(const ch::Client &client);
+  void finishClientStats(const ch::Client &client);
+
+  // a data frame of the work done for the query so far, with a row per
+  // stage (receive, send, decompress, load, convert) and type of column
+  // loaded or converted, giving the calls, bytes, rows and seconds of each
+  Rcpp::DataFrame statsFrame() const;
+
+  // the spans recorded for the query so far in the JSON format of Chrome's
+  // trace viewer, as events of process pid, or an empty string if its
+  // connection records no trace
+  std::string traceJSON(long pid) const;
 
   bool isComplete() const;
+  // add the blocks received so far in async mode (once the query is done,
+  // this also releases its connection); errors are raised by the next fetch
+  void poll();
+  // ask the background thread to cancel the query and wait for it; the rows
+  // received so far are kept
+  void cancelAsync();
   size_t numFetchedRows() const;
   size_t numRowsAffected() const;
   std::string getStatement() const;
@@ -61,23 +532,53 @@ class Result {
   std::unique_ptr<Converter> buildConverter(std::string name, ch::TypeRef type) const;
 
   // build a data frame containing n entries from the result set, starting at
-  // fetchedRows
-  Rcpp::DataFrame fetchFrame(ssize_t n = -1);
+  // fetchedRows; in async mode, only the rows received so far are returned
+  // unless wait is set; if lazy is set, the columns which support it are
+  // only converted once R accesses them
+  Rcpp::DataFrame fetchFrame(ssize_t n = -1, bool wait = true, bool lazy = false);
+
+  // convert n entries like fetchFrame, but append them to the vectors of the
+  // entries accumulated before instead of returning them, which grow
+  // geometrically, so that fetching a result in many chunks costs linear
+  // time; returns the number of rows appended
+  size_t accumulateFrame(ssize_t n = -1, bool wait = true);
+
+  // a data frame of the rows accumulated so far, which are dropped from the
+  // result
+  Rcpp::DataFrame accumulatedFrame();
+
+  // export n entries from the result set (all of them, if n < 0), starting
+  // at fetchedRows, to out as an Arrow stream of one record batch per block,
+  // which refers to the columns of the block instead of copying them (see
+  // arrow.cpp)
+  void fetchArrow(ssize_t n, ArrowArrayStream *out);
 };
 
-// a nested converter structure used to convert a column to an R vector and add
-// it to a data frame
+// a converter used to convert a column to an R vector and add it to a data
+// frame (implemented by TypedConverter in result.cpp, which is specialized at
+// compile time for the possibly nested column type)
 class Converter {
 public:
-  // convert len column entries, beginning at start, from the blocks in r, and
-  // add the resulting column to target
-  virtual void processBlocks(Result &r, Result::AccFunc colAcc, Rcpp::List &target,
-      size_t start, size_t len, Result::AccFunc nullAcc) = 0;
-
-  // convert the given column to an R vector, which is inserted in the target
-  // list at targetIdx
-  virtual void processCol(ch::ColumnRef col, Rcpp::List &target, size_t targetIdx,
-      NullCol nullCol) = 0;
+  // a column is converted in three steps: alloc and finish must be called
+  // from the R thread, convert may be called from any thread if threadSafe
+  // is true (it then only writes to the storage of the allocated vector)
+
+  // allocate the R vector for len entries
+  virtual void alloc(size_t len) = 0;
+
+  // keep the entries converted so far and make room for len more after them,
+  // growing the vector geometrically, so that the entries of several fetches
+  // are accumulated in one vector instead of being allocated anew
+  virtual void append(size_t len) = 0;
+
+  // convert len entries of column colIdx, beginning at start, from the blocks
+  // in r into the allocated vector, after the entries converted before
+  virtual void convert(const Result &r, size_t colIdx, size_t start, size_t len) = 0;
+
+  // add the converted vector to target (dropping its spare room)
+  virtual void finish(Rcpp::List &target) = 0;
+
+  virtual bool threadSafe() const = 0;
 
   // avoid non-virtual destructor for this abstract class
   virtual ~Converter() {};
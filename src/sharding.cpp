@@ -0,0 +1,90 @@
+#include <stdexcept>
+#include <cityhash/city.h>
+#include <clickhouse/columns/nullable.h>
+#include <clickhouse/columns/numeric.h>
+#include <clickhouse/columns/string.h>
+#include "sharding.h"
+
+namespace {
+
+// the server's intHash64, which cityHash64 applies to integers instead of
+// hashing their bytes
+uint64_t intHash64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// the sharding keys of the integer column col, or false if it is not one of
+// type T
+template<typename T>
+bool integerKeys(const ch::ColumnRef &col, ShardingFunction function,
+    std::vector<uint64_t> &keys) {
+  auto c = col->As<ch::ColumnVector<T>>();
+  if(!c) {
+    return false;
+  }
+  const T *data = c->Data();
+  keys.resize(c->Size());
+  for(size_t i = 0; i < keys.size(); i++) {
+    // as the bits of a value of the same width, zero extended
+    const uint64_t v = static_cast<typename std::make_unsigned<T>::type>(data[i]);
+    keys[i] = function == ShardingFunction::CityHash64 ? intHash64(v) : v;
+  }
+  return true;
+}
+
+}
+
+std::vector<int> shardRows(const ch::ColumnRef &key, ShardingFunction function,
+    const std::vector<uint64_t> &weights) {
+  std::vector<int> slots;
+  for(size_t shard = 0; shard < weights.size(); shard++) {
+    slots.insert(slots.end(), weights[shard], static_cast<int>(shard));
+  }
+  if(slots.empty()) {
+    throw std::invalid_argument("the total weight of the shards must be positive");
+  }
+
+  ch::ColumnRef col = key;
+  if(auto nullable = col->As<ch::ColumnNullable>()) {
+    for(size_t i = 0; i < nullable->Size(); i++) {
+      if(nullable->IsNull(i)) {
+        throw std::invalid_argument("the sharding key can't be NULL");
+      }
+    }
+    col = nullable->Nested();
+  }
+
+  std::vector<uint64_t> keys;
+  const bool integer = integerKeys<int8_t>(col, function, keys) ||
+    integerKeys<int16_t>(col, function, keys) || integerKeys<int32_t>(col, function, keys) ||
+    integerKeys<int64_t>(col, function, keys) || integerKeys<uint8_t>(col, function, keys) ||
+    integerKeys<uint16_t>(col, function, keys) || integerKeys<uint32_t>(col, function, keys) ||
+    integerKeys<uint64_t>(col, function, keys);
+  if(!integer && function != ShardingFunction::CityHash64) {
+    throw std::invalid_argument("the sharding key must be an integer column, not " +
+        col->Type()->GetName());
+  } else if(!integer) {
+    auto strings = col->As<ch::ColumnString>();
+    auto fixed = col->As<ch::ColumnFixedString>();
+    if(!strings && !fixed) {
+      throw std::invalid_argument("the sharding key must be an integer or string column, not " +
+          col->Type()->GetName());
+    }
+    keys.resize(col->Size());
+    for(size_t i = 0; i < keys.size(); i++) {
+      auto s = strings ? strings->At(i) : fixed->At(i);
+      keys[i] = CityHash64(s.data(), s.size());
+    }
+  }
+
+  std::vector<int> shards(keys.size());
+  for(size_t i = 0; i < keys.size(); i++) {
+    shards[i] = slots[keys[i] % slots.size()];
+  }
+  return shards;
+}
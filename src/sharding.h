@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <clickhouse/columns/column.h>
+
+namespace ch = clickhouse;
+
+// How the rows of a Distributed table are assigned to its shards: the
+// sharding key, the value of the key column (Identity) or its cityHash64,
+// modulo the total weight of the shards selects the shard, each of which
+// takes as many consecutive remainders as its weight.
+enum class ShardingFunction { Identity, CityHash64 };
+
+// the shard (0-based) each row of key goes to, for shards of the given
+// weights; key holds integers (taken as unsigned numbers of their width) or,
+// for CityHash64, strings, hashed the way the server's cityHash64 does
+std::vector<int> shardRows(const ch::ColumnRef &key, ShardingFunction function,
+    const std::vector<uint64_t> &weights);
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <clickhouse/base/coded.h>
+#include <clickhouse/base/compressed.h>
+#include <clickhouse/base/input.h>
+#include <clickhouse/base/output.h>
+#include <clickhouse/columns/factory.h>
+#include "result.h"
+#include "spill.h"
+
+// Spilling of results to disk: a result whose unfetched blocks in memory
+// exceed its budget writes the blocks received beyond it to a temporary file,
+// serialized like the columns of inserts (and compressed with LZ4 unless
+// disabled), and reads them back as fetches reach them, so that large
+// extracts are received with bounded memory. Results with memory compression
+// keep their blocks serialized the same way in memory instead, and only load
+// the columns of the few blocks fetches are working on.
+
+#ifdef _WIN32
+#define spillSeek _fseeki64
+#else
+#define spillSeek fseeko
+#endif
+
+static std::runtime_error spillError(const std::string &what, const std::string &path) {
+  return std::runtime_error("can't " + what + " the file " + path +
+      " the result is spilled to: " + std::strerror(errno));
+}
+
+SpillFile::SpillFile(const std::string &path) : path(path) {
+  file = std::fopen(path.c_str(), "w+b");
+  if(!file) {
+    throw spillError("create", path);
+  }
+#ifndef _WIN32
+  // the data stays accessible until the file is closed
+  std::remove(path.c_str());
+#endif
+}
+
+SpillFile::~SpillFile() {
+  std::fclose(file);
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+}
+
+uint64_t SpillFile::append(const ch::Buffer &data) {
+  uint64_t offset = size;
+  if(spillSeek(file, offset, SEEK_SET) != 0 ||
+      std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+    throw spillError("write to", path);
+  }
+  size += data.size();
+  return offset;
+}
+
+void SpillFile::read(uint64_t offset, size_t len, ch::Buffer *data) {
+  data->resize(len);
+  if(spillSeek(file, offset, SEEK_SET) != 0 ||
+      std::fread(data->data(), 1, len, file) != len) {
+    throw spillError("read from", path);
+  }
+}
+
+// the memory taken by the blocks held by all results, only touched by the R
+// thread, and the limit beyond which further blocks are spilled (0 for none)
+static size_t processBytes = 0;
+static size_t processLimit = 0;
+
+static size_t blockBytes(const std::vector<ch::ColumnRef> &columns) {
+  size_t bytes = 0;
+  for(const auto &col : columns) {
+    bytes += col->MemoryUsage();
+  }
+  return bytes;
+}
+
+// serialize columns into data, compressed with LZ4 if compress is set
+static void serializeColumns(const std::vector<ch::ColumnRef> &columns, bool compress,
+    ch::Buffer *data) {
+  data->clear();
+  ch::BufferOutput bufferOutput(data);
+  ch::CodedOutputStream output(&bufferOutput);
+  auto save = [&columns](ch::CodedOutputStream *out) {
+    for(const auto &col : columns) {
+      col->SavePrefix(out);
+      col->Save(out);
+    }
+  };
+  if(compress) {
+    ch::CompressedOutput compressed(&output, ch::CompressionCodec::LZ4);
+    ch::CodedOutputStream coded(&compressed);
+    save(&coded);
+    coded.Flush();
+  } else {
+    save(&output);
+  }
+  output.Flush();
+}
+
+// load the columns of the given types, of rows rows each, serialized in data
+static std::vector<ch::ColumnRef> deserializeColumns(const ch::Buffer &data, bool compress,
+    const std::vector<ch::TypeRef> &types, size_t rows, const std::string &where) {
+  ch::ArrayInput arrayInput(data.data(), data.size());
+  ch::CodedInputStream input(&arrayInput);
+  std::unique_ptr<ch::CompressedInput> compressed;
+  std::unique_ptr<ch::CodedInputStream> coded;
+  ch::CodedInputStream *in = &input;
+  if(compress) {
+    compressed.reset(new ch::CompressedInput(&input));
+    coded.reset(new ch::CodedInputStream(compressed.get()));
+    in = coded.get();
+  }
+  std::vector<ch::ColumnRef> columns;
+  for(const auto &type : types) {
+    ch::ColumnRef col = ch::CreateColumnByType(type->GetName());
+    if(!col || !col->LoadPrefix(in, rows) || !col->Load(in, rows)) {
+      throw std::runtime_error("can't read back a block of type " + type->GetName() + where);
+    }
+    columns.push_back(col);
+  }
+  return columns;
+}
+
+size_t Result::processMemory() {
+  return processBytes;
+}
+
+size_t Result::processMemoryLimit() {
+  return processLimit;
+}
+
+void Result::setProcessMemoryLimit(double bytes) {
+  processLimit = bytes > 0 && std::isfinite(bytes) ? static_cast<size_t>(bytes) : 0;
+}
+
+void Result::holdBytes(size_t bytes) {
+  bufferedBytes += bytes;
+  processBytes += bytes;
+  peakBytes = std::max(peakBytes, bufferedBytes);
+}
+
+void Result::releaseBytes(size_t bytes) {
+  bufferedBytes -= bytes;
+  processBytes -= bytes;
+}
+
+bool Result::keepInMemory(size_t bytes) {
+  if(memoryBudget > 0 && bufferedBytes+bytes > memoryBudget) {
+    return false;
+  }
+  if(processLimit > 0 && processBytes+bytes > processLimit) {
+    // results which can't spill fail instead
+    if(spillPath.empty()) {
+      memoryLimitError = "the results in memory would exceed the limit of " +
+        std::to_string(processLimit) + " bytes set by dbResultMemory";
+    }
+    return false;
+  }
+  if(memoryLimit > 0 && bufferedBytes+bytes > memoryLimit) {
+    memoryLimitError = "the result would take more than its memory.limit of " +
+      std::to_string(memoryLimit) + " bytes; fetch it in chunks as it is streamed, " +
+      "or let it spill to disk beyond a memory.budget";
+    return false;
+  }
+  return true;
+}
+
+void Result::checkMemoryLimit() const {
+  if(!memoryLimitError.empty()) {
+    throw std::runtime_error(memoryLimitError);
+  }
+}
+
+void Result::setMemoryBudget(double bytes, std::string path, bool compress) {
+  memoryBudget = bytes > 0 && std::isfinite(bytes) ? static_cast<size_t>(bytes) : 0;
+  spillPath = path;
+  spillCompression = compress;
+}
+
+void Result::setMemoryLimit(double bytes) {
+  memoryLimit = bytes > 0 && std::isfinite(bytes) ? static_cast<size_t>(bytes) : 0;
+}
+
+void Result::setMemoryCompression(bool enable) {
+  memoryCompression = enable;
+}
+
+bool Result::bufferBlock(ColBlock &cb) {
+  if(memoryCompression) {
+    auto start = std::chrono::steady_clock::now();
+    serializeColumns(cb.columns, true, &cb.packedData);
+    cb.packedData.shrink_to_fit();
+    cb.packed = true;
+    cb.compressed = true;
+    cb.columns.clear();
+    cb.bytes = cb.packedData.capacity();
+
+    packCounters.calls++;
+    packCounters.bytes += cb.packedData.size();
+    packCounters.rows += cb.rows;
+    packCounters.time += std::chrono::steady_clock::now() - start;
+  } else {
+    cb.bytes = blockBytes(cb.columns);
+  }
+  if(keepInMemory(cb.bytes)) {
+    holdBytes(cb.bytes);
+    return true;
+  }
+  if(!memoryLimitError.empty()) {
+    return false;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  if(!spillFile) {
+    spillFile.reset(new SpillFile(spillPath));
+  }
+  // packed blocks are written as they are
+  if(cb.packed) {
+    spillBuffer.swap(cb.packedData);
+    cb.packedData = ch::Buffer();
+    cb.packed = false;
+  } else {
+    serializeColumns(cb.columns, spillCompression, &spillBuffer);
+    cb.compressed = spillCompression;
+  }
+  cb.spillOffset = spillFile->append(spillBuffer);
+  cb.spillSize = spillBuffer.size();
+  cb.spilled = true;
+  cb.columns.clear();
+
+  spillCounters.calls++;
+  spillCounters.bytes += cb.spillSize;
+  spillCounters.rows += cb.rows;
+  spillCounters.time += std::chrono::steady_clock::now() - start;
+  return true;
+}
+
+void Result::loadBlocks(size_t nRows) {
+  size_t row = firstBlockRow;
+  size_t packedBlocks = 0;
+  for(ColBlock &cb : columnBlocks) {
+    if(row >= fetchedRows+nRows) {
+      break;
+    }
+    row += cb.rows;
+
+    if(cb.spilled) {
+      auto start = std::chrono::steady_clock::now();
+      spillFile->read(cb.spillOffset, cb.spillSize, &spillBuffer);
+      cb.columns = deserializeColumns(spillBuffer, cb.compressed, colTypes, cb.rows,
+          " spilled to " + spillPath);
+      cb.spilled = false;
+      cb.bytes = blockBytes(cb.columns);
+      holdBytes(cb.bytes);
+
+      reloadCounters.calls++;
+      reloadCounters.bytes += cb.spillSize;
+      reloadCounters.rows += cb.rows;
+      reloadCounters.time += std::chrono::steady_clock::now() - start;
+    } else if(cb.packed) {
+      packedBlocks++;
+      auto hot = std::find(hotBlocks.begin(), hotBlocks.end(), &cb);
+      if(hot != hotBlocks.end()) {
+        hotBlocks.erase(hot);
+      } else {
+        auto start = std::chrono::steady_clock::now();
+        cb.columns = deserializeColumns(cb.packedData, true, colTypes, cb.rows, " kept in memory");
+        size_t bytes = blockBytes(cb.columns);
+        cb.bytes += bytes;
+        holdBytes(bytes);
+
+        unpackCounters.calls++;
+        unpackCounters.bytes += cb.packedData.size();
+        unpackCounters.rows += cb.rows;
+        unpackCounters.time += std::chrono::steady_clock::now() - start;
+      }
+      hotBlocks.push_back(&cb);
+    }
+  }
+
+  // the columns of the least recently fetched packed blocks are dropped,
+  // sparing those of this fetch
+  while(hotBlocks.size() > std::max(maxHotBlocks, packedBlocks)) {
+    dropColumns(*hotBlocks.front());
+    hotBlocks.pop_front();
+  }
+}
+
+void Result::dropColumns(ColBlock &cb) {
+  size_t bytes = cb.bytes - cb.packedData.capacity();
+  cb.columns.clear();
+  cb.bytes -= bytes;
+  releaseBytes(bytes);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <clickhouse/base/buffer.h>
+#include <clickhouse/columns/column.h>
+
+namespace ch = clickhouse;
+
+// the file the blocks of a result beyond its memory budget are written to
+// (see Result::setMemoryBudget); it is removed when closed, or right away
+// where open files can be removed
+class SpillFile {
+  public:
+  explicit SpillFile(const std::string &path);
+  ~SpillFile();
+
+  // append data to the file, returning its offset
+  uint64_t append(const ch::Buffer &data);
+  // read len bytes at offset into data
+  void read(uint64_t offset, size_t len, ch::Buffer *data);
+
+  private:
+  std::string path;
+  FILE *file;
+  uint64_t size = 0;
+};
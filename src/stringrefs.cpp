@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <clickhouse/base/wire_format.h>
+#include <clickhouse/columns/lowcardinality.h>
+#include <clickhouse/columns/nullable.h>
+#include <Rversion.h>
+#include "stringrefs.h"
+
+ColumnStringRefs::ColumnStringRefs() : ch::Column(ch::Type::CreateString()) {}
+
+void ColumnStringRefs::Append(ch::ColumnRef column) {
+  if(auto col = column->As<ColumnStringRefs>()) {
+    strings.insert(strings.end(), col->strings.begin(), col->strings.end());
+  }
+}
+
+bool ColumnStringRefs::Load(ch::CodedInputStream *, size_t) {
+  // there is no R vector to refer to
+  return false;
+}
+
+void ColumnStringRefs::Save(ch::CodedOutputStream *output) {
+  for(const Ref &s : strings) {
+    ch::WireFormat::WriteUInt64(output, s.len);
+    ch::WireFormat::WriteBytes(output, s.data, s.len);
+  }
+}
+
+ch::ColumnRef ColumnStringRefs::Slice(size_t begin, size_t len) {
+  auto col = std::make_shared<ColumnStringRefs>();
+  if(begin < strings.size()) {
+    len = std::min(len, strings.size()-begin);
+    col->strings.assign(strings.begin()+begin, strings.begin()+begin+len);
+  }
+  return col;
+}
+
+// whether the strings of v are kept alive by it: the elements of an ALTREP
+// vector may be created as they are accessed, unless it has been expanded
+static bool holdsStrings(SEXP v) {
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+  return !ALTREP(v) || DATAPTR_OR_NULL(v) != nullptr;
+#else
+  return true;
+#endif
+}
+
+ch::ColumnRef stringRefsColumn(ch::TypeRef t, SEXP v, R_xlen_t start, R_xlen_t len,
+    std::shared_ptr<ch::ColumnUInt8> nullCol) {
+  using TC = ch::Type::Code;
+  switch(t->GetCode()) {
+    case TC::String:
+      break;
+    case TC::LowCardinality:
+      // the server converts the plain values of the dictionary type
+      return stringRefsColumn(std::static_pointer_cast<ch::LowCardinalityType>(t)->GetNestedType(),
+          v, start, len, nullCol);
+    case TC::Nullable: {
+      auto nullCtlCol = std::make_shared<ch::ColumnUInt8>();
+      auto valCol = stringRefsColumn(std::static_pointer_cast<ch::NullableType>(t)->GetNestedType(),
+          v, start, len, nullCtlCol);
+      return valCol ? std::make_shared<ch::ColumnNullable>(valCol, nullCtlCol) : nullptr;
+    }
+    default:
+      return nullptr;
+  }
+  if(TYPEOF(v) != STRSXP || !holdsStrings(v)) {
+    return nullptr;
+  }
+
+  auto col = std::make_shared<ColumnStringRefs>();
+  for(R_xlen_t i = start; i < start+len; i++) {
+    SEXP e = STRING_ELT(v, i);
+    bool na = e == NA_STRING;
+    if(na && !nullCol) {
+      Rcpp::stop("cannot write NA into a non-nullable column of type "+t->GetName());
+    }
+    if(na) {
+      col->Append("", 0);
+    } else {
+      col->Append(CHAR(e), LENGTH(e));
+    }
+    if(nullCol) {
+      nullCol->Append(na);
+    }
+  }
+  return col;
+}
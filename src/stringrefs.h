@@ -0,0 +1,47 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Rcpp.h>
+#include <clickhouse/columns/column.h>
+#include <clickhouse/columns/numeric.h>
+
+namespace ch = clickhouse;
+
+// a String column of an insert which refers to the strings of an R character
+// vector instead of copying them, and writes them straight to the output
+// stream when the block is sent; the vector must stay alive until then (it is
+// a column of the data frame being inserted, protected by the call inserting
+// it), and the column can't be loaded
+class ColumnStringRefs : public ch::Column {
+  public:
+  ColumnStringRefs();
+
+  // append a string of len bytes, which is not copied
+  void Append(const char *s, size_t len) { strings.push_back(Ref{s, len}); }
+
+  void Append(ch::ColumnRef column) override;
+  bool Load(ch::CodedInputStream *input, size_t rows) override;
+  void Save(ch::CodedOutputStream *output) override;
+  void Clear() override { strings.clear(); }
+  size_t Size() const override { return strings.size(); }
+  // the strings themselves belong to the R vector
+  size_t MemoryUsage() const override { return strings.capacity()*sizeof(Ref); }
+  ch::ColumnRef Slice(size_t begin, size_t len) override;
+
+  private:
+  struct Ref {
+    const char *data;
+    size_t len;
+  };
+  std::vector<Ref> strings;
+};
+
+// the rows [start, start+len) of a character vector written to a column of
+// type t (String, or a Nullable or LowCardinality String) as a
+// ColumnStringRefs, or nullptr if t is of another type or the strings of v
+// are not kept alive by it (as for ALTREP vectors which have not been
+// expanded); NAs are written as NULLs to nullCol, if given
+ch::ColumnRef stringRefsColumn(ch::TypeRef t, SEXP v, R_xlen_t start, R_xlen_t len,
+    std::shared_ptr<ch::ColumnUInt8> nullCol = nullptr);
@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <clickhouse/columns/factory.h>
+#include <clickhouse/columns/date.h>
+#include <clickhouse/columns/decimal.h>
+#include <clickhouse/columns/enum.h>
+#include <clickhouse/columns/ip4.h>
+#include <clickhouse/columns/ip6.h>
+#include <clickhouse/columns/lowcardinality.h>
+#include <clickhouse/columns/nullable.h>
+#include <clickhouse/columns/numeric.h>
+#include <clickhouse/columns/string.h>
+#include <clickhouse/columns/uuid.h>
+#include "textfile.h"
+#include "uuid.h"
+
+// Text files: CSV and TSV files inserted into a table without converting them
+// into R vectors first. The fields are parsed like the server parses these
+// formats: CSV fields may be quoted with "..." (doubling the quotes in them),
+// TSV fields use the backslash escapes of TabSeparated, and \N is NULL in
+// both; empty unquoted fields are the default values of their columns (NULL
+// in Nullable ones). Dates and times are written as YYYY-MM-DD and
+// YYYY-MM-DD hh:mm:ss[.fff], taken as UTC, or as numbers of days and seconds.
+
+namespace {
+
+std::runtime_error parseError(const std::string &text, const ch::TypeRef &type) {
+  return std::runtime_error("can't parse '" + text + "' as " + type->GetName());
+}
+
+template<typename T>
+T parseInteger(const std::string &s, const ch::TypeRef &type) {
+  if(s.empty()) {
+    return 0;
+  }
+  char *e;
+  errno = 0;
+  if(std::is_signed<T>::value) {
+    long long v = std::strtoll(s.c_str(), &e, 10);
+    if(*e != '\0' || errno == ERANGE || v < std::numeric_limits<T>::min() ||
+        v > std::numeric_limits<T>::max()) {
+      throw parseError(s, type);
+    }
+    return static_cast<T>(v);
+  }
+  unsigned long long v = std::strtoull(s.c_str(), &e, 10);
+  if(*e != '\0' || errno == ERANGE || s[0] == '-' || v > std::numeric_limits<T>::max()) {
+    throw parseError(s, type);
+  }
+  return static_cast<T>(v);
+}
+
+template<typename T>
+void appendInteger(ch::ColumnVector<T> &col, const std::string &s) {
+  col.Append(parseInteger<T>(s, col.Type()));
+}
+
+template<typename T>
+void appendFloat(ch::ColumnVector<T> &col, const std::string &s) {
+  if(s.empty()) {
+    col.Append(0);
+    return;
+  }
+  char *e;
+  double v = std::strtod(s.c_str(), &e);
+  if(*e != '\0') {
+    throw parseError(s, col.Type());
+  }
+  col.Append(static_cast<T>(v));
+}
+
+void appendDecimal(ch::ColumnDecimal &col, const std::string &s) {
+  col.Append(s.empty() ? std::string("0") : s);
+}
+
+void appendString(ch::ColumnString &col, const std::string &s) {
+  col.Append(s);
+}
+
+void appendFixedString(ch::ColumnFixedString &col, const std::string &s) {
+  if(s.size() > col.FixedSize()) {
+    throw std::runtime_error("'" + s + "' is too long for " + col.Type()->GetName());
+  }
+  col.Append(s);
+}
+
+// days since 1970-01-01 of a date of the proleptic Gregorian calendar
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y-399)/400;
+  const unsigned yoe = static_cast<unsigned>(y - era*400);
+  const unsigned doy = (153*(m > 2 ? m-3 : m+9) + 2)/5 + d-1;
+  const unsigned doe = yoe*365 + yoe/4 - yoe/100 + doy;
+  return era*146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// reads n digits at p into out
+bool readDigits(const char *&p, const char *end, size_t n, unsigned &out) {
+  out = 0;
+  for(size_t i = 0; i < n; i++, p++) {
+    if(p == end || *p < '0' || *p > '9') {
+      return false;
+    }
+    out = out*10 + (*p - '0');
+  }
+  return true;
+}
+
+bool allDigits(const std::string &s, size_t from) {
+  return from < s.size() && std::all_of(s.begin()+from, s.end(),
+      [](char c) { return c >= '0' && c <= '9'; });
+}
+
+// the seconds since the epoch of "YYYY-MM-DD[ hh:mm:ss[.fff]]" (taken as UTC)
+// or of a number of seconds; the digits of fractional seconds are stored in
+// fraction
+bool parseDateTime(const std::string &s, int64_t &seconds, std::string &fraction) {
+  fraction.clear();
+  std::string whole = s;
+  size_t dot = s.find('.');
+  if(dot != std::string::npos) {
+    if(!allDigits(s, dot+1)) {
+      return false;
+    }
+    fraction = s.substr(dot+1);
+    whole = s.substr(0, dot);
+  }
+  if(allDigits(whole, whole[0] == '-' ? 1 : 0)) {
+    errno = 0;
+    seconds = std::strtoll(whole.c_str(), nullptr, 10);
+    return errno != ERANGE;
+  }
+
+  const char *p = whole.c_str(), *end = p + whole.size();
+  unsigned y, m, d, hh = 0, mm = 0, ss = 0;
+  if(!readDigits(p, end, 4, y) || p == end || *p++ != '-' ||
+      !readDigits(p, end, 2, m) || p == end || *p++ != '-' ||
+      !readDigits(p, end, 2, d) || m < 1 || m > 12 || d < 1 || d > 31) {
+    return false;
+  }
+  if(p != end) {
+    if((*p != ' ' && *p != 'T') || !readDigits(++p, end, 2, hh) ||
+        p == end || *p++ != ':' || !readDigits(p, end, 2, mm) ||
+        p == end || *p++ != ':' || !readDigits(p, end, 2, ss) || p != end) {
+      return false;
+    }
+  }
+  seconds = daysFromCivil(y, m, d)*86400 + hh*3600 + mm*60 + ss;
+  return true;
+}
+
+void appendDate(ch::ColumnDate &col, const std::string &s) {
+  if(s.empty()) {
+    col.AppendDays(0);
+    return;
+  }
+  int64_t seconds;
+  std::string fraction;
+  if(allDigits(s, 0)) {
+    col.AppendDays(parseInteger<uint16_t>(s, col.Type()));
+  } else if(s.find(' ') == std::string::npos && parseDateTime(s, seconds, fraction) &&
+      fraction.empty() && seconds >= 0 && seconds/86400 <= std::numeric_limits<uint16_t>::max()) {
+    col.AppendDays(static_cast<uint16_t>(seconds/86400));
+  } else {
+    throw parseError(s, col.Type());
+  }
+}
+
+void appendDateTime(ch::ColumnDateTime &col, const std::string &s) {
+  int64_t seconds = 0;
+  std::string fraction;
+  if(!s.empty() && (!parseDateTime(s, seconds, fraction) || !fraction.empty())) {
+    throw parseError(s, col.Type());
+  }
+  col.Append(static_cast<std::time_t>(seconds));
+}
+
+void appendDateTime64(ch::ColumnDateTime64 &col, const std::string &s) {
+  int64_t seconds = 0;
+  std::string fraction;
+  if(!s.empty() && !parseDateTime(s, seconds, fraction)) {
+    throw parseError(s, col.Type());
+  }
+  // the fraction is truncated (or padded) to the precision of the column
+  const size_t precision = col.GetPrecision();
+  fraction.resize(precision, '0');
+  int64_t ticks = seconds;
+  for(size_t i = 0; i < precision; i++) {
+    ticks = ticks*10 + (seconds < 0 ? -(fraction[i] - '0') : fraction[i] - '0');
+  }
+  col.Append(ticks);
+}
+
+void appendUUID(ch::ColumnUUID &col, const std::string &s) {
+  ch::UInt128 v(0, 0);
+  if(!s.empty() && !parseUUID(s.c_str(), s.size(), v)) {
+    throw parseError(s, col.Type());
+  }
+  col.Append(v);
+}
+
+// enum entries are given by name, or by value
+template<typename T>
+void appendEnum(ch::ColumnEnum<T> &col, const std::string &s) {
+  auto et = std::static_pointer_cast<ch::EnumType>(col.Type());
+  if(s.empty()) {
+    col.Append(static_cast<T>(et->BeginValueToName()->first));
+  } else if(et->HasEnumName(s)) {
+    col.Append(s);
+  } else {
+    T v = parseInteger<T>(s, col.Type());
+    if(!et->HasEnumValue(v)) {
+      throw std::runtime_error("entry '" + s + "' does not exist in enum type " + et->GetName());
+    }
+    col.Append(v);
+  }
+}
+
+void appendIPv4(ch::ColumnIPv4 &col, const std::string &s) {
+  if(s.empty()) {
+    col.Append(static_cast<uint32_t>(0));
+  } else {
+    col.Append(s);
+  }
+}
+
+void appendIPv6(ch::ColumnIPv6 &col, const std::string &s) {
+  col.Append(s.empty() ? std::string("::") : s);
+}
+
+}
+
+// the column the fields of one column of a text file are parsed into
+class FieldColumn {
+  public:
+  explicit FieldColumn(ch::TypeRef type) : type(type) {}
+  virtual ~FieldColumn() {}
+
+  // append the value of a field which is not NULL
+  virtual void append(const std::string &text) = 0;
+  virtual void appendNull() {
+    throw std::runtime_error("NULL in a column of type " + type->GetName());
+  }
+  // an empty unquoted field: the default value of the column
+  virtual void appendEmpty() { append(std::string()); }
+  // the column of the fields appended since the last call
+  virtual ch::ColumnRef take() = 0;
+
+  static std::unique_ptr<FieldColumn> create(ch::TypeRef type);
+
+  protected:
+  ch::TypeRef type;
+};
+
+namespace {
+
+template<typename CT>
+class ParsedColumn : public FieldColumn {
+  public:
+  typedef void (*Parse)(CT &col, const std::string &text);
+
+  ParsedColumn(ch::TypeRef type, Parse parse) : FieldColumn(type), parse(parse) {
+    reset();
+  }
+
+  void append(const std::string &text) override { parse(*col, text); }
+
+  ch::ColumnRef take() override {
+    ch::ColumnRef c = col;
+    reset();
+    return c;
+  }
+
+  private:
+  void reset() {
+    col = ch::CreateColumnByType(type->GetName())->template As<CT>();
+  }
+
+  Parse parse;
+  std::shared_ptr<CT> col;
+};
+
+class NullableColumn : public FieldColumn {
+  public:
+  NullableColumn(ch::TypeRef type, std::unique_ptr<FieldColumn> nested)
+    : FieldColumn(type), nested(std::move(nested)), nulls(std::make_shared<ch::ColumnUInt8>()) {}
+
+  void append(const std::string &text) override {
+    nested->append(text);
+    nulls->Append(0);
+  }
+
+  void appendNull() override {
+    nested->appendEmpty();
+    nulls->Append(1);
+  }
+
+  void appendEmpty() override { appendNull(); }
+
+  ch::ColumnRef take() override {
+    auto col = std::make_shared<ch::ColumnNullable>(nested->take(), nulls);
+    nulls = std::make_shared<ch::ColumnUInt8>();
+    return col;
+  }
+
+  private:
+  std::unique_ptr<FieldColumn> nested;
+  std::shared_ptr<ch::ColumnUInt8> nulls;
+};
+
+template<typename CT>
+std::unique_ptr<FieldColumn> parsed(ch::TypeRef type, typename ParsedColumn<CT>::Parse parse) {
+  return std::unique_ptr<FieldColumn>(new ParsedColumn<CT>(type, parse));
+}
+
+}
+
+std::unique_ptr<FieldColumn> FieldColumn::create(ch::TypeRef type) {
+  using TC = ch::Type::Code;
+  switch(type->GetCode()) {
+    case TC::Int8:    return parsed<ch::ColumnInt8>(type, appendInteger<int8_t>);
+    case TC::Int16:   return parsed<ch::ColumnInt16>(type, appendInteger<int16_t>);
+    case TC::Int32:   return parsed<ch::ColumnInt32>(type, appendInteger<int32_t>);
+    case TC::Int64:   return parsed<ch::ColumnInt64>(type, appendInteger<int64_t>);
+    case TC::UInt8:   return parsed<ch::ColumnUInt8>(type, appendInteger<uint8_t>);
+    case TC::UInt16:  return parsed<ch::ColumnUInt16>(type, appendInteger<uint16_t>);
+    case TC::UInt32:  return parsed<ch::ColumnUInt32>(type, appendInteger<uint32_t>);
+    case TC::UInt64:  return parsed<ch::ColumnUInt64>(type, appendInteger<uint64_t>);
+    case TC::Float32: return parsed<ch::ColumnFloat32>(type, appendFloat<float>);
+    case TC::Float64: return parsed<ch::ColumnFloat64>(type, appendFloat<double>);
+    case TC::Decimal:
+    case TC::Decimal32:
+    case TC::Decimal64:
+    case TC::Decimal128:
+      return parsed<ch::ColumnDecimal>(type, appendDecimal);
+    case TC::String:      return parsed<ch::ColumnString>(type, appendString);
+    case TC::FixedString: return parsed<ch::ColumnFixedString>(type, appendFixedString);
+    case TC::Date:        return parsed<ch::ColumnDate>(type, appendDate);
+    case TC::DateTime:    return parsed<ch::ColumnDateTime>(type, appendDateTime);
+    case TC::DateTime64:  return parsed<ch::ColumnDateTime64>(type, appendDateTime64);
+    case TC::UUID:        return parsed<ch::ColumnUUID>(type, appendUUID);
+    case TC::Enum8:       return parsed<ch::ColumnEnum8>(type, appendEnum<int8_t>);
+    case TC::Enum16:      return parsed<ch::ColumnEnum16>(type, appendEnum<int16_t>);
+    case TC::IPv4:        return parsed<ch::ColumnIPv4>(type, appendIPv4);
+    case TC::IPv6:        return parsed<ch::ColumnIPv6>(type, appendIPv6);
+    case TC::LowCardinality:
+      // the server converts the plain values of the dictionary type
+      return create(std::static_pointer_cast<ch::LowCardinalityType>(type)->GetNestedType());
+    case TC::Nullable:
+      return std::unique_ptr<FieldColumn>(new NullableColumn(type,
+          create(std::static_pointer_cast<ch::NullableType>(type)->GetNestedType())));
+    default:
+      throw std::runtime_error("can't read columns of type " + type->GetName() +
+          " from a text file");
+  }
+}
+
+TextFileReader::TextFileReader(const std::string &path, Format format, char delimiter,
+    bool header) : path(path), format(format), delimiter(delimiter), contents(path) {
+  pos = static_cast<const char *>(contents.data());
+  end = pos + contents.size();
+  // a byte order mark is skipped
+  if(end-pos >= 3 && std::memcmp(pos, "\xEF\xBB\xBF", 3) == 0) {
+    pos += 3;
+  }
+  if(header && pos < end) {
+    char term;
+    do {
+      term = readField();
+      names.push_back(field);
+    } while(term == delimiter);
+  }
+}
+
+TextFileReader::~TextFileReader() {}
+
+void TextFileReader::setColumns(const std::vector<std::string> &colNames,
+    const std::vector<ch::TypeRef> &types) {
+  if(!names.empty() && names.size() != types.size()) {
+    throw std::runtime_error("the header of " + path + " has " + std::to_string(names.size()) +
+        " fields, but the insert has " + std::to_string(types.size()) + " columns");
+  }
+  columnNames = colNames;
+  columns.clear();
+  for(const auto &type : types) {
+    columns.push_back(FieldColumn::create(type));
+  }
+}
+
+std::runtime_error TextFileReader::error(const std::string &what, size_t atLine) const {
+  return std::runtime_error(path + ":" + std::to_string(atLine) + ": " + what);
+}
+
+char TextFileReader::terminator() {
+  if(pos == end) {
+    return 0;
+  }
+  char c = *pos++;
+  if(c == '\r' && pos < end && *pos == '\n') {
+    c = *pos++;
+  }
+  if(c == '\n') {
+    line++;
+  } else if(c != delimiter) {
+    throw error("unexpected character '" + std::string(1, c) + "' after a field", line);
+  }
+  return c;
+}
+
+char TextFileReader::readField() {
+  field.clear();
+  fieldNull = fieldEmpty = false;
+  return format == CSV ? readCSVField() : readTSVField();
+}
+
+char TextFileReader::readCSVField() {
+  if(pos < end && *pos == '"') {
+    pos++;
+    while(true) {
+      auto quote = static_cast<const char *>(std::memchr(pos, '"', end-pos));
+      if(!quote) {
+        throw error("unterminated quoted field", line);
+      }
+      line += std::count(pos, quote, '\n');
+      field.append(pos, quote);
+      pos = quote+1;
+      if(pos < end && *pos == '"') {
+        field += '"';
+        pos++;
+      } else {
+        break;
+      }
+    }
+    return terminator();
+  }
+
+  const char *start = pos;
+  while(pos < end && *pos != delimiter && *pos != '\n' && *pos != '\r') {
+    pos++;
+  }
+  field.assign(start, pos);
+  fieldNull = field == "\\N";
+  fieldEmpty = field.empty();
+  return terminator();
+}
+
+char TextFileReader::readTSVField() {
+  const char *start = pos;
+  while(pos < end && *pos != delimiter && *pos != '\n' && *pos != '\r') {
+    char c = *pos++;
+    if(c != '\\' || pos == end) {
+      field += c;
+      continue;
+    }
+    switch(char e = *pos++) {
+      case 't': field += '\t'; break;
+      case 'n': field += '\n'; break;
+      case 'r': field += '\r'; break;
+      case 'b': field += '\b'; break;
+      case 'f': field += '\f'; break;
+      case '0': field += '\0'; break;
+      default:  field += e;
+    }
+  }
+  fieldNull = pos-start == 2 && start[0] == '\\' && start[1] == 'N';
+  fieldEmpty = pos == start;
+  return terminator();
+}
+
+std::shared_ptr<ch::Block> TextFileReader::readBlock(size_t maxRows) {
+  if(pos == end) {
+    return nullptr;
+  }
+  const size_t ncols = columns.size();
+  size_t n = 0;
+  for(; n < maxRows && pos < end; n++) {
+    const size_t rowLine = line;
+    for(size_t i = 0; i < ncols; i++) {
+      char term = readField();
+      try {
+        if(fieldNull) {
+          columns[i]->appendNull();
+        } else if(fieldEmpty) {
+          columns[i]->appendEmpty();
+        } else {
+          columns[i]->append(field);
+        }
+      } catch(const std::exception &e) {
+        throw error("column " + columnNames[i] + ": " + e.what(), rowLine);
+      }
+      if(i+1 < ncols && term != delimiter) {
+        throw error("the row has " + std::to_string(i+1) + " fields, but the insert has " +
+            std::to_string(ncols) + " columns", rowLine);
+      }
+      if(i+1 == ncols && term == delimiter) {
+        throw error("the row has more than " + std::to_string(ncols) + " fields", rowLine);
+      }
+    }
+  }
+
+  auto block = std::make_shared<ch::Block>();
+  for(size_t i = 0; i < ncols; i++) {
+    block->AppendColumn(columnNames[i], columns[i]->take());
+  }
+  rows += n;
+  contents.release(pos - static_cast<const char *>(contents.data()));
+  return block;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <clickhouse/block.h>
+#include "native.h"
+
+namespace ch = clickhouse;
+
+class FieldColumn;
+
+// reads the rows of a CSV or TSV file into blocks of the columns of an insert,
+// parsing the fields by the types of the columns; the file is mapped, and the
+// pages read are dropped block by block, so that the memory taken does not
+// grow with the size of the file
+class TextFileReader {
+  public:
+  enum Format { CSV, TSV };
+
+  // the first line holds the names of the columns if header is true
+  TextFileReader(const std::string &path, Format format, char delimiter, bool header);
+  ~TextFileReader();
+
+  // the names in the header line, if any
+  const std::vector<std::string> &headerNames() const { return names; }
+  // set the columns the fields are parsed into
+  void setColumns(const std::vector<std::string> &colNames,
+      const std::vector<ch::TypeRef> &types);
+
+  // read up to maxRows rows into a block, returning nullptr at the end of the
+  // file
+  std::shared_ptr<ch::Block> readBlock(size_t maxRows);
+
+  size_t numRows() const { return rows; }
+
+  private:
+  // parse the field at pos into field, returning the character ending it
+  // (delimiter, '\n' or 0 at the end of the file)
+  char readField();
+  char readCSVField();
+  char readTSVField();
+  // consume the character ending a field
+  char terminator();
+  std::runtime_error error(const std::string &what, size_t atLine) const;
+
+  std::string path;
+  Format format;
+  char delimiter;
+  FileContents contents;
+  const char *pos, *end;
+  size_t line = 1;
+  size_t rows = 0;
+
+  // the current field
+  std::string field;
+  bool fieldNull, fieldEmpty;
+
+  std::vector<std::string> names;
+  std::vector<std::string> columnNames;
+  std::vector<std::unique_ptr<FieldColumn>> columns;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <clickhouse/columns/uuid.h>
+
+// Hex kernels for the textual form of UUIDs (xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx),
+// which convert a byte (or a hex digit) per table lookup instead of going
+// through snprintf/sscanf and temporary strings. Neither allocates nor calls
+// R, so both can be used from any thread.
+
+const size_t uuidTextLength = 36;
+
+// the two lowercase hex digits of each byte value
+struct UUIDHexPairs {
+  char digits[256][2];
+  UUIDHexPairs() {
+    const char *hex = "0123456789abcdef";
+    for(int i = 0; i < 256; i++) {
+      digits[i][0] = hex[i >> 4];
+      digits[i][1] = hex[i & 0xF];
+    }
+  }
+};
+
+// the value of each hex digit, or -1 for other characters
+struct UUIDHexValues {
+  int8_t values[256];
+  UUIDHexValues() {
+    for(int i = 0; i < 256; i++) {
+      values[i] = -1;
+    }
+    for(int i = 0; i < 10; i++) {
+      values['0'+i] = i;
+    }
+    for(int i = 0; i < 6; i++) {
+      values['a'+i] = values['A'+i] = 10+i;
+    }
+  }
+};
+
+inline const UUIDHexPairs &uuidHexPairs() {
+  static const UUIDHexPairs table;
+  return table;
+}
+
+inline const UUIDHexValues &uuidHexValues() {
+  static const UUIDHexValues table;
+  return table;
+}
+
+// writes the 36 characters of the textual form of the UUID (hi, lo) to out
+inline void formatUUID(uint64_t hi, uint64_t lo, char *out) {
+  const UUIDHexPairs &t = uuidHexPairs();
+  // the dashes follow bytes 4, 6, 8 and 10
+  int b = 0;
+  for(int shift = 56; shift >= 0; shift -= 8, b++) {
+    if(b == 4 || b == 6) {
+      *out++ = '-';
+    }
+    const char *d = t.digits[(hi >> shift) & 0xFF];
+    *out++ = d[0];
+    *out++ = d[1];
+  }
+  for(int shift = 56; shift >= 0; shift -= 8, b++) {
+    if(b == 8 || b == 10) {
+      *out++ = '-';
+    }
+    const char *d = t.digits[(lo >> shift) & 0xFF];
+    *out++ = d[0];
+    *out++ = d[1];
+  }
+}
+
+// parses the textual form of a UUID given by the len characters at str;
+// returns false if it is malformed
+inline bool parseUUID(const char *str, size_t len, clickhouse::UInt128 &out) {
+  if(len != uuidTextLength || str[8] != '-' || str[13] != '-' || str[18] != '-' ||
+      str[23] != '-') {
+    return false;
+  }
+  const int8_t *values = uuidHexValues().values;
+  uint64_t halves[2] = {0, 0};
+  int digits = 0;
+  for(size_t i = 0; i < uuidTextLength; i++) {
+    if(i == 8 || i == 13 || i == 18 || i == 23) {
+      continue;
+    }
+    int8_t v = values[static_cast<unsigned char>(str[i])];
+    if(v < 0) {
+      return false;
+    }
+    uint64_t &half = halves[digits++ / 16];
+    half = (half << 4) | static_cast<uint64_t>(v);
+  }
+  out = clickhouse::UInt128(halves[0], halves[1]);
+  return true;
+}